@@ -0,0 +1,110 @@
+// Measures full scans of a row table with one and several worker threads,
+// on a table several times larger than the buffer pool, so every scan reads
+// and evicts pages while the workers run.
+//
+// Build and run with: make clean bench && ./parallel_scan_bench
+
+#include "storage/buffer_pool.h"
+#include "storage/column_batch.h"
+#include "storage/metadata.h"
+#include "storage/table.h"
+#include "storage/wal.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sqldb;
+
+namespace {
+
+constexpr size_t ROW_COUNT = 2000000;
+constexpr size_t LOAD_POOL_BYTES = 256 * 1024 * 1024;
+constexpr size_t SCAN_POOL_BYTES = 8 * 1024 * 1024;
+constexpr int ROUNDS = 3;
+
+void load_table(const std::string& data_dir) {
+    MetadataManager metadata(data_dir);
+    metadata.create_table("events", {Column("id", DataType::INTEGER, 0, false), Column("kind", DataType::INTEGER),
+                                     Column("name", DataType::VARCHAR, 40), Column("valid", DataType::BOOLEAN)});
+    WriteAheadLog wal(data_dir + "/wal.log", WalSyncMode::OFF, 0);
+    BufferPool pool(LOAD_POOL_BYTES);
+    pool.set_write_ahead_log(&wal);
+    {
+        TableStorage table("events", &metadata, &pool, &wal);
+        for (size_t i = 0; i < ROW_COUNT; i++) {
+            int id = static_cast<int>(i);
+            table.insert_row({Value(id), Value(id % 1000), Value("event name " + std::to_string(id)),
+                              Value(id % 3 == 0)});
+        }
+    }
+    wal.checkpoint(&pool);
+}
+
+// Best of several full scans, in milliseconds
+double time_scan(TableStorage& table, const std::vector<Column>& schema, size_t threads, size_t& rows) {
+    table.set_scan_threads(threads);
+    double best = 0;
+    ColumnBatch batch;
+    for (int round = 0; round < ROUNDS; round++) {
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<TableCursor> cursor = table.open_cursor(nullptr, nullptr);
+        rows = 0;
+        while (true) {
+            batch.reset(schema, nullptr);
+            size_t produced = cursor->next_columns(batch, 1024);
+            if (produced == 0) {
+                break;
+            }
+            rows += produced;
+        }
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = round == 0 ? elapsed : std::min(best, elapsed);
+    }
+    return best;
+}
+
+} // namespace
+
+int main() {
+    std::string data_dir = (std::filesystem::temp_directory_path() / "sqldb_parallel_scan_bench").string();
+    std::filesystem::remove_all(data_dir);
+    std::filesystem::create_directories(data_dir);
+    load_table(data_dir);
+
+    {
+        MetadataManager metadata(data_dir);
+        WriteAheadLog wal(data_dir + "/wal.log", WalSyncMode::OFF, 0);
+        BufferPool pool(SCAN_POOL_BYTES);
+        pool.set_write_ahead_log(&wal);
+        TableStorage table("events", &metadata, &pool, &wal);
+
+        uintmax_t table_bytes = std::filesystem::file_size(table.get_file_path());
+        size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        std::cout << ROW_COUNT << " rows, " << table_bytes / (1024 * 1024) << " MB table, "
+                  << SCAN_POOL_BYTES / (1024 * 1024) << " MB buffer pool, " << cores << " cores:\n";
+
+        std::vector<size_t> thread_counts = {1, 2, 4, 8};
+        if (std::find(thread_counts.begin(), thread_counts.end(), cores) == thread_counts.end()) {
+            thread_counts.push_back(cores);
+        }
+        double single = 0;
+        for (size_t threads : thread_counts) {
+            size_t rows = 0;
+            double ms = time_scan(table, metadata.get_columns("events"), threads, rows);
+            if (threads == 1) {
+                single = ms;
+            }
+            std::cout << "  " << std::setw(2) << threads << " threads" << std::fixed << std::setprecision(1)
+                      << std::setw(10) << ms << " ms" << std::setprecision(2) << std::setw(8) << single / ms
+                      << "x  (" << rows << " rows)\n";
+        }
+    }
+
+    std::filesystem::remove_all(data_dir);
+    return 0;
+}
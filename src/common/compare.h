@@ -0,0 +1,78 @@
+#ifndef COMPARE_H
+#define COMPARE_H
+
+#include "types.h"
+#include <string_view>
+
+namespace sqldb {
+
+// Applies a comparison operator token to two values of the same type
+template <typename T>
+bool compare_ordered(const T& left, const T& right, TokenType op) {
+    switch (op) {
+        case TokenType::EQUALS:
+            return left == right;
+        case TokenType::NOT_EQUALS:
+            return left != right;
+        case TokenType::LESS_THAN:
+            return left < right;
+        case TokenType::GREATER_THAN:
+            return left > right;
+        case TokenType::LESS_EQUAL:
+            return left <= right;
+        case TokenType::GREATER_EQUAL:
+            return left >= right;
+        default:
+            return false;
+    }
+}
+
+// SQL LIKE: '%' matches any run of characters, '_' exactly one
+inline bool like_matches(std::string_view text, std::string_view pattern) {
+    // Greedy match that backtracks only to the most recent '%'
+    size_t t = 0;
+    size_t p = 0;
+    size_t star = std::string_view::npos;
+    size_t star_text = 0;
+    while (t < text.size()) {
+        if (p < pattern.size() && (pattern[p] == '_' || (pattern[p] != '%' && pattern[p] == text[t]))) {
+            t++;
+            p++;
+        } else if (p < pattern.size() && pattern[p] == '%') {
+            star = p++;
+            star_text = t;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            t = ++star_text;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '%') {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+// The characters every match of a LIKE pattern starts with
+inline std::string_view like_prefix(std::string_view pattern) {
+    return pattern.substr(0, pattern.find_first_of("%_"));
+}
+
+// True for 'prefix%', which a prefix lookup answers without further checks
+inline bool like_is_prefix_only(std::string_view pattern) {
+    std::string_view prefix = like_prefix(pattern);
+    return prefix.size() + 1 == pattern.size() && pattern.back() == '%';
+}
+
+// Text comparisons also understand LIKE
+inline bool compare_ordered(std::string_view left, std::string_view right, TokenType op) {
+    if (op == TokenType::LIKE) {
+        return like_matches(left, right);
+    }
+    return compare_ordered<std::string_view>(left, right, op);
+}
+
+} // namespace sqldb
+
+#endif // COMPARE_H
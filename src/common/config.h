@@ -0,0 +1,46 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <cstddef>
+#include <string>
+
+namespace sqldb {
+
+// How table scans read pages
+enum class ScanMode {
+    BUFFERED,   // Through the shared buffer pool
+    MMAP        // Directly from a read-only mapping of the table file
+};
+
+// When committed log records reach stable storage
+enum class WalSyncMode {
+    OFF,      // Written to the OS lazily, never fsynced
+    NORMAL,   // Written to the OS on commit, fsynced in groups by a background thread
+    FULL      // Commit waits for fsync; concurrent commits share one fsync
+};
+
+// Engine-wide settings, filled from command line options in main
+struct DatabaseConfig {
+    std::string data_directory = "data";
+
+    // Memory budget for cached table pages
+    size_t buffer_pool_bytes = 64 * 1024 * 1024;
+
+    ScanMode scan_mode = ScanMode::BUFFERED;
+
+    // Worker threads for scans of large row tables; 0 uses one per CPU core
+    size_t scan_threads = 0;
+
+    // Write-ahead log durability and the group sync period for NORMAL mode
+    WalSyncMode wal_sync_mode = WalSyncMode::NORMAL;
+    int wal_sync_interval_ms = 10;
+
+    // Open table handles kept between statements, and the most table files
+    // the buffer pool keeps open at once
+    size_t table_cache_size = 64;
+    size_t max_open_files = 256;
+};
+
+} // namespace sqldb
+
+#endif // CONFIG_H
@@ -1,6 +1,7 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+#include <cstddef>
 #include <string>
 #include <vector>
 #include <memory>
@@ -26,6 +27,17 @@ enum class TokenType {
     FROM,
     WHERE,
     VALUES,
+    WITH,
+    INDEX,
+    ON,
+    UNIQUE,
+    USING,
+    INCLUDE,
+    LIMIT,
+    AND,
+    OR,
+    IN,
+    BETWEEN,
     
     // Data types
     INTEGER,
@@ -45,6 +57,7 @@ enum class TokenType {
     GREATER_THAN,
     LESS_EQUAL,
     GREATER_EQUAL,
+    LIKE,
     
     // Punctuation
     SEMICOLON,
@@ -65,6 +78,21 @@ enum class DataType {
     BOOLEAN
 };
 
+// Physical layout of a table's rows
+enum class StorageType {
+    ROW,     // Slotted pages, one record per row
+    COLUMN,  // One segment file per column
+    LSM      // Memtable and sorted runs, for write-heavy tables
+};
+
+// Structure behind an index
+enum class IndexMethod {
+    BTREE,   // On-disk B+tree, answers equality and ranges
+    HASH,    // In-memory hash table, answers equality only
+    BITMAP,  // In-memory bitmap per distinct value, for low-cardinality columns
+    ART      // In-memory radix tree over VARCHAR, answers equality and prefixes
+};
+
 // Column constraints
 enum class ConstraintType {
     PRIMARY_KEY,
@@ -92,17 +120,33 @@ struct Column {
     int varchar_length;  // Only used for VARCHAR
     bool is_primary_key;
     bool is_not_null;
+    bool has_bloom_filter;  // From CREATE TABLE ... WITH (bloom = column)
     
     Column(const std::string& n, DataType t, int len = 0, bool pk = false, bool nn = false)
-        : name(n), type(t), varchar_length(len), is_primary_key(pk), is_not_null(nn) {}
+        : name(n), type(t), varchar_length(len), is_primary_key(pk), is_not_null(nn), has_bloom_filter(false) {}
+};
+
+// Secondary index created with CREATE INDEX
+struct IndexDefinition {
+    std::string name;
+    std::string column_name;
+    bool is_unique;
+    IndexMethod method;
+    std::vector<std::string> include_columns;  // Stored beside the key, B+tree only
+    
+    IndexDefinition(const std::string& n, const std::string& col, bool unique = false,
+                    IndexMethod m = IndexMethod::BTREE)
+        : name(n), column_name(col), is_unique(unique), method(m) {}
 };
 
 // Table schema
 struct TableSchema {
     std::string name;
     std::vector<Column> columns;
+    StorageType storage;
+    std::vector<IndexDefinition> indexes;
     
-    TableSchema(const std::string& n) : name(n) {}
+    TableSchema(const std::string& n) : name(n), storage(StorageType::ROW) {}
 };
 
 // Row data
@@ -118,12 +162,42 @@ struct WhereCondition {
         : column_name(col), operator_type(op), value(val) {}
 };
 
+// WHERE clause: comparisons and IN lists combined with AND, OR and NOT.
+// BETWEEN is parsed into an AND of two comparisons.
+struct WhereExpression {
+    enum class Kind {
+        COMPARISON,
+        IN,
+        AND,
+        OR,
+        NOT
+    };
+    
+    Kind kind;
+    std::unique_ptr<WhereCondition> comparison;  // COMPARISON
+    std::string column_name;                     // IN
+    std::vector<Value> values;                   // IN
+    std::vector<std::unique_ptr<WhereExpression>> children;  // AND, OR, NOT
+    
+    explicit WhereExpression(Kind k) : kind(k) {}
+};
+
+// Table option from CREATE TABLE ... WITH (name = value, ...)
+struct TableOption {
+    std::string name;
+    std::string value;
+    
+    TableOption(const std::string& n, const std::string& v) : name(n), value(v) {}
+};
+
 // SQL Statement types
 enum class StatementType {
     CREATE_TABLE,
     DROP_TABLE,
     INSERT,
-    SELECT
+    SELECT,
+    CREATE_INDEX,
+    DROP_INDEX
 };
 
 // Base SQL statement
@@ -136,6 +210,7 @@ struct Statement {
 struct CreateTableStatement : public Statement {
     std::string table_name;
     std::vector<Column> columns;
+    std::vector<TableOption> options;
     
     CreateTableStatement() { type = StatementType::CREATE_TABLE; }
 };
@@ -155,13 +230,35 @@ struct DropTableStatement : public Statement {
     DropTableStatement() { type = StatementType::DROP_TABLE; }
 };
 
+// CREATE [UNIQUE] INDEX statement
+struct CreateIndexStatement : public Statement {
+    std::string index_name;
+    std::string table_name;
+    std::string column_name;
+    bool is_unique;
+    std::string method;  // From USING, empty for the default
+    std::vector<std::string> include_columns;
+    
+    CreateIndexStatement() : is_unique(false) { type = StatementType::CREATE_INDEX; }
+};
+
+// DROP INDEX statement
+struct DropIndexStatement : public Statement {
+    std::string index_name;
+    
+    DropIndexStatement() { type = StatementType::DROP_INDEX; }
+};
+
 // SELECT statement
 struct SelectStatement : public Statement {
     std::string table_name;
     bool select_all;
-    std::unique_ptr<WhereCondition> where_condition;
+    std::vector<std::string> column_names;  // When not SELECT *
+    std::unique_ptr<WhereExpression> where_clause;
+    bool has_limit;
+    size_t limit;
     
-    SelectStatement() : select_all(true), where_condition(nullptr) { 
+    SelectStatement() : select_all(true), where_clause(nullptr), has_limit(false), limit(0) { 
         type = StatementType::SELECT; 
     }
 };
@@ -0,0 +1,65 @@
+#include "operators.h"
+#include <algorithm>
+
+namespace sqldb {
+
+ScanOperator::ScanOperator(TableEngine* engine, const std::vector<Column>& schema, const WhereCondition* condition,
+                           const std::vector<int>* columns)
+    : engine(engine), schema(schema), has_columns(columns != nullptr) {
+    if (condition) {
+        this->condition = std::make_unique<WhereCondition>(*condition);
+    }
+    if (columns) {
+        this->columns = *columns;
+    }
+}
+
+void ScanOperator::open() {
+    cursor = engine->open_cursor(condition.get(), has_columns ? &columns : nullptr);
+}
+
+bool ScanOperator::next(ColumnBatch& batch, size_t max_rows) {
+    // Operators above may have reshaped the batch
+    batch.reset(schema, has_columns ? &columns : nullptr);
+    return cursor->next_columns(batch, max_rows) > 0;
+}
+
+bool FilterOperator::next(ColumnBatch& batch, size_t max_rows) {
+    // Keep pulling until something passes, so an empty batch means the end
+    while (child->next(batch, max_rows)) {
+        predicate->filter(batch, batch.get_selection());
+        if (!batch.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void LimitOperator::open() {
+    produced = 0;
+    child->open();
+}
+
+bool LimitOperator::next(ColumnBatch& batch, size_t max_rows) {
+    // Only ask for what is still wanted, so the scan reads no further
+    if (produced >= limit) {
+        batch.clear();
+        return false;
+    }
+    if (!child->next(batch, std::min(max_rows, limit - produced))) {
+        return false;
+    }
+    batch.truncate(limit - produced);
+    produced += batch.size();
+    return true;
+}
+
+bool ProjectOperator::next(ColumnBatch& batch, size_t max_rows) {
+    if (!child->next(batch, max_rows)) {
+        return false;
+    }
+    batch.project(columns);
+    return true;
+}
+
+} // namespace sqldb
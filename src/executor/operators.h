@@ -0,0 +1,108 @@
+#ifndef OPERATORS_H
+#define OPERATORS_H
+
+#include "../common/types.h"
+#include "../storage/column_batch.h"
+#include "../storage/row_codec.h"
+#include "../storage/table_engine.h"
+#include "predicate.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace sqldb {
+
+// Physical operator of a SELECT plan. A plan is a chain of operators, each
+// pulling batches of rows from the one below it: open() prepares, next()
+// produces, close() releases. Rows are filtered, cut off and projected as
+// they stream through, so only the batch in flight is held in memory.
+//
+// Batches are column vectors with a selection vector (see ColumnBatch):
+// operators work a column at a time and drop rows by shrinking the
+// selection, so no per-row variant is built between the scan and the output.
+class Operator {
+public:
+    virtual ~Operator() = default;
+
+    virtual void open() = 0;
+
+    // Replaces batch with up to max_rows selected rows; returns false,
+    // leaving batch empty, once the input is exhausted
+    virtual bool next(ColumnBatch& batch, size_t max_rows) = 0;
+
+    virtual void close() = 0;
+};
+
+// Leaf of every plan: streams a table through the engine's cursor. The
+// condition is evaluated by the engine, which may answer it from an index;
+// columns, when given, are the only ones read above the scan and the only
+// ones decoded.
+class ScanOperator : public Operator {
+private:
+    TableEngine* engine;
+    std::vector<Column> schema;
+    std::unique_ptr<WhereCondition> condition;
+    bool has_columns;
+    std::vector<int> columns;
+    std::unique_ptr<TableCursor> cursor;
+
+public:
+    ScanOperator(TableEngine* engine, const std::vector<Column>& schema, const WhereCondition* condition,
+                 const std::vector<int>* columns);
+
+    void open() override;
+    bool next(ColumnBatch& batch, size_t max_rows) override;
+    void close() override { cursor.reset(); }
+};
+
+// Drops the rows that fail the part of the WHERE clause the scan did not
+// take; the columns it reads must be ones the scan loads
+class FilterOperator : public Operator {
+private:
+    std::unique_ptr<Operator> child;
+    std::unique_ptr<Predicate> predicate;
+
+public:
+    FilterOperator(std::unique_ptr<Operator> child, std::unique_ptr<Predicate> predicate)
+        : child(std::move(child)), predicate(std::move(predicate)) {}
+
+    void open() override { child->open(); }
+    bool next(ColumnBatch& batch, size_t max_rows) override;
+    void close() override { child->close(); }
+};
+
+// Passes on the first limit rows, then stops pulling from its input
+class LimitOperator : public Operator {
+private:
+    std::unique_ptr<Operator> child;
+    size_t limit;
+    size_t produced;
+
+public:
+    LimitOperator(std::unique_ptr<Operator> child, size_t limit)
+        : child(std::move(child)), limit(limit), produced(0) {}
+
+    void open() override;
+    bool next(ColumnBatch& batch, size_t max_rows) override;
+    void close() override { child->close(); }
+};
+
+// Reorders the columns to the select list, by column ordinal; a column may
+// appear more than once
+class ProjectOperator : public Operator {
+private:
+    std::unique_ptr<Operator> child;
+    std::vector<int> columns;
+
+public:
+    ProjectOperator(std::unique_ptr<Operator> child, const std::vector<int>& columns)
+        : child(std::move(child)), columns(columns) {}
+
+    void open() override { child->open(); }
+    bool next(ColumnBatch& batch, size_t max_rows) override;
+    void close() override { child->close(); }
+};
+
+} // namespace sqldb
+
+#endif // OPERATORS_H
@@ -0,0 +1,340 @@
+#include "predicate.h"
+#include "../common/compare.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace sqldb {
+
+namespace {
+
+// Weight of the guessed pass rate, in rows, against the rows seen
+constexpr double PRIOR_ROWS = 1024;
+
+// Past this many rows the counts are halved, so older batches fade out
+constexpr uint64_t DECAY_ROWS = 64 * 1024;
+
+TokenType negate_operator(TokenType op) {
+    switch (op) {
+        case TokenType::EQUALS:
+            return TokenType::NOT_EQUALS;
+        case TokenType::NOT_EQUALS:
+            return TokenType::EQUALS;
+        case TokenType::LESS_THAN:
+            return TokenType::GREATER_EQUAL;
+        case TokenType::GREATER_EQUAL:
+            return TokenType::LESS_THAN;
+        case TokenType::GREATER_THAN:
+            return TokenType::LESS_EQUAL;
+        case TokenType::LESS_EQUAL:
+            return TokenType::GREATER_THAN;
+        default:
+            throw std::runtime_error("Operator cannot be negated");
+    }
+}
+
+// Integer and boolean columns go through the vector kernels; strings are
+// compared one by one, and a general LIKE pattern may backtrack
+double comparison_cost(const BoundCondition& condition) {
+    if (condition.type != DataType::VARCHAR) {
+        return 1;
+    }
+    if (condition.operator_type == TokenType::LIKE && !like_is_prefix_only(std::get<std::string>(condition.value))) {
+        return 16;
+    }
+    return 4;
+}
+
+double comparison_estimate(const BoundCondition& condition) {
+    double equal = condition.type == DataType::BOOLEAN ? 0.5 : 0.1;
+    switch (condition.operator_type) {
+        case TokenType::EQUALS:
+            return equal;
+        case TokenType::NOT_EQUALS:
+            return 1 - equal;
+        case TokenType::LIKE:
+            return 0.25;
+        default:
+            return 0.33;
+    }
+}
+
+// Rank of a conjunct for evaluating it before the others: rows dropped per
+// unit of work
+double conjunct_rank(double pass_rate, double cost) {
+    return (1 - pass_rate) / cost;
+}
+
+// Which conjunct a scan should take: one the engine can answer from an index
+// over any other, then the best ranked
+double scan_preference(const BoundCondition& condition, const std::vector<bool>& indexed) {
+    double preference = conjunct_rank(comparison_estimate(condition), comparison_cost(condition));
+    bool indexable = condition.operator_type != TokenType::NOT_EQUALS &&
+                     (condition.operator_type != TokenType::LIKE ||
+                      !like_prefix(std::get<std::string>(condition.value)).empty());
+    if (indexable && indexed[condition.column_index]) {
+        preference += 1;
+    }
+    return preference;
+}
+
+} // namespace
+
+Predicate::Predicate(Kind kind)
+    : kind(kind), condition{}, in_list{}, cost(1), estimate(1), rows_in(0), rows_out(0) {}
+
+std::unique_ptr<Predicate> Predicate::bind(const WhereExpression& expression, const RowCodec& codec) {
+    return bind_node(expression, codec, false);
+}
+
+std::unique_ptr<Predicate> Predicate::bind_node(const WhereExpression& expression, const RowCodec& codec,
+                                                bool negate) {
+    switch (expression.kind) {
+        case WhereExpression::Kind::COMPARISON: {
+            auto predicate = std::unique_ptr<Predicate>(new Predicate(Kind::COMPARISON));
+            predicate->condition = codec.bind(*expression.comparison);
+            // LIKE has no opposite operator, so it keeps its NOT
+            bool keep_not = negate && predicate->condition.operator_type == TokenType::LIKE;
+            if (negate && !keep_not) {
+                predicate->condition.operator_type = negate_operator(predicate->condition.operator_type);
+            }
+            predicate->cost = comparison_cost(predicate->condition);
+            predicate->estimate = comparison_estimate(predicate->condition);
+            return keep_not ? make_not(std::move(predicate)) : std::move(predicate);
+        }
+        case WhereExpression::Kind::IN: {
+            int column_index = codec.get_column_index(expression.column_name);
+            if (column_index < 0) {
+                throw std::runtime_error("Column '" + expression.column_name + "' does not exist");
+            }
+            auto predicate = std::unique_ptr<Predicate>(new Predicate(Kind::IN));
+            InList& list = predicate->in_list;
+            list.column_index = column_index;
+            list.type = codec.get_columns()[column_index].type;
+            for (const Value& value : expression.values) {
+                if (std::holds_alternative<int>(value)) {
+                    list.integers.push_back(std::get<int>(value));
+                } else if (std::holds_alternative<std::string>(value)) {
+                    list.varchars.push_back(std::get<std::string>(value));
+                } else {
+                    (std::get<bool>(value) ? list.has_true : list.has_false) = true;
+                }
+            }
+            std::sort(list.integers.begin(), list.integers.end());
+            list.integers.erase(std::unique(list.integers.begin(), list.integers.end()), list.integers.end());
+            std::sort(list.varchars.begin(), list.varchars.end());
+            list.varchars.erase(std::unique(list.varchars.begin(), list.varchars.end()), list.varchars.end());
+
+            switch (list.type) {
+                case DataType::INTEGER:
+                    predicate->cost = std::clamp<double>(list.integers.size(), 1, 8);
+                    predicate->estimate = std::min(0.1 * list.integers.size(), 0.9);
+                    break;
+                case DataType::VARCHAR:
+                    predicate->cost = 6;
+                    predicate->estimate = std::min(0.1 * list.varchars.size(), 0.9);
+                    break;
+                case DataType::BOOLEAN:
+                    predicate->cost = 1;
+                    predicate->estimate = 0.5 * (list.has_true + list.has_false);
+                    break;
+            }
+            return negate ? make_not(std::move(predicate)) : std::move(predicate);
+        }
+        case WhereExpression::Kind::NOT:
+            return bind_node(*expression.children[0], codec, !negate);
+        case WhereExpression::Kind::AND:
+        case WhereExpression::Kind::OR: {
+            bool is_and = (expression.kind == WhereExpression::Kind::AND) != negate;
+            std::vector<std::unique_ptr<Predicate>> children;
+            for (const auto& child : expression.children) {
+                children.push_back(bind_node(*child, codec, negate));
+            }
+            return make_junction(is_and ? Kind::AND : Kind::OR, std::move(children));
+        }
+    }
+    throw std::runtime_error("Unknown WHERE expression");
+}
+
+std::unique_ptr<Predicate> Predicate::make_junction(Kind kind, std::vector<std::unique_ptr<Predicate>> children) {
+    auto predicate = std::unique_ptr<Predicate>(new Predicate(kind));
+    for (auto& child : children) {
+        if (child->kind == kind) {
+            for (auto& grandchild : child->children) {
+                predicate->children.push_back(std::move(grandchild));
+            }
+        } else {
+            predicate->children.push_back(std::move(child));
+        }
+    }
+    if (predicate->children.size() == 1) {
+        return std::move(predicate->children[0]);
+    }
+
+    // Every child may have to run; AND passes what all pass, OR what any does
+    predicate->cost = 0;
+    double all_pass = 1;
+    double none_pass = 1;
+    for (const auto& child : predicate->children) {
+        predicate->cost += child->cost;
+        all_pass *= child->estimate;
+        none_pass *= 1 - child->estimate;
+    }
+    predicate->estimate = kind == Kind::AND ? all_pass : 1 - none_pass;
+    return predicate;
+}
+
+std::unique_ptr<Predicate> Predicate::make_not(std::unique_ptr<Predicate> child) {
+    auto predicate = std::unique_ptr<Predicate>(new Predicate(Kind::NOT));
+    predicate->cost = child->cost;
+    predicate->estimate = 1 - child->estimate;
+    predicate->children.push_back(std::move(child));
+    return predicate;
+}
+
+bool Predicate::take_scan_condition(std::unique_ptr<Predicate>& predicate, const std::vector<bool>& indexed,
+                                    BoundCondition& condition) {
+    if (!predicate) {
+        return false;
+    }
+    if (predicate->kind == Kind::COMPARISON) {
+        condition = predicate->condition;
+        predicate.reset();
+        return true;
+    }
+    if (predicate->kind != Kind::AND) {
+        return false;
+    }
+
+    // Ties go to the conjunct written first
+    std::vector<std::unique_ptr<Predicate>>& children = predicate->children;
+    int best = -1;
+    double best_preference = -1;
+    for (size_t i = 0; i < children.size(); i++) {
+        if (children[i]->kind == Kind::COMPARISON) {
+            double preference = scan_preference(children[i]->condition, indexed);
+            if (preference > best_preference) {
+                best = static_cast<int>(i);
+                best_preference = preference;
+            }
+        }
+    }
+    if (best < 0) {
+        return false;
+    }
+    condition = children[best]->condition;
+    children.erase(children.begin() + best);
+    predicate = make_junction(Kind::AND, std::move(children));
+    return true;
+}
+
+void Predicate::collect_columns(std::vector<int>& columns) const {
+    switch (kind) {
+        case Kind::COMPARISON:
+            columns.push_back(condition.column_index);
+            break;
+        case Kind::IN:
+            columns.push_back(in_list.column_index);
+            break;
+        default:
+            for (const auto& child : children) {
+                child->collect_columns(columns);
+            }
+            break;
+    }
+}
+
+double Predicate::pass_rate() const {
+    return (rows_out + estimate * PRIOR_ROWS) / (rows_in + PRIOR_ROWS);
+}
+
+void Predicate::reorder_children() {
+    // An AND wants the children that drop the most rows per unit of work
+    // first, an OR those that keep the most
+    bool is_and = kind == Kind::AND;
+    auto rank = [is_and](const Predicate& child) {
+        return is_and ? conjunct_rank(child.pass_rate(), child.cost) : child.pass_rate() / child.cost;
+    };
+    std::stable_sort(children.begin(), children.end(),
+                     [&rank](const std::unique_ptr<Predicate>& a, const std::unique_ptr<Predicate>& b) {
+                         return rank(*a) > rank(*b);
+                     });
+}
+
+void Predicate::filter(const ColumnBatch& batch, std::vector<uint32_t>& selection) {
+    if (selection.empty()) {
+        return;
+    }
+    size_t before = selection.size();
+    switch (kind) {
+        case Kind::COMPARISON:
+            filter_column(batch.column(condition.column_index), condition, selection);
+            break;
+        case Kind::IN:
+            filter_column_in(batch.column(in_list.column_index), in_list, selection);
+            break;
+        case Kind::AND:
+            filter_and(batch, selection);
+            break;
+        case Kind::OR:
+            filter_or(batch, selection);
+            break;
+        case Kind::NOT:
+            filter_not(batch, selection);
+            break;
+    }
+
+    rows_in += before;
+    rows_out += selection.size();
+    if (rows_in > DECAY_ROWS) {
+        rows_in /= 2;
+        rows_out /= 2;
+    }
+}
+
+void Predicate::filter_and(const ColumnBatch& batch, std::vector<uint32_t>& selection) {
+    for (auto& child : children) {
+        child->filter(batch, selection);
+        if (selection.empty()) {
+            break;
+        }
+    }
+    reorder_children();
+}
+
+void Predicate::filter_or(const ColumnBatch& batch, std::vector<uint32_t>& selection) {
+    // Each child only sees the rows no earlier child matched; the matches
+    // are merged back in position order
+    remaining.assign(selection.begin(), selection.end());
+    selection.clear();
+    for (auto& child : children) {
+        candidates.assign(remaining.begin(), remaining.end());
+        child->filter(batch, candidates);
+        if (candidates.empty()) {
+            continue;
+        }
+        merged.clear();
+        std::merge(selection.begin(), selection.end(), candidates.begin(), candidates.end(),
+                   std::back_inserter(merged));
+        selection.swap(merged);
+        if (candidates.size() == remaining.size()) {
+            break;
+        }
+        merged.clear();
+        std::set_difference(remaining.begin(), remaining.end(), candidates.begin(), candidates.end(),
+                            std::back_inserter(merged));
+        remaining.swap(merged);
+    }
+    reorder_children();
+}
+
+void Predicate::filter_not(const ColumnBatch& batch, std::vector<uint32_t>& selection) {
+    candidates.assign(selection.begin(), selection.end());
+    children[0]->filter(batch, candidates);
+    merged.clear();
+    std::set_difference(selection.begin(), selection.end(), candidates.begin(), candidates.end(),
+                        std::back_inserter(merged));
+    selection.swap(merged);
+}
+
+} // namespace sqldb
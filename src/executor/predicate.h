@@ -0,0 +1,90 @@
+#ifndef PREDICATE_H
+#define PREDICATE_H
+
+#include "../common/types.h"
+#include "../storage/column_batch.h"
+#include "../storage/row_codec.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace sqldb {
+
+// A WHERE clause bound to a table's columns and evaluated on column batches,
+// by narrowing a selection vector node by node.
+//
+// Evaluation short-circuits: the children of an AND only see the rows every
+// child before them kept, and those of an OR only the rows no child before
+// them matched. Children are ordered so that cheap, selective ones go first.
+// The order starts from a guess made from each node's operator and type and
+// is revised after every batch from the pass rates actually seen.
+class Predicate {
+public:
+    enum class Kind {
+        COMPARISON,
+        IN,
+        AND,
+        OR,
+        NOT
+    };
+
+private:
+    Kind kind;
+    BoundCondition condition;  // COMPARISON
+    InList in_list;            // IN
+    std::vector<std::unique_ptr<Predicate>> children;
+
+    // Relative work per row, and the fraction of rows expected to pass
+    // before any has been seen
+    double cost;
+    double estimate;
+
+    // Rows in and out so far, decayed so the rate follows the data
+    uint64_t rows_in;
+    uint64_t rows_out;
+
+    // Scratch selections, kept between batches
+    std::vector<uint32_t> remaining;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> merged;
+
+    explicit Predicate(Kind kind);
+
+    static std::unique_ptr<Predicate> bind_node(const WhereExpression& expression, const RowCodec& codec,
+                                                bool negate);
+    static std::unique_ptr<Predicate> make_junction(Kind kind, std::vector<std::unique_ptr<Predicate>> children);
+    static std::unique_ptr<Predicate> make_not(std::unique_ptr<Predicate> child);
+
+    double pass_rate() const;
+    void reorder_children();
+    void filter_and(const ColumnBatch& batch, std::vector<uint32_t>& selection);
+    void filter_or(const ColumnBatch& batch, std::vector<uint32_t>& selection);
+    void filter_not(const ColumnBatch& batch, std::vector<uint32_t>& selection);
+
+public:
+    // Binds a parsed WHERE clause. NOT is pushed down onto the comparisons
+    // (NOT a < 5 becomes a >= 5, NOT over AND or OR follows De Morgan), and
+    // nested ANDs and ORs are flattened. Throws for unknown columns.
+    static std::unique_ptr<Predicate> bind(const WhereExpression& expression, const RowCodec& codec);
+
+    // Removes the comparison a scan should evaluate, so the engine can answer
+    // it from an index, zone map or Bloom filter: the whole predicate when it
+    // is one comparison, else the most useful conjunct of a top-level AND.
+    // indexed is indexed by column ordinal. Returns false when nothing can be
+    // taken; predicate is left null when nothing remains.
+    static bool take_scan_condition(std::unique_ptr<Predicate>& predicate, const std::vector<bool>& indexed,
+                                    BoundCondition& condition);
+
+    Kind get_kind() const { return kind; }
+
+    // Appends the ordinals of the columns the predicate reads
+    void collect_columns(std::vector<int>& columns) const;
+
+    // Narrows selection to the rows of batch that satisfy the predicate; the
+    // columns it reads must be loaded
+    void filter(const ColumnBatch& batch, std::vector<uint32_t>& selection);
+};
+
+} // namespace sqldb
+
+#endif // PREDICATE_H
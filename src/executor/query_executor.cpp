@@ -2,88 +2,356 @@
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <set>
+#include <thread>
 
 namespace sqldb {
 
-QueryExecutor::QueryExecutor(const std::string& data_directory) {
-    metadata_manager = std::make_unique<MetadataManager>(data_directory);
+// Rows pulled through the plan per round trip while streaming SELECT output
+constexpr size_t SELECT_BATCH_SIZE = 1024;
+
+QueryExecutor::QueryExecutor(const DatabaseConfig& config) : config(config) {
+    if (this->config.scan_threads == 0) {
+        this->config.scan_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    metadata_manager = std::make_unique<MetadataManager>(config.data_directory);
+    wal = std::make_unique<WriteAheadLog>(config.data_directory + "/wal.log", config.wal_sync_mode,
+                                          config.wal_sync_interval_ms);
+    buffer_pool = std::make_unique<BufferPool>(config.buffer_pool_bytes, config.max_open_files);
+    buffer_pool->set_write_ahead_log(wal.get());
+    recover();
+}
+
+QueryExecutor::~QueryExecutor() {
+    try {
+        wal->checkpoint(buffer_pool.get());
+    } catch (const std::exception& e) {
+        // The log is kept and replayed on the next start
+    }
+}
+
+TableEngine* QueryExecutor::get_table_engine(const std::string& table_name) {
+    auto it = table_cache.find(table_name);
+    if (it != table_cache.end()) {
+        table_lru.splice(table_lru.begin(), table_lru, it->second.lru_position);
+        return it->second.engine.get();
+    }
+    
+    auto engine = open_table_engine(table_name, metadata_manager.get(), buffer_pool.get(), wal.get());
+    TableEngine* handle = engine.get();
+    
+    if (table_cache.size() >= config.table_cache_size && !table_lru.empty()) {
+        table_cache.erase(table_lru.back());
+        table_lru.pop_back();
+    }
+    table_lru.push_front(table_name);
+    table_cache[table_name] = CachedTable{std::move(engine), table_lru.begin()};
+    return handle;
+}
+
+void QueryExecutor::evict_table_engine(const std::string& table_name) {
+    auto it = table_cache.find(table_name);
+    if (it == table_cache.end()) {
+        return;
+    }
+    table_lru.erase(it->second.lru_position);
+    table_cache.erase(it);
+}
+
+void QueryExecutor::recover() {
+    std::set<std::string> replayed_tables;
+    wal->replay([&](const WalRecord& record) {
+        // Tables are dropped only after a checkpoint, so a missing table
+        // has no pending records worth keeping
+        if (!metadata_manager->table_exists(record.table_name)) {
+            return;
+        }
+        get_table_engine(record.table_name)->redo_insert(record.page_no, record.payload, record.lsn);
+        replayed_tables.insert(record.table_name);
+    });
+    
+    // Index pages written before the crash may not match the replayed rows
+    for (const std::string& table_name : replayed_tables) {
+        get_table_engine(table_name)->rebuild_indexes();
+    }
+    
+    wal->checkpoint(buffer_pool.get());
 }
 
 std::string QueryExecutor::execute(std::unique_ptr<Statement> statement) {
+    std::ostringstream result;
+    execute(std::move(statement), result);
+    return result.str();
+}
+
+void QueryExecutor::execute(std::unique_ptr<Statement> statement, std::ostream& out) {
     if (!statement) {
-        return "Error: Null statement";
+        out << "Error: Null statement";
+        return;
     }
     
     try {
         switch (statement->type) {
             case StatementType::CREATE_TABLE:
-                return execute_create_table(*static_cast<CreateTableStatement*>(statement.get()));
+                out << execute_create_table(*static_cast<CreateTableStatement*>(statement.get()));
+                break;
             case StatementType::DROP_TABLE:
-                return execute_drop_table(*static_cast<DropTableStatement*>(statement.get()));
+                out << execute_drop_table(*static_cast<DropTableStatement*>(statement.get()));
+                break;
             case StatementType::INSERT:
-                return execute_insert(*static_cast<InsertStatement*>(statement.get()));
+                out << execute_insert(*static_cast<InsertStatement*>(statement.get()));
+                break;
             case StatementType::SELECT:
-                return execute_select(*static_cast<SelectStatement*>(statement.get()));
+                execute_select(*static_cast<SelectStatement*>(statement.get()), out);
+                break;
+            case StatementType::CREATE_INDEX:
+                out << execute_create_index(*static_cast<CreateIndexStatement*>(statement.get()));
+                break;
+            case StatementType::DROP_INDEX:
+                out << execute_drop_index(*static_cast<DropIndexStatement*>(statement.get()));
+                break;
             default:
-                return "Error: Unknown statement type";
+                out << "Error: Unknown statement type";
+                break;
         }
     } catch (const std::exception& e) {
-        return std::string("Error: ") + e.what();
+        out << "Error: " << e.what();
     }
 }
 
 std::string QueryExecutor::execute_create_table(const CreateTableStatement& stmt) {
-    metadata_manager->create_table(stmt.table_name, stmt.columns);
+    std::vector<Column> columns = stmt.columns;
+    StorageType storage = parse_table_options(stmt.options, columns);
+    metadata_manager->create_table(stmt.table_name, columns, storage);
     return "Table '" + stmt.table_name + "' created successfully.";
 }
 
+StorageType QueryExecutor::parse_table_options(const std::vector<TableOption>& options,
+                                               std::vector<Column>& columns) {
+    StorageType storage = StorageType::ROW;
+    bool has_bloom_filter = false;
+    
+    for (const TableOption& option : options) {
+        if (option.name == "bloom") {
+            // One column per option; repeat it for more
+            auto it = std::find_if(columns.begin(), columns.end(),
+                                   [&](const Column& column) { return column.name == option.value; });
+            if (it == columns.end()) {
+                throw std::runtime_error("Bloom filter column '" + option.value + "' does not exist");
+            }
+            it->has_bloom_filter = true;
+            has_bloom_filter = true;
+            continue;
+        }
+        if (option.name != "storage") {
+            throw std::runtime_error("Unknown table option: " + option.name);
+        }
+        
+        std::string value = option.value;
+        std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+        if (value == "row") {
+            storage = StorageType::ROW;
+        } else if (value == "column") {
+            storage = StorageType::COLUMN;
+        } else if (value == "lsm") {
+            storage = StorageType::LSM;
+        } else {
+            throw std::runtime_error("Unknown storage type: " + option.value + " (expected row, column or lsm)");
+        }
+    }
+    
+    if (has_bloom_filter && storage != StorageType::ROW) {
+        throw std::runtime_error("Bloom filters are only available for row tables");
+    }
+    
+    return storage;
+}
+
+IndexMethod QueryExecutor::parse_index_method(const std::string& method) {
+    if (method.empty() || method == "btree") {
+        return IndexMethod::BTREE;
+    }
+    if (method == "hash") {
+        return IndexMethod::HASH;
+    }
+    if (method == "bitmap") {
+        return IndexMethod::BITMAP;
+    }
+    if (method == "art") {
+        return IndexMethod::ART;
+    }
+    throw std::runtime_error("Unknown index method: " + method + " (expected btree, hash, bitmap or art)");
+}
+
 std::string QueryExecutor::execute_drop_table(const DropTableStatement& stmt) {
     // Validate table exists before dropping
     metadata_manager->validate_table_name(stmt.table_name);
     
+    // Make logged inserts durable in their table files so the log no longer
+    // refers to this table, then forget cached pages before the file goes away
+    wal->checkpoint(buffer_pool.get());
+    get_table_engine(stmt.table_name)->delete_table_files();
+    evict_table_engine(stmt.table_name);
+    
     // Drop the table
     metadata_manager->drop_table(stmt.table_name);
     
     return "Table '" + stmt.table_name + "' dropped successfully.";
 }
 
+std::string QueryExecutor::execute_create_index(const CreateIndexStatement& stmt) {
+    IndexDefinition index(stmt.index_name, stmt.column_name, stmt.is_unique, parse_index_method(stmt.method));
+    index.include_columns = stmt.include_columns;
+    metadata_manager->validate_new_index(stmt.table_name, index);
+    
+    // The index joins the schema only once its file is complete
+    TableEngine* engine = get_table_engine(stmt.table_name);
+    engine->create_index(index);
+    try {
+        metadata_manager->create_index(stmt.table_name, index);
+    } catch (const std::exception& e) {
+        engine->drop_index(index.name);
+        throw;
+    }
+    
+    return "Index '" + stmt.index_name + "' created on '" + stmt.table_name + "'.";
+}
+
+std::string QueryExecutor::execute_drop_index(const DropIndexStatement& stmt) {
+    std::string table_name = metadata_manager->get_index_table(stmt.index_name);
+    if (table_name.empty()) {
+        throw std::runtime_error("Index '" + stmt.index_name + "' does not exist");
+    }
+    
+    get_table_engine(table_name)->drop_index(stmt.index_name);
+    metadata_manager->drop_index(stmt.index_name);
+    
+    return "Index '" + stmt.index_name + "' dropped successfully.";
+}
+
 std::string QueryExecutor::execute_insert(const InsertStatement& stmt) {
     // Validate table exists
     metadata_manager->validate_table_name(stmt.table_name);
     
-    // Create table storage and insert row
-    TableStorage table_storage(stmt.table_name, metadata_manager.get());
-    table_storage.insert_row(stmt.values);
+    // Insert through the cached table handle
+    get_table_engine(stmt.table_name)->insert_row(stmt.values);
+    
+    // Bound the log and recovery time
+    if (wal->needs_checkpoint()) {
+        wal->checkpoint(buffer_pool.get());
+    }
     
     return "1 row inserted into '" + stmt.table_name + "'.";
 }
 
-std::string QueryExecutor::execute_select(const SelectStatement& stmt) {
+void QueryExecutor::execute_select(const SelectStatement& stmt, std::ostream& out) {
     // Validate table exists
     metadata_manager->validate_table_name(stmt.table_name);
     
     // Get table schema
-    const std::vector<Column> columns = metadata_manager->get_columns(stmt.table_name);
-    
-    // Create table storage and execute query
-    TableStorage table_storage(stmt.table_name, metadata_manager.get());
-    std::vector<Row> rows;
+    const std::vector<Column> table_columns = metadata_manager->get_columns(stmt.table_name);
+    if (table_columns.empty()) {
+        out << "No columns defined.";
+        return;
+    }
     
-    if (stmt.where_condition) {
-        rows = table_storage.select_where(*stmt.where_condition);
+    // Resolve the select list; SELECT * shows every column
+    std::vector<int> selected;
+    std::vector<Column> columns;
+    if (stmt.select_all) {
+        columns = table_columns;
     } else {
-        rows = table_storage.select_all();
+        for (const std::string& name : stmt.column_names) {
+            int column_index = metadata_manager->get_column_index(stmt.table_name, name);
+            if (column_index < 0) {
+                throw std::runtime_error("Column '" + name + "' does not exist in table '" + stmt.table_name + "'");
+            }
+            selected.push_back(column_index);
+            columns.push_back(table_columns[column_index]);
+        }
+    }
+    
+    // Rows stream through the plan a batch at a time
+    std::unique_ptr<Operator> plan = build_select_plan(stmt, selected);
+    plan->open();
+    
+    ColumnBatch batch;
+    plan->next(batch, SELECT_BATCH_SIZE);
+    
+    std::vector<size_t> widths = compute_column_widths(batch, columns);
+    write_result_header(out, columns, widths);
+    
+    size_t row_count = 0;
+    while (!batch.empty()) {
+        write_result_rows(out, batch, widths);
+        row_count += batch.size();
+        plan->next(batch, SELECT_BATCH_SIZE);
     }
+    plan->close();
     
-    return format_results(rows, columns);
+    out << row_count << " rows returned.";
 }
 
-std::string QueryExecutor::format_results(const std::vector<Row>& rows, const std::vector<Column>& columns) {
-    if (columns.empty()) {
-        return "No columns defined.";
+std::unique_ptr<Operator> QueryExecutor::build_select_plan(const SelectStatement& stmt,
+                                                           const std::vector<int>& selected) {
+    const std::vector<Column> table_columns = metadata_manager->get_columns(stmt.table_name);
+    
+    // One comparison of the WHERE clause goes to the scan, so the engine can
+    // answer it from an index; the rest is filtered above the scan
+    std::unique_ptr<Predicate> predicate;
+    std::unique_ptr<WhereCondition> scan_condition;
+    if (stmt.where_clause) {
+        metadata_manager->validate_where_clause(stmt.table_name, *stmt.where_clause);
+        predicate = Predicate::bind(*stmt.where_clause, *metadata_manager->get_row_codec(stmt.table_name));
+        
+        std::vector<bool> indexed(table_columns.size(), false);
+        for (size_t i = 0; i < table_columns.size(); i++) {
+            indexed[i] = table_columns[i].is_primary_key;
+        }
+        for (const IndexDefinition& index : metadata_manager->get_table_schema(stmt.table_name)->indexes) {
+            int column_index = metadata_manager->get_column_index(stmt.table_name, index.column_name);
+            if (column_index >= 0) {
+                indexed[column_index] = true;
+            }
+        }
+        
+        BoundCondition condition{};
+        if (Predicate::take_scan_condition(predicate, indexed, condition)) {
+            scan_condition = std::make_unique<WhereCondition>(table_columns[condition.column_index].name,
+                                                              condition.operator_type, condition.value);
+        }
+    }
+    
+    // The scan reads the selected columns and those the filter needs; naming
+    // them lets an index holding all of them stand in for the table
+    std::vector<int> scan_columns = selected;
+    if (predicate) {
+        predicate->collect_columns(scan_columns);
+        std::sort(scan_columns.begin(), scan_columns.end());
+        scan_columns.erase(std::unique(scan_columns.begin(), scan_columns.end()), scan_columns.end());
     }
     
-    // Calculate column widths
+    TableEngine* engine = get_table_engine(stmt.table_name);
+    engine->set_scan_mode(config.scan_mode);
+    engine->set_scan_threads(config.scan_threads);
+    std::unique_ptr<Operator> plan = std::make_unique<ScanOperator>(engine, table_columns, scan_condition.get(),
+                                                                    stmt.select_all ? nullptr : &scan_columns);
+    if (predicate) {
+        plan = std::make_unique<FilterOperator>(std::move(plan), std::move(predicate));
+    }
+    
+    // Limit below the projection, so rows past it are never projected
+    if (stmt.has_limit) {
+        plan = std::make_unique<LimitOperator>(std::move(plan), stmt.limit);
+    }
+    if (!stmt.select_all) {
+        plan = std::make_unique<ProjectOperator>(std::move(plan), selected);
+    }
+    return plan;
+}
+
+std::vector<size_t> QueryExecutor::compute_column_widths(const ColumnBatch& first_batch,
+                                                         const std::vector<Column>& columns) {
     std::vector<size_t> widths(columns.size());
     
     // Initialize with header widths
@@ -91,11 +359,11 @@ std::string QueryExecutor::format_results(const std::vector<Row>& rows, const st
         widths[i] = columns[i].name.length();
     }
     
-    // Calculate max width for each column based on data
-    for (const Row& row : rows) {
-        for (size_t i = 0; i < row.size() && i < columns.size(); i++) {
-            std::string formatted = format_value(row[i]);
-            widths[i] = std::max(widths[i], formatted.length());
+    // Widen for the data seen so far; later rows may overflow their column
+    for (size_t i = 0; i < first_batch.column_count() && i < columns.size(); i++) {
+        const ColumnVector& column = first_batch.column(i);
+        for (uint32_t position : first_batch.get_selection()) {
+            widths[i] = std::max(widths[i], formatted_length(column, position));
         }
     }
     
@@ -104,48 +372,64 @@ std::string QueryExecutor::format_results(const std::vector<Row>& rows, const st
         width = std::max(width, size_t(10));
     }
     
-    std::ostringstream result;
-    
+    return widths;
+}
+
+void QueryExecutor::write_result_header(std::ostream& out, const std::vector<Column>& columns,
+                                        const std::vector<size_t>& widths) {
     // Print header
-    result << "|";
+    out << "|";
     for (size_t i = 0; i < columns.size(); i++) {
-        result << " " << std::left << std::setw(widths[i]) << columns[i].name << " |";
+        out << " " << std::left << std::setw(widths[i]) << columns[i].name << " |";
     }
-    result << "\n";
+    out << "\n";
     
     // Print separator
-    result << "+";
+    out << "+";
     for (size_t i = 0; i < columns.size(); i++) {
-        result << std::string(widths[i] + 2, '-') << "+";
+        out << std::string(widths[i] + 2, '-') << "+";
     }
-    result << "\n";
-    
-    // Print data rows
-    for (const Row& row : rows) {
-        result << "|";
-        for (size_t i = 0; i < columns.size(); i++) {
-            std::string value_str;
-            if (i < row.size()) {
-                value_str = format_value(row[i]);
-            }
-            result << " " << std::left << std::setw(widths[i]) << value_str << " |";
+    out << "\n";
+}
+
+void QueryExecutor::write_result_rows(std::ostream& out, const ColumnBatch& batch,
+                                      const std::vector<size_t>& widths) {
+    // Values go from the column vectors straight to the stream
+    for (uint32_t position : batch.get_selection()) {
+        out << "|";
+        for (size_t i = 0; i < widths.size() && i < batch.column_count(); i++) {
+            out << " " << std::left << std::setw(widths[i]);
+            write_value(out, batch.column(i), position);
+            out << " |";
         }
-        result << "\n";
+        out << "\n";
     }
-    
-    result << rows.size() << " rows returned.";
-    return result.str();
 }
 
-std::string QueryExecutor::format_value(const Value& value) {
-    if (std::holds_alternative<int>(value)) {
-        return std::to_string(std::get<int>(value));
-    } else if (std::holds_alternative<std::string>(value)) {
-        return std::get<std::string>(value);
-    } else if (std::holds_alternative<bool>(value)) {
-        return std::get<bool>(value) ? "true" : "false";
+size_t QueryExecutor::formatted_length(const ColumnVector& column, size_t position) {
+    switch (column.get_type()) {
+        case DataType::INTEGER:
+            return std::to_string(column.integer_at(position)).length();
+        case DataType::VARCHAR:
+            return column.varchar_at(position).length();
+        case DataType::BOOLEAN:
+            return column.boolean_at(position) ? 4 : 5;
+    }
+    return 0;
+}
+
+void QueryExecutor::write_value(std::ostream& out, const ColumnVector& column, size_t position) {
+    switch (column.get_type()) {
+        case DataType::INTEGER:
+            out << column.integer_at(position);
+            break;
+        case DataType::VARCHAR:
+            out << column.varchar_at(position);
+            break;
+        case DataType::BOOLEAN:
+            out << (column.boolean_at(position) ? "true" : "false");
+            break;
     }
-    return "";
 }
 
 std::string QueryExecutor::get_data_type_string(DataType type, int varchar_length) {
@@ -161,6 +445,19 @@ std::string QueryExecutor::get_data_type_string(DataType type, int varchar_lengt
     }
 }
 
+std::string QueryExecutor::get_wal_sync_mode_string(WalSyncMode mode) {
+    switch (mode) {
+        case WalSyncMode::OFF:
+            return "off";
+        case WalSyncMode::NORMAL:
+            return "normal";
+        case WalSyncMode::FULL:
+            return "full";
+        default:
+            return "unknown";
+    }
+}
+
 std::string QueryExecutor::list_tables() {
     std::vector<std::string> table_names = metadata_manager->get_table_names();
     
@@ -173,7 +470,14 @@ std::string QueryExecutor::list_tables() {
     result << "=======\n";
     
     for (const std::string& table_name : table_names) {
-        result << "  " << table_name << "\n";
+        result << "  " << table_name;
+        const TableSchema* schema = metadata_manager->get_table_schema(table_name);
+        if (schema && schema->storage == StorageType::COLUMN) {
+            result << " (column storage)";
+        } else if (schema && schema->storage == StorageType::LSM) {
+            result << " (LSM storage)";
+        }
+        result << "\n";
         
         const std::vector<Column> columns = metadata_manager->get_columns(table_name);
         result << "    Columns:\n";
@@ -188,16 +492,66 @@ std::string QueryExecutor::list_tables() {
             if (column.is_not_null) {
                 result << " NOT NULL";
             }
+            if (column.has_bloom_filter) {
+                result << " BLOOM FILTER";
+            }
             
             result << "\n";
         }
         
+        if (schema && !schema->indexes.empty()) {
+            result << "    Indexes:\n";
+            for (const IndexDefinition& index : schema->indexes) {
+                result << "      " << index.name << " (" << index.column_name << ")"
+                       << (index.is_unique ? " UNIQUE" : "")
+                       << (index.method == IndexMethod::HASH ? " HASH" : "")
+                       << (index.method == IndexMethod::BITMAP ? " BITMAP" : "")
+                       << (index.method == IndexMethod::ART ? " ART" : "");
+                for (size_t i = 0; i < index.include_columns.size(); i++) {
+                    result << (i == 0 ? " INCLUDE (" : ", ") << index.include_columns[i];
+                }
+                result << (index.include_columns.empty() ? "" : ")") << "\n";
+            }
+        }
+        
         result << "\n";
     }
     
     return result.str();
 }
 
+std::string QueryExecutor::show_stats() {
+    BufferPoolStats stats = buffer_pool->get_stats();
+    uint64_t lookups = stats.hits + stats.misses;
+    
+    std::ostringstream result;
+    result << "Buffer pool:\n";
+    result << "============\n";
+    result << "  Capacity:   " << stats.capacity_pages << " pages ("
+           << (stats.capacity_pages * PAGE_SIZE) / 1024 << " KB)\n";
+    result << "  Resident:   " << stats.resident_pages << " pages\n";
+    result << "  Hits:       " << stats.hits << "\n";
+    result << "  Misses:     " << stats.misses << "\n";
+    result << "  Hit ratio:  " << std::fixed << std::setprecision(1)
+           << (lookups > 0 ? 100.0 * stats.hits / lookups : 0.0) << "%\n";
+    result << "  Evictions:  " << stats.evictions << "\n";
+    result << "  Writebacks: " << stats.writebacks << "\n";
+    result << "  Open files: " << stats.open_files << " (limit " << stats.max_open_files << ", "
+           << stats.file_opens << " opens)\n";
+    result << "  Handles:    " << table_cache.size() << " cached tables (limit " << config.table_cache_size << ")\n";
+    
+    WalStats wal_stats = wal->get_stats();
+    result << "\nWrite-ahead log:\n";
+    result << "================\n";
+    result << "  Sync mode:   " << get_wal_sync_mode_string(wal->get_sync_mode()) << "\n";
+    result << "  Records:     " << wal_stats.records << "\n";
+    result << "  Bytes:       " << wal_stats.bytes << "\n";
+    result << "  Commits:     " << wal_stats.commits << "\n";
+    result << "  Syncs:       " << wal_stats.syncs << "\n";
+    result << "  Checkpoints: " << wal_stats.checkpoints;
+    return result.str();
+}
+
 std::string QueryExecutor::show_help() {
     return R"(SQL Database Engine - Help
 =========================
@@ -208,10 +562,15 @@ Supported SQL Commands:
 CREATE TABLE table_name (
     column_name data_type [constraints],
     ...
-);
+) [WITH (storage = row | column | lsm)];
 
 DROP TABLE table_name;
 
+CREATE [UNIQUE] INDEX index_name ON table_name (column_name) [USING BTREE|HASH|BITMAP|ART]
+    [INCLUDE (column_name, ...)];
+
+DROP INDEX index_name;
+
 Data Types:
   INTEGER        - 32-bit signed integers
   VARCHAR(n)     - Variable-length strings (max n characters)
@@ -223,7 +582,14 @@ Constraints:
 
 INSERT INTO table_name VALUES (value1, value2, ...);
 
-SELECT * FROM table_name [WHERE column operator value];
+SELECT * | column_name, ... FROM table_name [WHERE condition] [LIMIT count];
+
+Conditions:
+  column operator value
+  column [NOT] LIKE 'pattern'
+  column [NOT] IN (value1, value2, ...)
+  column [NOT] BETWEEN low AND high
+  condition AND condition, condition OR condition, NOT condition, (condition)
 
 Operators:
   =, !=, <>, <, >, <=, >=
@@ -231,6 +597,7 @@ Operators:
 Meta Commands:
 --------------
 \l, \list      - List all tables and their schemas
+\s, \stats     - Show buffer pool statistics
 \h, help       - Show this help message
 \c, clear      - Clear the terminal screen
 \q, exit, quit - Exit the application
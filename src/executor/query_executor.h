@@ -2,38 +2,76 @@
 #define QUERY_EXECUTOR_H
 
 #include "../common/types.h"
+#include "../common/config.h"
 #include "../storage/metadata.h"
-#include "../storage/table.h"
+#include "../storage/buffer_pool.h"
+#include "../storage/table_engine.h"
+#include "../storage/wal.h"
+#include "operators.h"
+#include <list>
 #include <memory>
+#include <ostream>
 #include <string>
+#include <unordered_map>
 
 namespace sqldb {
 
 class QueryExecutor {
 private:
+    DatabaseConfig config;
     std::unique_ptr<MetadataManager> metadata_manager;
+    // Declared before the pool so pages are written back while the log is alive
+    std::unique_ptr<WriteAheadLog> wal;
+    std::unique_ptr<BufferPool> buffer_pool;
+    
+    // Open table handles, most recently used first, bounded by
+    // config.table_cache_size
+    struct CachedTable {
+        std::unique_ptr<TableEngine> engine;
+        std::list<std::string>::iterator lru_position;
+    };
+    std::unordered_map<std::string, CachedTable> table_cache;
+    std::list<std::string> table_lru;
+    
+    TableEngine* get_table_engine(const std::string& table_name);
+    void evict_table_engine(const std::string& table_name);
+    
+    // Crash recovery: redo logged inserts, then checkpoint
+    void recover();
     
     // Execution methods
     std::string execute_create_table(const CreateTableStatement& stmt);
     std::string execute_drop_table(const DropTableStatement& stmt);
+    std::string execute_create_index(const CreateIndexStatement& stmt);
+    std::string execute_drop_index(const DropIndexStatement& stmt);
     std::string execute_insert(const InsertStatement& stmt);
-    std::string execute_select(const SelectStatement& stmt);
+    void execute_select(const SelectStatement& stmt, std::ostream& out);
+    std::unique_ptr<Operator> build_select_plan(const SelectStatement& stmt, const std::vector<int>& selected);
     
-    // Utility methods
-    std::string format_results(const std::vector<Row>& rows, const std::vector<Column>& columns);
-    std::string format_value(const Value& value);
+    // Result formatting; column widths are fixed by the header and first batch
+    std::vector<size_t> compute_column_widths(const ColumnBatch& first_batch, const std::vector<Column>& columns);
+    void write_result_header(std::ostream& out, const std::vector<Column>& columns, const std::vector<size_t>& widths);
+    void write_result_rows(std::ostream& out, const ColumnBatch& batch, const std::vector<size_t>& widths);
+    size_t formatted_length(const ColumnVector& column, size_t position);
+    void write_value(std::ostream& out, const ColumnVector& column, size_t position);
     std::string get_data_type_string(DataType type, int varchar_length = 0);
+    std::string get_wal_sync_mode_string(WalSyncMode mode);
+    StorageType parse_table_options(const std::vector<TableOption>& options, std::vector<Column>& columns);
+    IndexMethod parse_index_method(const std::string& method);
     
 public:
-    explicit QueryExecutor(const std::string& data_directory = "data");
-    ~QueryExecutor() = default;
+    explicit QueryExecutor(const DatabaseConfig& config = DatabaseConfig());
+    ~QueryExecutor();
     
-    // Main execution method
+    // Main execution methods; the stream variant writes SELECT results as
+    // they are produced instead of buffering the whole result
     std::string execute(std::unique_ptr<Statement> statement);
+    void execute(std::unique_ptr<Statement> statement, std::ostream& out);
     
     // Meta commands
     std::string list_tables();
     std::string show_help();
+    std::string show_stats();
     
     // Utility
     MetadataManager* get_metadata_manager() const { return metadata_manager.get(); }
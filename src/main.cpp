@@ -1,8 +1,10 @@
 #include "common/types.h"
+#include "common/config.h"
 #include "parser/tokenizer.h"
 #include "parser/parser.h"
 #include "executor/query_executor.h"
 #include <iostream>
+#include <ostream>
 #include <string>
 #include <memory>
 #include <algorithm>
@@ -18,7 +20,7 @@ private:
     // Command processing
     bool is_meta_command(const std::string& input);
     std::string process_meta_command(const std::string& input);
-    std::string process_sql_command(const std::string& input);
+    void process_sql_command(const std::string& input, std::ostream& out);
     
     // Input handling
     std::string read_command();
@@ -29,13 +31,13 @@ private:
     void print_prompt();
     
 public:
-    SQLShell();
+    explicit SQLShell(const DatabaseConfig& config);
     void run();
 };
 
-SQLShell::SQLShell() : running(true) {
+SQLShell::SQLShell(const DatabaseConfig& config) : running(true) {
     try {
-        executor = std::make_unique<QueryExecutor>();
+        executor = std::make_unique<QueryExecutor>(config);
     } catch (const std::exception& e) {
         std::cerr << "Error initializing database: " << e.what() << std::endl;
         running = false;
@@ -136,6 +138,8 @@ std::string SQLShell::process_meta_command(const std::string& input) {
         return "Goodbye!";
     } else if (cmd == "l" || cmd == "list") {
         return executor->list_tables();
+    } else if (cmd == "s" || cmd == "stats") {
+        return executor->show_stats();
     } else if (cmd == "h" || cmd == "help") {
         return executor->show_help();
     } else if (cmd == "c" || cmd == "clear") {
@@ -147,7 +151,7 @@ std::string SQLShell::process_meta_command(const std::string& input) {
     }
 }
 
-std::string SQLShell::process_sql_command(const std::string& input) {
+void SQLShell::process_sql_command(const std::string& input, std::ostream& out) {
     try {
         // Remove trailing semicolon if present
         std::string sql = input;
@@ -164,16 +168,17 @@ std::string SQLShell::process_sql_command(const std::string& input) {
         std::unique_ptr<Statement> statement = parser.parse();
         
         if (!statement) {
-            return "Error: Failed to parse SQL statement";
+            out << "Error: Failed to parse SQL statement";
+            return;
         }
         
-        // Execute
-        return executor->execute(std::move(statement));
+        // Execute, streaming results as they are produced
+        executor->execute(std::move(statement), out);
         
     } catch (const Parser::ParseError& e) {
-        return std::string("Parse Error: ") + e.what();
+        out << "Parse Error: " << e.what();
     } catch (const std::exception& e) {
-        return std::string("Error: ") + e.what();
+        out << "Error: " << e.what();
     }
 }
 
@@ -196,26 +201,90 @@ void SQLShell::run() {
             continue;
         }
         
-        std::string result;
         if (is_meta_command(input)) {
-            result = process_meta_command(input);
+            std::string result = process_meta_command(input);
+            if (!result.empty()) {
+                std::cout << result << std::endl;
+            }
         } else {
-            result = process_sql_command(input);
+            process_sql_command(input, std::cout);
+            std::cout << std::endl;
         }
         
-        if (!result.empty()) {
-            std::cout << result << std::endl;
+        std::cout << std::endl;
+    }
+}
+
+bool parse_options(int argc, char* argv[], DatabaseConfig& config) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for option: " << arg << std::endl;
+            return false;
         }
         
-        std::cout << std::endl;
+        std::string value = argv[++i];
+        try {
+            if (arg == "--data-dir") {
+                config.data_directory = value;
+            } else if (arg == "--buffer-pool-mb") {
+                config.buffer_pool_bytes = std::stoul(value) * 1024 * 1024;
+            } else if (arg == "--scan-mode") {
+                if (value == "buffered") {
+                    config.scan_mode = ScanMode::BUFFERED;
+                } else if (value == "mmap") {
+                    config.scan_mode = ScanMode::MMAP;
+                } else {
+                    throw std::invalid_argument(value);
+                }
+            } else if (arg == "--scan-threads") {
+                config.scan_threads = std::stoul(value);
+            } else if (arg == "--max-open-files") {
+                config.max_open_files = std::stoul(value);
+                if (config.max_open_files == 0) {
+                    throw std::invalid_argument(value);
+                }
+            } else if (arg == "--wal-sync") {
+                if (value == "off") {
+                    config.wal_sync_mode = WalSyncMode::OFF;
+                } else if (value == "normal") {
+                    config.wal_sync_mode = WalSyncMode::NORMAL;
+                } else if (value == "full") {
+                    config.wal_sync_mode = WalSyncMode::FULL;
+                } else {
+                    throw std::invalid_argument(value);
+                }
+            } else if (arg == "--wal-sync-interval-ms") {
+                config.wal_sync_interval_ms = std::stoi(value);
+                if (config.wal_sync_interval_ms <= 0) {
+                    throw std::invalid_argument(value);
+                }
+            } else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                return false;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+            return false;
+        }
     }
+    
+    return true;
 }
 
 } // namespace sqldb
 
-int main() {
+int main(int argc, char* argv[]) {
+    sqldb::DatabaseConfig config;
+    if (!sqldb::parse_options(argc, argv, config)) {
+        std::cerr << "Usage: " << argv[0] << " [--data-dir DIR] [--buffer-pool-mb N] [--scan-mode buffered|mmap]"
+                  << " [--scan-threads N] [--max-open-files N] [--wal-sync off|normal|full]"
+                  << " [--wal-sync-interval-ms N]" << std::endl;
+        return 1;
+    }
+    
     try {
-        sqldb::SQLShell shell;
+        sqldb::SQLShell shell(config);
         shell.run();
         return 0;
     } catch (const std::exception& e) {
@@ -61,9 +61,9 @@ std::unique_ptr<Statement> Parser::parse() {
     
     switch (peek().type) {
         case TokenType::CREATE:
-            return parse_create_table();
+            return parse_create();
         case TokenType::DROP:
-            return parse_drop_table();
+            return parse_drop();
         case TokenType::INSERT:
             return parse_insert();
         case TokenType::SELECT:
@@ -73,6 +73,23 @@ std::unique_ptr<Statement> Parser::parse() {
     }
 }
 
+std::unique_ptr<Statement> Parser::parse_create() {
+    // Look past CREATE to tell the statements apart
+    TokenType next = current_pos + 1 < tokens.size() ? tokens[current_pos + 1].type : TokenType::END_OF_FILE;
+    if (next == TokenType::INDEX || next == TokenType::UNIQUE) {
+        return parse_create_index();
+    }
+    return parse_create_table();
+}
+
+std::unique_ptr<Statement> Parser::parse_drop() {
+    TokenType next = current_pos + 1 < tokens.size() ? tokens[current_pos + 1].type : TokenType::END_OF_FILE;
+    if (next == TokenType::INDEX) {
+        return parse_drop_index();
+    }
+    return parse_drop_table();
+}
+
 std::unique_ptr<CreateTableStatement> Parser::parse_create_table() {
     auto stmt = std::make_unique<CreateTableStatement>();
     
@@ -99,6 +116,11 @@ std::unique_ptr<CreateTableStatement> Parser::parse_create_table() {
     
     expect(TokenType::RIGHT_PAREN, "Expected ')'");
     
+    // Optional WITH (name = value, ...) clause
+    if (match(TokenType::WITH)) {
+        stmt->options = parse_table_options();
+    }
+    
     return stmt;
 }
 
@@ -116,6 +138,70 @@ std::unique_ptr<DropTableStatement> Parser::parse_drop_table() {
     return stmt;
 }
 
+std::unique_ptr<CreateIndexStatement> Parser::parse_create_index() {
+    auto stmt = std::make_unique<CreateIndexStatement>();
+    
+    expect(TokenType::CREATE, "Expected CREATE");
+    stmt->is_unique = match(TokenType::UNIQUE);
+    expect(TokenType::INDEX, "Expected INDEX");
+    
+    if (peek().type != TokenType::IDENTIFIER) {
+        throw ParseError("Expected index name");
+    }
+    stmt->index_name = advance().value;
+    
+    expect(TokenType::ON, "Expected ON");
+    
+    if (peek().type != TokenType::IDENTIFIER) {
+        throw ParseError("Expected table name");
+    }
+    stmt->table_name = advance().value;
+    
+    expect(TokenType::LEFT_PAREN, "Expected '('");
+    if (peek().type != TokenType::IDENTIFIER) {
+        throw ParseError("Expected column name");
+    }
+    stmt->column_name = advance().value;
+    expect(TokenType::RIGHT_PAREN, "Expected ')' (indexes cover a single column)");
+    
+    // Optional USING method
+    if (match(TokenType::USING)) {
+        if (peek().type != TokenType::IDENTIFIER) {
+            throw ParseError("Expected index method after USING");
+        }
+        stmt->method = advance().value;
+        std::transform(stmt->method.begin(), stmt->method.end(), stmt->method.begin(), ::tolower);
+    }
+    
+    // Optional INCLUDE (column, ...) stored in the index entries
+    if (match(TokenType::INCLUDE)) {
+        expect(TokenType::LEFT_PAREN, "Expected '(' after INCLUDE");
+        do {
+            if (peek().type != TokenType::IDENTIFIER) {
+                throw ParseError("Expected column name");
+            }
+            stmt->include_columns.push_back(advance().value);
+        } while (match(TokenType::COMMA));
+        expect(TokenType::RIGHT_PAREN, "Expected ')'");
+    }
+    
+    return stmt;
+}
+
+std::unique_ptr<DropIndexStatement> Parser::parse_drop_index() {
+    auto stmt = std::make_unique<DropIndexStatement>();
+    
+    expect(TokenType::DROP, "Expected DROP");
+    expect(TokenType::INDEX, "Expected INDEX");
+    
+    if (peek().type != TokenType::IDENTIFIER) {
+        throw ParseError("Expected index name");
+    }
+    stmt->index_name = advance().value;
+    
+    return stmt;
+}
+
 std::unique_ptr<InsertStatement> Parser::parse_insert() {
     auto stmt = std::make_unique<InsertStatement>();
     
@@ -154,7 +240,13 @@ std::unique_ptr<SelectStatement> Parser::parse_select() {
     if (match(TokenType::ASTERISK)) {
         stmt->select_all = true;
     } else {
-        throw ParseError("Only SELECT * is currently supported");
+        stmt->select_all = false;
+        do {
+            if (peek().type != TokenType::IDENTIFIER) {
+                throw ParseError("Expected column name or '*'");
+            }
+            stmt->column_names.push_back(advance().value);
+        } while (match(TokenType::COMMA));
     }
     
     expect(TokenType::FROM, "Expected FROM");
@@ -166,7 +258,16 @@ std::unique_ptr<SelectStatement> Parser::parse_select() {
     
     // Optional WHERE clause
     if (match(TokenType::WHERE)) {
-        stmt->where_condition = parse_where_clause();
+        stmt->where_clause = parse_where_clause();
+    }
+    
+    // Optional LIMIT n
+    if (match(TokenType::LIMIT)) {
+        if (peek().type != TokenType::INTEGER_LITERAL) {
+            throw ParseError("Expected row count after LIMIT");
+        }
+        stmt->limit = std::stoull(advance().value);
+        stmt->has_limit = true;
     }
     
     return stmt;
@@ -231,6 +332,33 @@ std::vector<ConstraintType> Parser::parse_constraints() {
     return constraints;
 }
 
+std::vector<TableOption> Parser::parse_table_options() {
+    std::vector<TableOption> options;
+    
+    expect(TokenType::LEFT_PAREN, "Expected '(' after WITH");
+    
+    do {
+        if (peek().type != TokenType::IDENTIFIER) {
+            throw ParseError("Expected option name");
+        }
+        std::string name = advance().value;
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        
+        expect(TokenType::EQUALS, "Expected '=' after option name");
+        
+        if (peek().type != TokenType::IDENTIFIER && peek().type != TokenType::INTEGER_LITERAL &&
+            peek().type != TokenType::STRING_LITERAL) {
+            throw ParseError("Expected value for option '" + name + "'");
+        }
+        options.emplace_back(name, advance().value);
+        
+    } while (match(TokenType::COMMA));
+    
+    expect(TokenType::RIGHT_PAREN, "Expected ')' after table options");
+    
+    return options;
+}
+
 Value Parser::parse_value() {
     if (peek().type == TokenType::INTEGER_LITERAL) {
         int value = std::stoi(advance().value);
@@ -248,24 +376,111 @@ Value Parser::parse_value() {
     }
 }
 
-std::unique_ptr<WhereCondition> Parser::parse_where_clause() {
+namespace {
+
+std::unique_ptr<WhereExpression> make_comparison(const std::string& column_name, TokenType operator_type,
+                                                 const Value& value) {
+    auto expression = std::make_unique<WhereExpression>(WhereExpression::Kind::COMPARISON);
+    expression->comparison = std::make_unique<WhereCondition>(column_name, operator_type, value);
+    return expression;
+}
+
+std::unique_ptr<WhereExpression> make_not(std::unique_ptr<WhereExpression> child) {
+    auto expression = std::make_unique<WhereExpression>(WhereExpression::Kind::NOT);
+    expression->children.push_back(std::move(child));
+    return expression;
+}
+
+} // namespace
+
+// Precedence from loosest to tightest: OR, AND, NOT, then a single predicate
+// or a parenthesized expression
+std::unique_ptr<WhereExpression> Parser::parse_where_clause() {
+    return parse_or_expression();
+}
+
+std::unique_ptr<WhereExpression> Parser::parse_or_expression() {
+    std::unique_ptr<WhereExpression> first = parse_and_expression();
+    if (peek().type != TokenType::OR) {
+        return first;
+    }
+    
+    auto expression = std::make_unique<WhereExpression>(WhereExpression::Kind::OR);
+    expression->children.push_back(std::move(first));
+    while (match(TokenType::OR)) {
+        expression->children.push_back(parse_and_expression());
+    }
+    return expression;
+}
+
+std::unique_ptr<WhereExpression> Parser::parse_and_expression() {
+    std::unique_ptr<WhereExpression> first = parse_not_expression();
+    if (peek().type != TokenType::AND) {
+        return first;
+    }
+    
+    auto expression = std::make_unique<WhereExpression>(WhereExpression::Kind::AND);
+    expression->children.push_back(std::move(first));
+    while (match(TokenType::AND)) {
+        expression->children.push_back(parse_not_expression());
+    }
+    return expression;
+}
+
+std::unique_ptr<WhereExpression> Parser::parse_not_expression() {
+    if (match(TokenType::NOT)) {
+        return make_not(parse_not_expression());
+    }
+    if (match(TokenType::LEFT_PAREN)) {
+        std::unique_ptr<WhereExpression> expression = parse_or_expression();
+        expect(TokenType::RIGHT_PAREN, "Expected ')' in WHERE clause");
+        return expression;
+    }
+    return parse_predicate();
+}
+
+std::unique_ptr<WhereExpression> Parser::parse_predicate() {
     if (peek().type != TokenType::IDENTIFIER) {
         throw ParseError("Expected column name in WHERE clause");
     }
     
     std::string column_name = advance().value;
     
-    TokenType operator_type;
     if (match_any({TokenType::EQUALS, TokenType::NOT_EQUALS, TokenType::LESS_THAN,
                    TokenType::GREATER_THAN, TokenType::LESS_EQUAL, TokenType::GREATER_EQUAL})) {
-        operator_type = tokens[current_pos - 1].type;
+        TokenType operator_type = tokens[current_pos - 1].type;
+        return make_comparison(column_name, operator_type, parse_value());
+    }
+    
+    // IN, BETWEEN and LIKE may be negated: column NOT IN (...)
+    bool negated = match(TokenType::NOT);
+    std::unique_ptr<WhereExpression> expression;
+    if (match(TokenType::LIKE)) {
+        if (peek().type != TokenType::STRING_LITERAL) {
+            throw ParseError("Expected a string pattern after LIKE");
+        }
+        expression = make_comparison(column_name, TokenType::LIKE, parse_value());
+    } else if (match(TokenType::IN)) {
+        expression = std::make_unique<WhereExpression>(WhereExpression::Kind::IN);
+        expression->column_name = column_name;
+        expect(TokenType::LEFT_PAREN, "Expected '(' after IN");
+        do {
+            expression->values.push_back(parse_value());
+        } while (match(TokenType::COMMA));
+        expect(TokenType::RIGHT_PAREN, "Expected ')' after IN list");
+    } else if (match(TokenType::BETWEEN)) {
+        // Both bounds are inclusive
+        Value low = parse_value();
+        expect(TokenType::AND, "Expected AND in BETWEEN");
+        Value high = parse_value();
+        expression = std::make_unique<WhereExpression>(WhereExpression::Kind::AND);
+        expression->children.push_back(make_comparison(column_name, TokenType::GREATER_EQUAL, low));
+        expression->children.push_back(make_comparison(column_name, TokenType::LESS_EQUAL, high));
     } else {
         throw ParseError("Expected comparison operator in WHERE clause");
     }
     
-    Value value = parse_value();
-    
-    return std::make_unique<WhereCondition>(column_name, operator_type, value);
+    return negated ? make_not(std::move(expression)) : std::move(expression);
 }
 
 } // namespace sqldb
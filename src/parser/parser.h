@@ -22,16 +22,25 @@ private:
     void expect(TokenType type, const std::string& error_message);
     
     // Parsing methods
+    std::unique_ptr<Statement> parse_create();
+    std::unique_ptr<Statement> parse_drop();
     std::unique_ptr<CreateTableStatement> parse_create_table();
     std::unique_ptr<DropTableStatement> parse_drop_table();
+    std::unique_ptr<CreateIndexStatement> parse_create_index();
+    std::unique_ptr<DropIndexStatement> parse_drop_index();
     std::unique_ptr<InsertStatement> parse_insert();
     std::unique_ptr<SelectStatement> parse_select();
     
     Column parse_column_definition();
     DataType parse_data_type(int& varchar_length);
     std::vector<ConstraintType> parse_constraints();
+    std::vector<TableOption> parse_table_options();
     Value parse_value();
-    std::unique_ptr<WhereCondition> parse_where_clause();
+    std::unique_ptr<WhereExpression> parse_where_clause();
+    std::unique_ptr<WhereExpression> parse_or_expression();
+    std::unique_ptr<WhereExpression> parse_and_expression();
+    std::unique_ptr<WhereExpression> parse_not_expression();
+    std::unique_ptr<WhereExpression> parse_predicate();
     
     // Utility methods
     bool is_at_end() const;
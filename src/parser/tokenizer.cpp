@@ -15,6 +15,18 @@ const std::unordered_map<std::string, TokenType> Tokenizer::keywords = {
     {"FROM", TokenType::FROM},
     {"WHERE", TokenType::WHERE},
     {"VALUES", TokenType::VALUES},
+    {"WITH", TokenType::WITH},
+    {"INDEX", TokenType::INDEX},
+    {"ON", TokenType::ON},
+    {"UNIQUE", TokenType::UNIQUE},
+    {"USING", TokenType::USING},
+    {"INCLUDE", TokenType::INCLUDE},
+    {"LIMIT", TokenType::LIMIT},
+    {"AND", TokenType::AND},
+    {"OR", TokenType::OR},
+    {"IN", TokenType::IN},
+    {"BETWEEN", TokenType::BETWEEN},
+    {"LIKE", TokenType::LIKE},
     {"INTEGER", TokenType::INTEGER},
     {"VARCHAR", TokenType::VARCHAR},
     {"BOOLEAN", TokenType::BOOLEAN},
@@ -257,6 +269,17 @@ std::string Tokenizer::token_type_to_string(TokenType type) {
         case TokenType::FROM: return "FROM";
         case TokenType::WHERE: return "WHERE";
         case TokenType::VALUES: return "VALUES";
+        case TokenType::WITH: return "WITH";
+        case TokenType::INDEX: return "INDEX";
+        case TokenType::ON: return "ON";
+        case TokenType::UNIQUE: return "UNIQUE";
+        case TokenType::USING: return "USING";
+        case TokenType::INCLUDE: return "INCLUDE";
+        case TokenType::LIMIT: return "LIMIT";
+        case TokenType::AND: return "AND";
+        case TokenType::OR: return "OR";
+        case TokenType::IN: return "IN";
+        case TokenType::BETWEEN: return "BETWEEN";
         case TokenType::INTEGER: return "INTEGER";
         case TokenType::VARCHAR: return "VARCHAR";
         case TokenType::BOOLEAN: return "BOOLEAN";
@@ -270,6 +293,7 @@ std::string Tokenizer::token_type_to_string(TokenType type) {
         case TokenType::GREATER_THAN: return "GREATER_THAN";
         case TokenType::LESS_EQUAL: return "LESS_EQUAL";
         case TokenType::GREATER_EQUAL: return "GREATER_EQUAL";
+        case TokenType::LIKE: return "LIKE";
         case TokenType::SEMICOLON: return "SEMICOLON";
         case TokenType::COMMA: return "COMMA";
         case TokenType::LEFT_PAREN: return "LEFT_PAREN";
@@ -0,0 +1,292 @@
+#include "art_index.h"
+#include <utility>
+
+namespace sqldb {
+
+namespace {
+
+// Node4 and Node16 keep their key bytes sorted so children read in order
+template <typename SortedNode, typename Child>
+void insert_sorted(SortedNode* node, uint8_t byte, Child child) {
+    size_t position = 0;
+    while (position < node->child_count && node->keys[position] < byte) {
+        position++;
+    }
+    for (size_t i = node->child_count; i > position; i--) {
+        node->keys[i] = node->keys[i - 1];
+        node->children[i] = std::move(node->children[i - 1]);
+    }
+    node->keys[position] = byte;
+    node->children[position] = std::move(child);
+}
+
+} // namespace
+
+ArtIndex::NodePtr ArtIndex::make_leaf(std::string_view rest, RowId row_id) {
+    // Lazy expansion: the rest of the key stays in the prefix until another
+    // key needs it split
+    NodePtr leaf = std::make_unique<Node4>();
+    leaf->prefix.assign(rest.data(), rest.size());
+    leaf->row_ids.push_back(row_id);
+    return leaf;
+}
+
+ArtIndex::NodePtr* ArtIndex::find_child(Node* node, uint8_t byte) {
+    switch (node->kind) {
+        case Node::Kind::NODE4: {
+            Node4* small = static_cast<Node4*>(node);
+            for (size_t i = 0; i < small->child_count; i++) {
+                if (small->keys[i] == byte) {
+                    return &small->children[i];
+                }
+            }
+            return nullptr;
+        }
+        case Node::Kind::NODE16: {
+            Node16* medium = static_cast<Node16*>(node);
+            for (size_t i = 0; i < medium->child_count && medium->keys[i] <= byte; i++) {
+                if (medium->keys[i] == byte) {
+                    return &medium->children[i];
+                }
+            }
+            return nullptr;
+        }
+        case Node::Kind::NODE48: {
+            Node48* large = static_cast<Node48*>(node);
+            uint8_t slot = large->slot_of[byte];
+            return slot ? &large->children[slot - 1] : nullptr;
+        }
+        case Node::Kind::NODE256: {
+            Node256* full = static_cast<Node256*>(node);
+            return full->children[byte] ? &full->children[byte] : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+void ArtIndex::grow(NodePtr& node) {
+    NodePtr bigger;
+    switch (node->kind) {
+        case Node::Kind::NODE4: {
+            Node4* old_node = static_cast<Node4*>(node.get());
+            auto new_node = std::make_unique<Node16>();
+            for (size_t i = 0; i < old_node->child_count; i++) {
+                new_node->keys[i] = old_node->keys[i];
+                new_node->children[i] = std::move(old_node->children[i]);
+            }
+            bigger = std::move(new_node);
+            break;
+        }
+        case Node::Kind::NODE16: {
+            Node16* old_node = static_cast<Node16*>(node.get());
+            auto new_node = std::make_unique<Node48>();
+            for (size_t i = 0; i < old_node->child_count; i++) {
+                new_node->slot_of[old_node->keys[i]] = static_cast<uint8_t>(i + 1);
+                new_node->children[i] = std::move(old_node->children[i]);
+            }
+            bigger = std::move(new_node);
+            break;
+        }
+        case Node::Kind::NODE48: {
+            Node48* old_node = static_cast<Node48*>(node.get());
+            auto new_node = std::make_unique<Node256>();
+            for (size_t byte = 0; byte < 256; byte++) {
+                if (old_node->slot_of[byte]) {
+                    new_node->children[byte] = std::move(old_node->children[old_node->slot_of[byte] - 1]);
+                }
+            }
+            bigger = std::move(new_node);
+            break;
+        }
+        case Node::Kind::NODE256:
+            return;
+    }
+
+    bigger->child_count = node->child_count;
+    bigger->prefix = std::move(node->prefix);
+    bigger->row_ids = std::move(node->row_ids);
+    node = std::move(bigger);
+}
+
+void ArtIndex::add_child(NodePtr& node, uint8_t byte, NodePtr child) {
+    bool full = (node->kind == Node::Kind::NODE4 && node->child_count == 4) ||
+                (node->kind == Node::Kind::NODE16 && node->child_count == 16) ||
+                (node->kind == Node::Kind::NODE48 && node->child_count == 48);
+    if (full) {
+        grow(node);
+    }
+
+    switch (node->kind) {
+        case Node::Kind::NODE4:
+            insert_sorted(static_cast<Node4*>(node.get()), byte, std::move(child));
+            break;
+        case Node::Kind::NODE16:
+            insert_sorted(static_cast<Node16*>(node.get()), byte, std::move(child));
+            break;
+        case Node::Kind::NODE48: {
+            // Children are never removed, so the next free slot is the count
+            Node48* large = static_cast<Node48*>(node.get());
+            large->children[large->child_count] = std::move(child);
+            large->slot_of[byte] = static_cast<uint8_t>(large->child_count + 1);
+            break;
+        }
+        case Node::Kind::NODE256:
+            static_cast<Node256*>(node.get())->children[byte] = std::move(child);
+            break;
+    }
+    node->child_count++;
+}
+
+void ArtIndex::collect(const Node* node, std::vector<RowId>& row_ids) {
+    // A key ending here sorts before every longer key below
+    row_ids.insert(row_ids.end(), node->row_ids.begin(), node->row_ids.end());
+
+    switch (node->kind) {
+        case Node::Kind::NODE4: {
+            const Node4* small = static_cast<const Node4*>(node);
+            for (size_t i = 0; i < small->child_count; i++) {
+                collect(small->children[i].get(), row_ids);
+            }
+            break;
+        }
+        case Node::Kind::NODE16: {
+            const Node16* medium = static_cast<const Node16*>(node);
+            for (size_t i = 0; i < medium->child_count; i++) {
+                collect(medium->children[i].get(), row_ids);
+            }
+            break;
+        }
+        case Node::Kind::NODE48: {
+            const Node48* large = static_cast<const Node48*>(node);
+            for (size_t byte = 0; byte < 256; byte++) {
+                if (large->slot_of[byte]) {
+                    collect(large->children[large->slot_of[byte] - 1].get(), row_ids);
+                }
+            }
+            break;
+        }
+        case Node::Kind::NODE256: {
+            const Node256* full = static_cast<const Node256*>(node);
+            for (size_t byte = 0; byte < 256; byte++) {
+                if (full->children[byte]) {
+                    collect(full->children[byte].get(), row_ids);
+                }
+            }
+            break;
+        }
+    }
+}
+
+void ArtIndex::insert(const Value& key, RowId row_id, uint64_t) {
+    std::string_view bytes(std::get<std::string>(key));
+    if (!root) {
+        root = make_leaf(bytes, row_id);
+        return;
+    }
+
+    NodePtr* current = &root;
+    size_t depth = 0;
+    while (true) {
+        Node* node = current->get();
+        std::string_view rest = bytes.substr(depth);
+
+        size_t common = 0;
+        while (common < node->prefix.size() && common < rest.size() && node->prefix[common] == rest[common]) {
+            common++;
+        }
+
+        // The key leaves the compressed path: split it at the first difference
+        if (common < node->prefix.size()) {
+            NodePtr parent = std::make_unique<Node4>();
+            parent->prefix = node->prefix.substr(0, common);
+            uint8_t old_byte = static_cast<uint8_t>(node->prefix[common]);
+            node->prefix.erase(0, common + 1);
+            add_child(parent, old_byte, std::move(*current));
+            if (common == rest.size()) {
+                parent->row_ids.push_back(row_id);
+            } else {
+                add_child(parent, static_cast<uint8_t>(rest[common]), make_leaf(rest.substr(common + 1), row_id));
+            }
+            *current = std::move(parent);
+            return;
+        }
+
+        depth += common;
+        if (depth == bytes.size()) {
+            node->row_ids.push_back(row_id);
+            return;
+        }
+
+        uint8_t byte = static_cast<uint8_t>(bytes[depth]);
+        NodePtr* child = find_child(node, byte);
+        if (!child) {
+            add_child(*current, byte, make_leaf(bytes.substr(depth + 1), row_id));
+            return;
+        }
+        current = child;
+        depth++;
+    }
+}
+
+ArtIndex::Node* ArtIndex::find_node(std::string_view key) {
+    Node* node = root.get();
+    size_t depth = 0;
+    while (node) {
+        std::string_view rest = key.substr(depth);
+        if (rest.size() < node->prefix.size() || rest.compare(0, node->prefix.size(), node->prefix) != 0) {
+            return nullptr;
+        }
+        depth += node->prefix.size();
+        if (depth == key.size()) {
+            return node;
+        }
+
+        NodePtr* child = find_child(node, static_cast<uint8_t>(key[depth]));
+        node = child ? child->get() : nullptr;
+        depth++;
+    }
+    return nullptr;
+}
+
+void ArtIndex::clear() {
+    root.reset();
+    built = false;
+}
+
+bool ArtIndex::contains(const Value& key) {
+    Node* node = find_node(std::get<std::string>(key));
+    return node && !node->row_ids.empty();
+}
+
+std::unique_ptr<RowIdCursor> ArtIndex::open_equal(const Value& key) {
+    Node* node = find_node(std::get<std::string>(key));
+    return std::make_unique<RowIdListCursor>(node ? node->row_ids : std::vector<RowId>());
+}
+
+std::unique_ptr<RowIdCursor> ArtIndex::open_prefix(const std::string& prefix) {
+    std::vector<RowId> row_ids;
+    Node* node = root.get();
+    size_t depth = 0;
+    while (node) {
+        std::string_view rest = std::string_view(prefix).substr(depth);
+
+        // The prefix runs out inside this node's path: everything below matches
+        if (rest.size() <= node->prefix.size()) {
+            if (node->prefix.compare(0, rest.size(), rest) == 0) {
+                collect(node, row_ids);
+            }
+            break;
+        }
+        if (rest.compare(0, node->prefix.size(), node->prefix) != 0) {
+            break;
+        }
+
+        depth += node->prefix.size();
+        NodePtr* child = find_child(node, static_cast<uint8_t>(prefix[depth]));
+        node = child ? child->get() : nullptr;
+        depth++;
+    }
+    return std::make_unique<RowIdListCursor>(std::move(row_ids));
+}
+
+} // namespace sqldb
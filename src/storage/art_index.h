@@ -0,0 +1,92 @@
+#ifndef ART_INDEX_H
+#define ART_INDEX_H
+
+#include "../common/types.h"
+#include "key_index.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqldb {
+
+// Adaptive radix tree over the values of a VARCHAR column, held in memory
+// only and rebuilt from the table like a hash index. Every node stores the
+// compressed path leading to it, the rows whose key ends there, and its
+// children by next byte in one of four layouts (4, 16, 48 or 256 slots)
+// that grow as children are added. A lookup costs one step per key byte
+// whatever the number of keys, and all keys sharing a prefix sit in one
+// subtree, so LIKE 'prefix%' walks to that subtree and reads it in order.
+class ArtIndex : public KeyIndex {
+private:
+    struct Node;
+    using NodePtr = std::unique_ptr<Node>;
+
+    struct Node {
+        enum class Kind : uint8_t { NODE4, NODE16, NODE48, NODE256 };
+
+        Kind kind;
+        uint16_t child_count = 0;
+        std::string prefix;           // Bytes between the parent's slot and this node
+        std::vector<RowId> row_ids;   // Rows whose key ends here
+
+        explicit Node(Kind kind) : kind(kind) {}
+        virtual ~Node() = default;
+    };
+
+    // Node4 and Node16: sorted key bytes beside their children
+    template <size_t N, Node::Kind K>
+    struct SortedNode : Node {
+        uint8_t keys[N] = {};
+        NodePtr children[N];
+        SortedNode() : Node(K) {}
+    };
+    using Node4 = SortedNode<4, Node::Kind::NODE4>;
+    using Node16 = SortedNode<16, Node::Kind::NODE16>;
+
+    // Node48: a byte-indexed table of slot numbers (0 for none) into 48 children
+    struct Node48 : Node {
+        uint8_t slot_of[256] = {};
+        NodePtr children[48];
+        Node48() : Node(Kind::NODE48) {}
+    };
+
+    struct Node256 : Node {
+        NodePtr children[256];
+        Node256() : Node(Kind::NODE256) {}
+    };
+
+    NodePtr root;
+    bool built;
+
+    static NodePtr make_leaf(std::string_view rest, RowId row_id);
+    static NodePtr* find_child(Node* node, uint8_t byte);
+    static void add_child(NodePtr& node, uint8_t byte, NodePtr child);
+    static void grow(NodePtr& node);
+    static void collect(const Node* node, std::vector<RowId>& row_ids);
+
+    Node* find_node(std::string_view key);
+
+public:
+    ArtIndex() : built(false) {}
+
+    bool needs_rebuild() const override { return !built; }
+
+    // Maintenance; nothing is logged, so the lsn is not needed
+    void check_key(const Value&) const override {}
+    void insert(const Value& key, RowId row_id, uint64_t lsn = 0) override;
+    void clear() override;
+    void finish_build() override { built = true; }
+    void delete_file() override { clear(); }
+
+    // Lookups; only equality and prefixes, no ranges
+    bool contains(const Value& key) override;
+    std::unique_ptr<RowIdCursor> open_equal(const Value& key) override;
+    bool supports_prefix() const override { return true; }
+    std::unique_ptr<RowIdCursor> open_prefix(const std::string& prefix) override;
+};
+
+} // namespace sqldb
+
+#endif // ART_INDEX_H
@@ -0,0 +1,68 @@
+#include "bitmap_index.h"
+#include "btree.h"
+#include "page.h"
+
+namespace sqldb {
+
+static_assert((PAGE_SIZE - SlottedPage::HEADER_SIZE) / SlottedPage::SLOT_SIZE < 1024,
+              "row positions reserve 10 bits for the slot");
+
+bool BitmapCursor::next(RowId& row_id) {
+    uint32_t position;
+    if (!reader.next(position)) {
+        return false;
+    }
+    row_id = BitmapIndex::to_row_id(position);
+    return true;
+}
+
+void BitmapIndex::check_key(const Value& key) const {
+    // Throws for keys too long to encode
+    encode_index_key(key_type, key);
+}
+
+void BitmapIndex::insert(const Value& key, RowId row_id, uint64_t) {
+    bitmaps[encode_index_key(key_type, key)].add(to_position(row_id));
+}
+
+void BitmapIndex::clear() {
+    bitmaps.clear();
+    built = false;
+}
+
+bool BitmapIndex::contains(const Value& key) {
+    return bitmaps.find(encode_index_key(key_type, key)) != bitmaps.end();
+}
+
+std::unique_ptr<RowIdCursor> BitmapIndex::open_equal(const Value& key) {
+    auto it = bitmaps.find(encode_index_key(key_type, key));
+    if (it == bitmaps.end()) {
+        return std::make_unique<BitmapCursor>(RoaringBitmap());
+    }
+    return std::make_unique<BitmapCursor>(it->second);
+}
+
+std::unique_ptr<RowIdCursor> BitmapIndex::open_range(const Value* lower, bool lower_inclusive, const Value* upper,
+                                                     bool upper_inclusive) {
+    auto begin = bitmaps.begin();
+    if (lower) {
+        std::string key = encode_index_key(key_type, *lower);
+        begin = lower_inclusive ? bitmaps.lower_bound(key) : bitmaps.upper_bound(key);
+    }
+    std::string upper_key = upper ? encode_index_key(key_type, *upper) : std::string();
+
+    // Few distinct keys, so few bitmaps to merge
+    RoaringBitmap result;
+    for (auto it = begin; it != bitmaps.end(); ++it) {
+        if (upper) {
+            int order = it->first.compare(upper_key);
+            if (order > 0 || (order == 0 && !upper_inclusive)) {
+                break;
+            }
+        }
+        result.union_with(it->second);
+    }
+    return std::make_unique<BitmapCursor>(std::move(result));
+}
+
+} // namespace sqldb
@@ -0,0 +1,67 @@
+#ifndef BITMAP_INDEX_H
+#define BITMAP_INDEX_H
+
+#include "../common/types.h"
+#include "key_index.h"
+#include "roaring_bitmap.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace sqldb {
+
+// Emits the rows of a bitmap in table order
+class BitmapCursor : public RowIdCursor {
+private:
+    RoaringBitmap bitmap;
+    RoaringBitmap::Reader reader;
+
+public:
+    explicit BitmapCursor(RoaringBitmap bitmap) : bitmap(std::move(bitmap)), reader(&this->bitmap) {}
+
+    BitmapCursor(const BitmapCursor&) = delete;
+    BitmapCursor& operator=(const BitmapCursor&) = delete;
+
+    bool next(RowId& row_id) override;
+};
+
+// One compressed bitmap of row positions per distinct key, held in memory
+// only and rebuilt from the table like a hash index. Meant for BOOLEAN and
+// other columns with few distinct values: an equality lookup hands back a
+// stored bitmap, and a range is the union of the bitmaps of its keys.
+class BitmapIndex : public KeyIndex {
+private:
+    DataType key_type;
+    std::map<std::string, RoaringBitmap> bitmaps;  // By order-preserving key encoding
+    bool built;
+
+public:
+    explicit BitmapIndex(DataType key_type) : key_type(key_type), built(false) {}
+
+    // Row ids as dense positions; a page has fewer than 1024 slots
+    static uint32_t to_position(RowId row_id) { return (row_id.page_no << 10) | row_id.slot; }
+    static RowId to_row_id(uint32_t position) {
+        return RowId{position >> 10, static_cast<uint16_t>(position & 0x3FF)};
+    }
+
+    bool needs_rebuild() const override { return !built; }
+
+    // Maintenance; nothing is logged, so the lsn is not needed
+    void check_key(const Value& key) const override;
+    void insert(const Value& key, RowId row_id, uint64_t lsn = 0) override;
+    void clear() override;
+    void finish_build() override { built = true; }
+    void delete_file() override { clear(); }
+
+    // Lookups
+    bool contains(const Value& key) override;
+    std::unique_ptr<RowIdCursor> open_equal(const Value& key) override;
+    bool is_ordered() const override { return true; }
+    std::unique_ptr<RowIdCursor> open_range(const Value* lower, bool lower_inclusive, const Value* upper,
+                                            bool upper_inclusive) override;
+};
+
+} // namespace sqldb
+
+#endif // BITMAP_INDEX_H
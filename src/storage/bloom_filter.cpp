@@ -0,0 +1,238 @@
+#include "bloom_filter.h"
+#include "buffer_pool.h"
+#include "page.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace sqldb {
+
+namespace {
+
+constexpr char BLOOM_MAGIC[8] = {'S', 'Q', 'L', 'M', 'B', 'L', 'M', '1'};
+
+// A whole page of bits per filter; with five probes a segment of 1500 rows
+// gives about one false positive in 3000 lookups
+constexpr uint32_t FILTER_BITS = PAGE_SIZE * 8;
+constexpr int PROBE_COUNT = 5;
+
+// Header page: magic, u32 filter count, then per filter a u16 column index
+// and a type byte
+constexpr size_t HEADER_ENTRIES_OFFSET = sizeof(BLOOM_MAGIC) + sizeof(uint32_t);
+constexpr size_t HEADER_ENTRY_SIZE = 3;
+
+// False for a value of the wrong type, which then never rules anything out
+bool hash_value(DataType type, const Value& value, uint64_t& hash) {
+    switch (type) {
+        case DataType::INTEGER: {
+            if (!std::holds_alternative<int>(value)) {
+                return false;
+            }
+            int32_t number = std::get<int>(value);
+            hash = bloom_hash(reinterpret_cast<const char*>(&number), sizeof(number));
+            return true;
+        }
+        case DataType::BOOLEAN: {
+            if (!std::holds_alternative<bool>(value)) {
+                return false;
+            }
+            char flag = std::get<bool>(value) ? 1 : 0;
+            hash = bloom_hash(&flag, 1);
+            return true;
+        }
+        case DataType::VARCHAR: {
+            if (!std::holds_alternative<std::string>(value)) {
+                return false;
+            }
+            const std::string& text = std::get<std::string>(value);
+            hash = bloom_hash(text.data(), text.size());
+            return true;
+        }
+    }
+    return false;
+}
+
+// Double hashing: probe i sets bit h1 + i * h2
+uint32_t probe_bit(uint64_t hash, int probe) {
+    uint32_t h1 = static_cast<uint32_t>(hash);
+    uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+    return (h1 + static_cast<uint32_t>(probe) * h2) % FILTER_BITS;
+}
+
+} // namespace
+
+uint64_t bloom_hash(const char* data, size_t size) {
+    // 64-bit FNV-1a with a final avalanche step
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+BloomFilters::BloomFilters(BufferPool* buffer_pool, const std::string& file_path, const std::vector<Column>& columns)
+    : buffer_pool(buffer_pool), file_path(file_path), file_id(0), rebuilt(false) {
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (columns[i].has_bloom_filter) {
+            column_indexes.push_back(static_cast<int>(i));
+            types.push_back(columns[i].type);
+        }
+    }
+    if (column_indexes.empty() || HEADER_ENTRIES_OFFSET + column_indexes.size() * HEADER_ENTRY_SIZE > PAGE_SIZE) {
+        throw std::runtime_error("Unsupported set of Bloom filter columns");
+    }
+
+    if (!std::filesystem::exists(file_path)) {
+        write_empty_file();
+        rebuilt = true;
+    }
+    file_id = buffer_pool->register_file(file_path);
+
+    // A sidecar from another schema or a damaged one is started over
+    if (!header_matches()) {
+        buffer_pool->drop_file(file_path);
+        write_empty_file();
+        file_id = buffer_pool->register_file(file_path);
+        rebuilt = true;
+    }
+}
+
+bool BloomFilters::wanted(const std::vector<Column>& columns) {
+    for (const Column& column : columns) {
+        if (column.has_bloom_filter) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void BloomFilters::write_empty_file() {
+    std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot create Bloom filter file: " + file_path);
+    }
+
+    char header[PAGE_SIZE] = {};
+    std::memcpy(header, BLOOM_MAGIC, sizeof(BLOOM_MAGIC));
+    uint32_t filter_count = static_cast<uint32_t>(column_indexes.size());
+    std::memcpy(header + sizeof(BLOOM_MAGIC), &filter_count, sizeof(filter_count));
+    for (size_t i = 0; i < column_indexes.size(); i++) {
+        char* entry = header + HEADER_ENTRIES_OFFSET + i * HEADER_ENTRY_SIZE;
+        uint16_t column_index = static_cast<uint16_t>(column_indexes[i]);
+        std::memcpy(entry, &column_index, sizeof(column_index));
+        entry[sizeof(column_index)] = static_cast<char>(types[i]);
+    }
+
+    file.write(header, PAGE_SIZE);
+    if (!file) {
+        throw std::runtime_error("Cannot write Bloom filter file: " + file_path);
+    }
+}
+
+bool BloomFilters::header_matches() {
+    if (buffer_pool->get_page_count(file_id) == 0) {
+        return false;
+    }
+
+    PageGuard guard(buffer_pool, file_id, 0);
+    const char* header = guard.get_data();
+    uint32_t filter_count;
+    std::memcpy(&filter_count, header + sizeof(BLOOM_MAGIC), sizeof(filter_count));
+    if (std::memcmp(header, BLOOM_MAGIC, sizeof(BLOOM_MAGIC)) != 0 || filter_count != column_indexes.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < column_indexes.size(); i++) {
+        const char* entry = header + HEADER_ENTRIES_OFFSET + i * HEADER_ENTRY_SIZE;
+        uint16_t column_index;
+        std::memcpy(&column_index, entry, sizeof(column_index));
+        if (column_index != column_indexes[i] || entry[sizeof(column_index)] != static_cast<char>(types[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t BloomFilters::get_filter_page_no(uint32_t data_page_no, size_t filter) const {
+    uint32_t segment = (data_page_no - 1) / BLOOM_SEGMENT_PAGES;
+    return 1 + segment * static_cast<uint32_t>(column_indexes.size()) + static_cast<uint32_t>(filter);
+}
+
+void BloomFilters::add(uint32_t data_page_no, const Row& row) {
+    if (data_page_no == 0) {
+        return;
+    }
+
+    // Filter pages of a segment are allocated together
+    uint32_t last_page_no = get_filter_page_no(data_page_no, column_indexes.size() - 1);
+    while (buffer_pool->get_page_count(file_id) <= last_page_no) {
+        PageGuard new_page(buffer_pool, file_id);
+    }
+
+    for (size_t i = 0; i < column_indexes.size(); i++) {
+        uint64_t hash;
+        size_t column = static_cast<size_t>(column_indexes[i]);
+        if (column >= row.size() || !hash_value(types[i], row[column], hash)) {
+            continue;
+        }
+
+        PageGuard guard(buffer_pool, file_id, get_filter_page_no(data_page_no, i));
+        char* bits = guard.get_data();
+        for (int probe = 0; probe < PROBE_COUNT; probe++) {
+            uint32_t bit = probe_bit(hash, probe);
+            bits[bit / 8] |= static_cast<char>(1 << (bit % 8));
+        }
+        guard.mark_dirty();
+    }
+}
+
+bool BloomFilters::may_match(uint32_t data_page_no, const BoundCondition& condition) {
+    if (data_page_no == 0 || condition.operator_type != TokenType::EQUALS) {
+        return true;
+    }
+
+    size_t filter = 0;
+    while (filter < column_indexes.size() && column_indexes[filter] != condition.column_index) {
+        filter++;
+    }
+    uint64_t hash;
+    if (filter == column_indexes.size() || !hash_value(types[filter], condition.value, hash)) {
+        return true;
+    }
+
+    // A segment without filter pages has not been summarized
+    uint32_t filter_page_no = get_filter_page_no(data_page_no, filter);
+    if (filter_page_no >= buffer_pool->get_page_count(file_id)) {
+        return true;
+    }
+
+    PageGuard guard(buffer_pool, file_id, filter_page_no);
+    const char* bits = guard.get_data();
+    for (int probe = 0; probe < PROBE_COUNT; probe++) {
+        uint32_t bit = probe_bit(hash, probe);
+        if (!(bits[bit / 8] & (1 << (bit % 8)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BloomFilters::clear() {
+    buffer_pool->drop_file(file_path);
+    write_empty_file();
+    file_id = buffer_pool->register_file(file_path);
+}
+
+void BloomFilters::delete_file() {
+    buffer_pool->drop_file(file_path);
+
+    std::error_code ec;
+    std::filesystem::remove(file_path, ec);
+    // Ignore errors if file doesn't exist
+}
+
+} // namespace sqldb
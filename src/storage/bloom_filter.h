@@ -0,0 +1,68 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include "../common/types.h"
+#include "row_codec.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sqldb {
+
+class BufferPool;
+
+// Hash of the filters; they live on disk, so it must not change between builds
+uint64_t bloom_hash(const char* data, size_t size);
+
+// Data pages covered by one Bloom filter
+constexpr uint32_t BLOOM_SEGMENT_PAGES = 16;
+
+// Bloom filters over the columns of a row table created WITH (bloom = ...),
+// one filter page per column for every BLOOM_SEGMENT_PAGES data pages,
+// stored in a paged sidecar file (<table>.bloom) that goes through the
+// buffer pool. An equality scan skips every segment whose filter rules the
+// value out. Like zone pages, filter pages are not logged: a checkpoint
+// writes them back with the data pages and recovery adds every replayed
+// row again, which a Bloom filter absorbs without harm.
+class BloomFilters {
+private:
+    BufferPool* buffer_pool;
+    std::string file_path;
+    uint32_t file_id;
+    std::vector<int> column_indexes;  // Table columns that have a filter
+    std::vector<DataType> types;
+    bool rebuilt;
+
+    void write_empty_file();
+    bool header_matches();
+    uint32_t get_filter_page_no(uint32_t data_page_no, size_t filter) const;
+
+public:
+    BloomFilters(BufferPool* buffer_pool, const std::string& file_path, const std::vector<Column>& columns);
+
+    // True when the sidecar was missing or unusable and was started empty;
+    // the owner must then feed every existing row through add()
+    bool needs_rebuild() const { return rebuilt; }
+
+    // Maintenance
+    void add(uint32_t data_page_no, const Row& row);
+    void clear();
+    void delete_file();
+
+    // Scan pruning: false only when no row of the segment holding the data
+    // page can satisfy the condition
+    bool may_match(uint32_t data_page_no, const BoundCondition& condition);
+
+    // First data page of the next segment
+    static uint32_t segment_end(uint32_t data_page_no) {
+        return 1 + ((data_page_no - 1) / BLOOM_SEGMENT_PAGES + 1) * BLOOM_SEGMENT_PAGES;
+    }
+
+    // Whether any column asked for a filter
+    static bool wanted(const std::vector<Column>& columns);
+};
+
+} // namespace sqldb
+
+#endif // BLOOM_FILTER_H
@@ -0,0 +1,806 @@
+#include "btree.h"
+#include "buffer_pool.h"
+#include "page.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <queue>
+#include <stdexcept>
+
+namespace sqldb {
+
+namespace {
+
+constexpr char INDEX_MAGIC[8] = {'S', 'Q', 'L', 'M', 'I', 'D', 'X', '2'};
+
+// Header page (page 0)
+constexpr size_t KEY_TYPE_OFFSET = 8;
+constexpr size_t STATE_OFFSET = 9;
+constexpr size_t ROOT_OFFSET = 12;
+
+// A tree is only trusted once every page of a build reached the disk
+constexpr char STATE_BUILDING = 0;
+constexpr char STATE_READY = 1;
+
+// Node pages:
+//   [0]       1 for a leaf, 0 for an internal node
+//   [2..4)    entry count
+//   [4..6)    start of the entry area (entries grow down from the page end)
+//   [8..12)   leaf: next leaf page, 0 at the end; internal: leftmost child
+//   [16..)    sorted slot directory, one u16 entry offset per entry
+//
+// Entry: u16 key length, key bytes, u32 row page, u16 row slot, then for
+// leaves a u16 length and the included column values, and for internal
+// nodes a u32 child holding the entries at or above this one
+constexpr size_t LEAF_FLAG_OFFSET = 0;
+constexpr size_t COUNT_OFFSET = 2;
+constexpr size_t FREE_END_OFFSET = 4;
+constexpr size_t LINK_OFFSET = 8;
+constexpr size_t NODE_HEADER_SIZE = 16;
+constexpr size_t NODE_SLOT_SIZE = sizeof(uint16_t);
+
+constexpr size_t ROW_ID_SIZE = sizeof(uint32_t) + sizeof(uint16_t);
+constexpr size_t CHILD_SIZE = sizeof(uint32_t);
+constexpr size_t INCLUDED_SIZE = sizeof(uint16_t);
+
+// Bulk builds leave this much of each node free for later inserts
+constexpr size_t BULK_FREE_SPACE = PAGE_SIZE / 10;
+
+uint16_t load_u16(const char* data) {
+    uint16_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint32_t load_u32(const char* data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+void store_u16(char* data, uint16_t value) {
+    std::memcpy(data, &value, sizeof(value));
+}
+
+void store_u32(char* data, uint32_t value) {
+    std::memcpy(data, &value, sizeof(value));
+}
+
+std::string_view entry_key(std::string_view entry) {
+    return entry.substr(sizeof(uint16_t), load_u16(entry.data()));
+}
+
+RowId entry_row_id(std::string_view entry) {
+    const char* position = entry.data() + sizeof(uint16_t) + load_u16(entry.data());
+    return RowId{load_u32(position), load_u16(position + sizeof(uint32_t))};
+}
+
+uint32_t entry_child(std::string_view entry) {
+    return load_u32(entry.data() + sizeof(uint16_t) + load_u16(entry.data()) + ROW_ID_SIZE);
+}
+
+// Leaf entries only
+std::string_view entry_included(std::string_view entry) {
+    const char* position = entry.data() + sizeof(uint16_t) + load_u16(entry.data()) + ROW_ID_SIZE;
+    return std::string_view(position + INCLUDED_SIZE, load_u16(position));
+}
+
+// Leaf entry starting at data
+std::string_view leaf_entry_at(const char* data) {
+    size_t size = sizeof(uint16_t) + load_u16(data) + ROW_ID_SIZE;
+    return std::string_view(data, size + INCLUDED_SIZE + load_u16(data + size));
+}
+
+// Leaf entry; internal entries keep the key and row id and add the child page
+std::string make_entry(std::string_view key, RowId row_id, std::string_view included) {
+    std::string entry;
+    entry.reserve(sizeof(uint16_t) + key.size() + ROW_ID_SIZE + INCLUDED_SIZE + included.size());
+    uint16_t key_size = static_cast<uint16_t>(key.size());
+    entry.append(reinterpret_cast<const char*>(&key_size), sizeof(key_size));
+    entry.append(key);
+    entry.append(reinterpret_cast<const char*>(&row_id.page_no), sizeof(row_id.page_no));
+    entry.append(reinterpret_cast<const char*>(&row_id.slot), sizeof(row_id.slot));
+    uint16_t included_size = static_cast<uint16_t>(included.size());
+    entry.append(reinterpret_cast<const char*>(&included_size), sizeof(included_size));
+    entry.append(included);
+    return entry;
+}
+
+std::string make_internal_entry(std::string_view separator, uint32_t child) {
+    std::string entry(separator.substr(0, sizeof(uint16_t) + load_u16(separator.data()) + ROW_ID_SIZE));
+    entry.append(reinterpret_cast<const char*>(&child), sizeof(child));
+    return entry;
+}
+
+// Orders entries by key bytes, then row id
+int compare_entry(std::string_view entry, std::string_view key, RowId row_id) {
+    int result = entry_key(entry).compare(key);
+    if (result != 0) {
+        return result;
+    }
+    RowId entry_id = entry_row_id(entry);
+    if (entry_id.page_no != row_id.page_no) {
+        return entry_id.page_no < row_id.page_no ? -1 : 1;
+    }
+    if (entry_id.slot != row_id.slot) {
+        return entry_id.slot < row_id.slot ? -1 : 1;
+    }
+    return 0;
+}
+
+bool entry_less(std::string_view left, std::string_view right) {
+    return compare_entry(left, entry_key(right), entry_row_id(right)) < 0;
+}
+
+class Node {
+private:
+    char* data;
+
+public:
+    explicit Node(char* page_data) : data(page_data) {}
+
+    static void init(char* page_data, bool leaf, uint32_t link) {
+        std::memset(page_data, 0, PAGE_SIZE);
+        page_data[LEAF_FLAG_OFFSET] = leaf ? 1 : 0;
+        store_u16(page_data + FREE_END_OFFSET, static_cast<uint16_t>(PAGE_SIZE));
+        store_u32(page_data + LINK_OFFSET, link);
+    }
+
+    bool is_leaf() const { return data[LEAF_FLAG_OFFSET] != 0; }
+    uint16_t count() const { return load_u16(data + COUNT_OFFSET); }
+    uint32_t link() const { return load_u32(data + LINK_OFFSET); }
+    void set_link(uint32_t page_no) { store_u32(data + LINK_OFFSET, page_no); }
+
+    // Bytes left between the slot directory and the entries
+    size_t free_space() const {
+        return load_u16(data + FREE_END_OFFSET) - (NODE_HEADER_SIZE + count() * NODE_SLOT_SIZE);
+    }
+
+    // True when a bulk build should still add the entry to this node
+    bool has_bulk_room(std::string_view new_entry) const {
+        return count() == 0 || free_space() >= new_entry.size() + NODE_SLOT_SIZE + BULK_FREE_SPACE;
+    }
+
+    std::string_view entry(uint16_t index) const {
+        const char* entry_data = data + load_u16(data + NODE_HEADER_SIZE + index * NODE_SLOT_SIZE);
+        size_t size = sizeof(uint16_t) + load_u16(entry_data) + ROW_ID_SIZE;
+        size += is_leaf() ? INCLUDED_SIZE + load_u16(entry_data + size) : CHILD_SIZE;
+        return std::string_view(entry_data, size);
+    }
+
+    // First entry not less than (key, row_id)
+    uint16_t lower_bound(std::string_view key, RowId row_id) const {
+        uint16_t low = 0;
+        uint16_t high = count();
+        while (low < high) {
+            uint16_t middle = low + (high - low) / 2;
+            if (compare_entry(entry(middle), key, row_id) < 0) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
+    // First entry greater than (key, row_id)
+    uint16_t upper_bound(std::string_view key, RowId row_id) const {
+        uint16_t low = 0;
+        uint16_t high = count();
+        while (low < high) {
+            uint16_t middle = low + (high - low) / 2;
+            if (compare_entry(entry(middle), key, row_id) <= 0) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
+    // Child of an internal node that covers (key, row_id)
+    uint32_t child_for(std::string_view key, RowId row_id) const {
+        uint16_t index = upper_bound(key, row_id);
+        return index == 0 ? link() : entry_child(entry(index - 1));
+    }
+
+    // Returns false when the entry does not fit
+    bool insert(uint16_t index, std::string_view new_entry) {
+        uint16_t entry_count = count();
+        size_t slots_end = NODE_HEADER_SIZE + (entry_count + 1) * NODE_SLOT_SIZE;
+        size_t free_end = load_u16(data + FREE_END_OFFSET);
+        if (slots_end + new_entry.size() > free_end) {
+            return false;
+        }
+
+        free_end -= new_entry.size();
+        std::memcpy(data + free_end, new_entry.data(), new_entry.size());
+        char* slot = data + NODE_HEADER_SIZE + index * NODE_SLOT_SIZE;
+        std::memmove(slot + NODE_SLOT_SIZE, slot, (entry_count - index) * NODE_SLOT_SIZE);
+        store_u16(slot, static_cast<uint16_t>(free_end));
+        store_u16(data + FREE_END_OFFSET, static_cast<uint16_t>(free_end));
+        store_u16(data + COUNT_OFFSET, entry_count + 1);
+        return true;
+    }
+
+    void rewrite(bool leaf, uint32_t link, const std::vector<std::string>& entries, size_t begin, size_t end) {
+        init(data, leaf, link);
+        for (size_t i = begin; i < end; i++) {
+            if (!insert(static_cast<uint16_t>(i - begin), entries[i])) {
+                throw std::runtime_error("Index node overflow");
+            }
+        }
+    }
+
+    std::vector<std::string> copy_entries() const {
+        std::vector<std::string> entries;
+        entries.reserve(count() + 1);
+        for (uint16_t i = 0; i < count(); i++) {
+            entries.emplace_back(entry(i));
+        }
+        return entries;
+    }
+};
+
+void check_entry_size(std::string_view key_bytes, std::string_view included) {
+    if (key_bytes.size() + included.size() > MAX_INDEX_KEY_SIZE) {
+        throw std::runtime_error("Index entry too long: " + std::to_string(key_bytes.size() + included.size()) +
+                                 " bytes of key and included columns, limit is " +
+                                 std::to_string(MAX_INDEX_KEY_SIZE));
+    }
+}
+
+// Index where the left half of a split ends, balancing bytes
+size_t split_point(const std::vector<std::string>& entries) {
+    size_t total = 0;
+    for (const std::string& entry : entries) {
+        total += entry.size() + NODE_SLOT_SIZE;
+    }
+
+    size_t left = 0;
+    size_t split = 0;
+    while (split < entries.size() - 1 && left + entries[split].size() + NODE_SLOT_SIZE <= total / 2) {
+        left += entries[split].size() + NODE_SLOT_SIZE;
+        split++;
+    }
+    return std::max<size_t>(split, 1);
+}
+
+// Reads back a run spilled by a bulk build: u32 size, then the entry
+class SpilledRun {
+private:
+    std::ifstream file;
+    std::string entry;
+    bool has_entry;
+
+public:
+    explicit SpilledRun(const std::string& path) : file(path, std::ios::binary), has_entry(false) {
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot open index sort run: " + path);
+        }
+        next();
+    }
+
+    bool valid() const { return has_entry; }
+    const std::string& get_entry() const { return entry; }
+
+    void next() {
+        uint32_t size;
+        has_entry = static_cast<bool>(file.read(reinterpret_cast<char*>(&size), sizeof(size)));
+        if (has_entry) {
+            entry.resize(size);
+            if (!file.read(entry.data(), size)) {
+                throw std::runtime_error("Index sort run is truncated");
+            }
+        }
+    }
+};
+
+} // namespace
+
+std::string encode_index_key(DataType type, const Value& value) {
+    switch (type) {
+        case DataType::INTEGER: {
+            uint32_t bits = static_cast<uint32_t>(std::get<int>(value)) ^ 0x80000000u;
+            char bytes[sizeof(bits)];
+            for (size_t i = 0; i < sizeof(bits); i++) {
+                bytes[i] = static_cast<char>(bits >> (8 * (sizeof(bits) - 1 - i)));
+            }
+            return std::string(bytes, sizeof(bytes));
+        }
+        case DataType::BOOLEAN:
+            return std::string(1, std::get<bool>(value) ? 1 : 0);
+        case DataType::VARCHAR: {
+            const std::string& text = std::get<std::string>(value);
+            if (text.size() > MAX_INDEX_KEY_SIZE) {
+                throw std::runtime_error("Value too long for an index key: " + std::to_string(text.size()) +
+                                         " bytes, limit is " + std::to_string(MAX_INDEX_KEY_SIZE));
+            }
+            return text;
+        }
+    }
+    throw std::runtime_error("Unknown data type for index key");
+}
+
+Value decode_index_key(DataType type, std::string_view bytes) {
+    switch (type) {
+        case DataType::INTEGER: {
+            uint32_t bits = 0;
+            for (size_t i = 0; i < sizeof(bits); i++) {
+                bits = (bits << 8) | static_cast<unsigned char>(bytes[i]);
+            }
+            return static_cast<int>(bits ^ 0x80000000u);
+        }
+        case DataType::BOOLEAN:
+            return bytes[0] != 0;
+        case DataType::VARCHAR:
+            return std::string(bytes);
+    }
+    throw std::runtime_error("Unknown data type for index key");
+}
+
+BPlusTree::BPlusTree(BufferPool* buffer_pool, const std::string& file_path, DataType key_type)
+    : buffer_pool(buffer_pool), file_path(file_path), file_id(0), key_type(key_type), rebuilt(false) {
+    if (!std::filesystem::exists(file_path)) {
+        write_empty_file();
+    }
+    file_id = buffer_pool->register_file(file_path);
+
+    // An index from another schema, a damaged one or an unfinished build is
+    // started over
+    if (!header_matches()) {
+        buffer_pool->drop_file(file_path);
+        write_empty_file();
+        file_id = buffer_pool->register_file(file_path);
+        rebuilt = true;
+    }
+}
+
+void BPlusTree::write_empty_file() {
+    std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot create index file: " + file_path);
+    }
+
+    // No root yet; the first insert creates it
+    char header[PAGE_SIZE] = {};
+    std::memcpy(header, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header[KEY_TYPE_OFFSET] = static_cast<char>(key_type);
+    header[STATE_OFFSET] = STATE_BUILDING;
+
+    file.write(header, PAGE_SIZE);
+    if (!file) {
+        throw std::runtime_error("Cannot write index file: " + file_path);
+    }
+}
+
+bool BPlusTree::header_matches() {
+    if (buffer_pool->get_page_count(file_id) == 0) {
+        return false;
+    }
+
+    PageGuard guard(buffer_pool, file_id, 0);
+    const char* header = guard.get_data();
+    return std::memcmp(header, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+           header[KEY_TYPE_OFFSET] == static_cast<char>(key_type) && header[STATE_OFFSET] == STATE_READY;
+}
+
+uint32_t BPlusTree::get_root() {
+    PageGuard guard(buffer_pool, file_id, 0);
+    return load_u32(guard.get_data() + ROOT_OFFSET);
+}
+
+void BPlusTree::set_root(uint32_t root_page_no, uint64_t lsn) {
+    PageGuard guard(buffer_pool, file_id, 0);
+    store_u32(guard.get_data() + ROOT_OFFSET, root_page_no);
+    guard.mark_dirty(lsn);
+}
+
+uint32_t BPlusTree::find_leaf(std::string_view key, RowId row_id, std::vector<uint32_t>* path) {
+    uint32_t page_no = get_root();
+    while (true) {
+        PageGuard guard(buffer_pool, file_id, page_no);
+        Node node(guard.get_data());
+        if (node.is_leaf()) {
+            return page_no;
+        }
+        if (path) {
+            path->push_back(page_no);
+        }
+        page_no = node.child_for(key, row_id);
+    }
+}
+
+void BPlusTree::check_key(const Value& key) const {
+    check_entry(key, std::string_view());
+}
+
+void BPlusTree::insert(const Value& key, RowId row_id, uint64_t lsn) {
+    insert_entry(key, std::string_view(), row_id, lsn);
+}
+
+void BPlusTree::check_entry(const Value& key, std::string_view included) const {
+    // Throws for entries the tree cannot hold
+    check_entry_size(encode_index_key(key_type, key), included);
+}
+
+void BPlusTree::insert_entry(const Value& key, std::string_view included, RowId row_id, uint64_t lsn) {
+    std::string key_bytes = encode_index_key(key_type, key);
+    check_entry_size(key_bytes, included);
+    std::string entry = make_entry(key_bytes, row_id, included);
+
+    if (get_root() == 0) {
+        PageGuard root(buffer_pool, file_id);
+        Node::init(root.get_data(), true, 0);
+        Node(root.get_data()).insert(0, entry);
+        root.mark_dirty(lsn);
+        set_root(root.get_page_no(), lsn);
+        return;
+    }
+
+    std::vector<uint32_t> path;
+    uint32_t leaf_page_no = find_leaf(key_bytes, row_id, &path);
+
+    std::string separator;
+    uint32_t right_page_no = 0;
+    {
+        PageGuard leaf_guard(buffer_pool, file_id, leaf_page_no);
+        Node leaf(leaf_guard.get_data());
+        uint16_t index = leaf.lower_bound(key_bytes, row_id);
+        if (index < leaf.count() && compare_entry(leaf.entry(index), key_bytes, row_id) == 0) {
+            return;
+        }
+        leaf_guard.mark_dirty(lsn);
+        if (leaf.insert(index, entry)) {
+            return;
+        }
+
+        // Split: the upper half moves to a new leaf linked after this one
+        std::vector<std::string> entries = leaf.copy_entries();
+        entries.insert(entries.begin() + index, entry);
+        size_t split = split_point(entries);
+
+        PageGuard right_guard(buffer_pool, file_id);
+        right_page_no = right_guard.get_page_no();
+        Node(right_guard.get_data()).rewrite(true, leaf.link(), entries, split, entries.size());
+        right_guard.mark_dirty(lsn);
+        leaf.rewrite(true, right_page_no, entries, 0, split);
+        separator = entries[split];
+    }
+
+    insert_into_parent(path, leaf_page_no, separator, right_page_no, lsn);
+}
+
+void BPlusTree::insert_into_parent(std::vector<uint32_t>& path, uint32_t left_page_no, const std::string& separator,
+                                   uint32_t right_page_no, uint64_t lsn) {
+    std::string entry = make_internal_entry(separator, right_page_no);
+
+    if (path.empty()) {
+        // The root split, the tree grows by one level
+        PageGuard root(buffer_pool, file_id);
+        Node::init(root.get_data(), false, left_page_no);
+        Node(root.get_data()).insert(0, entry);
+        root.mark_dirty(lsn);
+        set_root(root.get_page_no(), lsn);
+        return;
+    }
+
+    uint32_t parent_page_no = path.back();
+    path.pop_back();
+
+    std::string up_separator;
+    uint32_t new_page_no = 0;
+    {
+        PageGuard parent_guard(buffer_pool, file_id, parent_page_no);
+        Node parent(parent_guard.get_data());
+        std::string_view key = entry_key(entry);
+        uint16_t index = parent.lower_bound(key, entry_row_id(entry));
+        parent_guard.mark_dirty(lsn);
+        if (parent.insert(index, entry)) {
+            return;
+        }
+
+        // Split: the middle entry moves up and its child becomes the
+        // leftmost child of the new node
+        std::vector<std::string> entries = parent.copy_entries();
+        entries.insert(entries.begin() + index, entry);
+        size_t middle = split_point(entries);
+
+        PageGuard right_guard(buffer_pool, file_id);
+        new_page_no = right_guard.get_page_no();
+        Node(right_guard.get_data()).rewrite(false, entry_child(entries[middle]), entries, middle + 1,
+                                             entries.size());
+        right_guard.mark_dirty(lsn);
+        parent.rewrite(false, parent.link(), entries, 0, middle);
+        up_separator = entries[middle];
+    }
+
+    insert_into_parent(path, parent_page_no, up_separator, new_page_no, lsn);
+}
+
+bool BPlusTree::contains(const Value& key) {
+    RowId row_id;
+    return open_equal(key)->next(row_id);
+}
+
+std::unique_ptr<RowIdCursor> BPlusTree::open_equal(const Value& key) {
+    return open_range(&key, true, &key, true);
+}
+
+std::unique_ptr<RowIdCursor> BPlusTree::open_range(const Value* lower, bool lower_inclusive, const Value* upper,
+                                                   bool upper_inclusive) {
+    return open_entries(lower, lower_inclusive, upper, upper_inclusive, false);
+}
+
+std::unique_ptr<BTreeCursor> BPlusTree::open_entries(const Value* lower, bool lower_inclusive, const Value* upper,
+                                                     bool upper_inclusive, bool keep_entries) {
+    std::unique_ptr<BTreeCursor> cursor(new BTreeCursor(buffer_pool, file_id, key_type, keep_entries));
+    if (upper) {
+        cursor->has_upper = true;
+        cursor->upper = encode_index_key(key_type, *upper);
+        cursor->upper_inclusive = upper_inclusive;
+    }
+    if (get_root() == 0) {
+        return cursor;
+    }
+
+    // Row ids order the entries of one key, so the smallest or largest one
+    // lands before or after all of them; no lower bound starts at the
+    // leftmost leaf because the empty key sorts first
+    std::string lower_key = lower ? encode_index_key(key_type, *lower) : std::string();
+    RowId bound = (lower && !lower_inclusive) ? RowId{UINT32_MAX, UINT16_MAX} : RowId{0, 0};
+    cursor->page_no = find_leaf(lower_key, bound, nullptr);
+
+    PageGuard guard(buffer_pool, file_id, cursor->page_no);
+    Node leaf(guard.get_data());
+    cursor->index = (lower && !lower_inclusive) ? leaf.upper_bound(lower_key, bound)
+                                                : leaf.lower_bound(lower_key, bound);
+    return cursor;
+}
+
+void BTreeCursor::read_leaf() {
+    buffer.clear();
+    keys.clear();
+    included_values.clear();
+    buffer_position = 0;
+
+    PageGuard guard(buffer_pool, file_id, page_no);
+    Node leaf(guard.get_data());
+    for (; index < leaf.count(); index++) {
+        std::string_view entry = leaf.entry(index);
+        if (has_upper) {
+            int order = entry_key(entry).compare(upper);
+            if (order > 0 || (order == 0 && !upper_inclusive)) {
+                page_no = 0;
+                return;
+            }
+        }
+        buffer.push_back(entry_row_id(entry));
+        if (keep_entries) {
+            keys.emplace_back(entry_key(entry));
+            included_values.emplace_back(entry_included(entry));
+        }
+    }
+
+    page_no = leaf.link();
+    index = 0;
+}
+
+bool BTreeCursor::next(RowId& row_id) {
+    // Leaves can be empty of matches, keep walking until one has some
+    while (buffer_position >= buffer.size()) {
+        if (page_no == 0) {
+            return false;
+        }
+        read_leaf();
+    }
+    row_id = buffer[buffer_position++];
+    return true;
+}
+
+Value BTreeCursor::key() const {
+    return decode_index_key(key_type, keys[buffer_position - 1]);
+}
+
+std::string_view BTreeCursor::included() const {
+    return included_values[buffer_position - 1];
+}
+
+void BPlusTree::clear() {
+    buffer_pool->drop_file(file_path);
+    write_empty_file();
+    file_id = buffer_pool->register_file(file_path);
+}
+
+void BPlusTree::finish_build() {
+    // Every node must be on disk before the header vouches for them
+    buffer_pool->flush_file(file_id);
+    buffer_pool->sync_all();
+    {
+        PageGuard guard(buffer_pool, file_id, 0);
+        guard.get_data()[STATE_OFFSET] = STATE_READY;
+        guard.mark_dirty();
+    }
+    buffer_pool->flush_file(file_id);
+    buffer_pool->sync_all();
+    rebuilt = false;
+}
+
+void BPlusTree::delete_file() {
+    buffer_pool->drop_file(file_path);
+
+    std::error_code ec;
+    std::filesystem::remove(file_path, ec);
+    // Ignore errors if file doesn't exist
+}
+
+BTreeBuilder::BTreeBuilder(BPlusTree* tree, size_t memory_budget) : tree(tree), memory_budget(memory_budget) {
+    if (tree->get_root() != 0) {
+        throw std::runtime_error("Bulk build needs an empty index: " + tree->file_path);
+    }
+}
+
+BTreeBuilder::~BTreeBuilder() {
+    leaf.reset();
+    std::error_code ec;
+    for (const std::string& path : run_paths) {
+        std::filesystem::remove(path, ec);
+    }
+}
+
+void BTreeBuilder::add(const Value& key, std::string_view included, RowId row_id) {
+    std::string key_bytes = encode_index_key(tree->key_type, key);
+    check_entry_size(key_bytes, included);
+    offsets.push_back(pending.size());
+    pending.append(make_entry(key_bytes, row_id, included));
+
+    if (pending.size() + offsets.size() * sizeof(size_t) >= memory_budget) {
+        spill();
+    }
+}
+
+void BTreeBuilder::spill() {
+    std::sort(offsets.begin(), offsets.end(), [this](size_t left, size_t right) {
+        return entry_less(leaf_entry_at(pending.data() + left), leaf_entry_at(pending.data() + right));
+    });
+
+    std::string path = tree->file_path + ".sort" + std::to_string(run_paths.size());
+    run_paths.push_back(path);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot create index sort run: " + path);
+    }
+    for (size_t offset : offsets) {
+        std::string_view entry = leaf_entry_at(pending.data() + offset);
+        uint32_t size = static_cast<uint32_t>(entry.size());
+        file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        file.write(entry.data(), entry.size());
+    }
+    if (!file) {
+        throw std::runtime_error("Cannot write index sort run: " + path);
+    }
+
+    pending.clear();
+    offsets.clear();
+}
+
+bool BTreeBuilder::finish(bool reject_duplicates) {
+    std::string previous_key;
+    bool has_previous = false;
+    auto emit = [&](std::string_view entry) {
+        if (reject_duplicates) {
+            std::string_view key = entry_key(entry);
+            if (has_previous && key == previous_key) {
+                return false;
+            }
+            previous_key.assign(key);
+            has_previous = true;
+        }
+        pack(entry);
+        return true;
+    };
+
+    if (run_paths.empty()) {
+        // Everything fit in memory
+        std::sort(offsets.begin(), offsets.end(), [this](size_t left, size_t right) {
+            return entry_less(leaf_entry_at(pending.data() + left), leaf_entry_at(pending.data() + right));
+        });
+        for (size_t offset : offsets) {
+            if (!emit(leaf_entry_at(pending.data() + offset))) {
+                return false;
+            }
+        }
+    } else {
+        if (!offsets.empty()) {
+            spill();
+        }
+        std::vector<std::unique_ptr<SpilledRun>> runs;
+        for (const std::string& path : run_paths) {
+            runs.push_back(std::make_unique<SpilledRun>(path));
+        }
+
+        auto later = [&runs](size_t left, size_t right) {
+            return entry_less(runs[right]->get_entry(), runs[left]->get_entry());
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+        for (size_t i = 0; i < runs.size(); i++) {
+            if (runs[i]->valid()) {
+                heap.push(i);
+            }
+        }
+        while (!heap.empty()) {
+            size_t i = heap.top();
+            heap.pop();
+            if (!emit(runs[i]->get_entry())) {
+                return false;
+            }
+            runs[i]->next();
+            if (runs[i]->valid()) {
+                heap.push(i);
+            }
+        }
+    }
+
+    leaf.reset();
+    if (!open_nodes.empty()) {
+        tree->set_root(open_nodes.back(), 0);
+    }
+    pending.clear();
+    offsets.clear();
+    return true;
+}
+
+void BTreeBuilder::pack(std::string_view entry) {
+    if (!leaf) {
+        leaf = std::make_unique<PageGuard>(tree->buffer_pool, tree->file_id);
+        Node::init(leaf->get_data(), true, 0);
+        open_nodes.push_back(leaf->get_page_no());
+    }
+
+    if (!Node(leaf->get_data()).has_bulk_room(entry)) {
+        auto next = std::make_unique<PageGuard>(tree->buffer_pool, tree->file_id);
+        Node::init(next->get_data(), true, 0);
+        Node(leaf->get_data()).set_link(next->get_page_no());
+        uint32_t left_page_no = leaf->get_page_no();
+        leaf = std::move(next);
+        open_nodes[0] = leaf->get_page_no();
+        add_separator(1, entry, left_page_no, open_nodes[0]);
+    }
+
+    Node node(leaf->get_data());
+    node.insert(node.count(), entry);
+}
+
+void BTreeBuilder::add_separator(size_t level, std::string_view separator, uint32_t left_page_no,
+                                 uint32_t right_page_no) {
+    std::string entry = make_internal_entry(separator, right_page_no);
+
+    // The level below the root split: a new root goes on top
+    if (level == open_nodes.size()) {
+        PageGuard guard(tree->buffer_pool, tree->file_id);
+        Node::init(guard.get_data(), false, left_page_no);
+        Node(guard.get_data()).insert(0, entry);
+        open_nodes.push_back(guard.get_page_no());
+        return;
+    }
+
+    uint32_t page_no = open_nodes[level];
+    {
+        PageGuard guard(tree->buffer_pool, tree->file_id, page_no);
+        Node node(guard.get_data());
+        if (node.has_bulk_room(entry)) {
+            node.insert(node.count(), entry);
+            guard.mark_dirty();
+            return;
+        }
+    }
+
+    // Full: the separator moves up and its child starts the next node
+    PageGuard guard(tree->buffer_pool, tree->file_id);
+    Node::init(guard.get_data(), false, right_page_no);
+    open_nodes[level] = guard.get_page_no();
+    add_separator(level + 1, separator, page_no, open_nodes[level]);
+}
+
+} // namespace sqldb
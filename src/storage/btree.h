@@ -0,0 +1,168 @@
+#ifndef BTREE_H
+#define BTREE_H
+
+#include "../common/types.h"
+#include "key_index.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqldb {
+
+class BufferPool;
+class PageGuard;
+
+// Longest encoded key, together with any included column values, an index
+// entry holds; keeps at least four entries per node
+constexpr size_t MAX_INDEX_KEY_SIZE = 1000;
+
+// Byte form of a key whose memcmp order matches the value order: INTEGER as
+// big-endian with the sign bit flipped, BOOLEAN as one byte, VARCHAR as is
+std::string encode_index_key(DataType type, const Value& value);
+Value decode_index_key(DataType type, std::string_view bytes);
+
+// Walks the leaf chain of a BPlusTree in key order from a lower bound up to
+// an upper bound. Row ids are copied out one leaf at a time, so no page stays
+// pinned between calls; cursors opened to keep entries also copy each key
+// and its included values.
+class BTreeCursor : public RowIdCursor {
+private:
+    friend class BPlusTree;
+
+    BufferPool* buffer_pool;
+    uint32_t file_id;
+    uint32_t page_no;     // Next leaf to read, 0 once the chain is exhausted
+    uint16_t index;       // First entry to read in that leaf
+    bool has_upper;
+    std::string upper;
+    bool upper_inclusive;
+    DataType key_type;
+    bool keep_entries;
+
+    std::vector<RowId> buffer;
+    std::vector<std::string> keys;
+    std::vector<std::string> included_values;
+    size_t buffer_position;
+
+    BTreeCursor(BufferPool* buffer_pool, uint32_t file_id, DataType key_type, bool keep_entries)
+        : buffer_pool(buffer_pool), file_id(file_id), page_no(0), index(0), has_upper(false),
+          upper_inclusive(false), key_type(key_type), keep_entries(keep_entries), buffer_position(0) {}
+
+    void read_leaf();
+
+public:
+    bool next(RowId& row_id) override;
+
+    // The entry next() last returned, when opened to keep entries
+    Value key() const;
+    std::string_view included() const;
+};
+
+// Disk-resident B+tree over (key, row id) entries, paged through the buffer
+// pool. Entries are unique because the row id is part of the sort order, so
+// one tree serves unique and non-unique keys alike; uniqueness is up to the
+// caller through contains(). Leaves are chained left to right.
+//
+// Leaf entries may also carry the encoded values of other columns, so a
+// covering index answers a query without visiting the table.
+//
+// Node pages are not logged. They carry the LSN of the insert that changed
+// them, so none reaches the disk ahead of its log record, and the owner
+// rebuilds the tree from the table whenever recovery replayed inserts into it.
+class BPlusTree : public KeyIndex {
+private:
+    friend class BTreeBuilder;
+
+    BufferPool* buffer_pool;
+    std::string file_path;
+    uint32_t file_id;
+    DataType key_type;
+    bool rebuilt;
+
+    void write_empty_file();
+    bool header_matches();
+    uint32_t get_root();
+    void set_root(uint32_t root_page_no, uint64_t lsn);
+
+    // Descent; path receives the internal pages visited, root first
+    uint32_t find_leaf(std::string_view key, RowId row_id, std::vector<uint32_t>* path);
+    void insert_into_parent(std::vector<uint32_t>& path, uint32_t left_page_no, const std::string& separator,
+                            uint32_t right_page_no, uint64_t lsn);
+
+public:
+    BPlusTree(BufferPool* buffer_pool, const std::string& file_path, DataType key_type);
+
+    // True when the file was missing, unusable or left half built
+    bool needs_rebuild() const override { return rebuilt; }
+
+    // Maintenance
+    void check_key(const Value& key) const override;
+    void insert(const Value& key, RowId row_id, uint64_t lsn = 0) override;
+    void clear() override;
+    void finish_build() override;
+    void delete_file() override;
+
+    // Maintenance of covering indexes; included is the encoded values of the
+    // INCLUDE columns
+    void check_entry(const Value& key, std::string_view included) const;
+    void insert_entry(const Value& key, std::string_view included, RowId row_id, uint64_t lsn = 0);
+
+    // Lookups
+    bool contains(const Value& key) override;
+    std::unique_ptr<RowIdCursor> open_equal(const Value& key) override;
+    bool is_ordered() const override { return true; }
+    std::unique_ptr<RowIdCursor> open_range(const Value* lower, bool lower_inclusive, const Value* upper,
+                                            bool upper_inclusive) override;
+    std::unique_ptr<BTreeCursor> open_entries(const Value* lower, bool lower_inclusive, const Value* upper,
+                                              bool upper_inclusive, bool keep_entries = true);
+};
+
+// Memory a bulk build sorts entries in before spilling them to a file
+constexpr size_t BULK_BUILD_MEMORY = 64 * 1024 * 1024;
+
+// Fills an empty BPlusTree from entries given in any order, without
+// descending the tree once per entry. Entries are sorted in memory and
+// spilled as sorted runs beside the index file whenever the budget fills;
+// finish() merges the runs and packs the entries into leaves left to
+// right, adding each leaf to the internal level above as it goes. Memory
+// stays within the budget plus one open node per level, every node is
+// written once and the leaves end up in key order in the file.
+class BTreeBuilder {
+private:
+    BPlusTree* tree;
+    size_t memory_budget;
+
+    // Entries waiting to be sorted, back to back, and where each starts
+    std::string pending;
+    std::vector<size_t> offsets;
+    std::vector<std::string> run_paths;
+
+    // Rightmost node of each level while packing, leaves first
+    std::vector<uint32_t> open_nodes;
+    std::unique_ptr<PageGuard> leaf;
+
+    void spill();
+    void pack(std::string_view entry);
+    void add_separator(size_t level, std::string_view separator, uint32_t left_page_no, uint32_t right_page_no);
+
+public:
+    explicit BTreeBuilder(BPlusTree* tree, size_t memory_budget = BULK_BUILD_MEMORY);
+    ~BTreeBuilder();
+
+    BTreeBuilder(const BTreeBuilder&) = delete;
+    BTreeBuilder& operator=(const BTreeBuilder&) = delete;
+
+    // included is the encoded values of the INCLUDE columns, if any
+    void add(const Value& key, std::string_view included, RowId row_id);
+
+    // Writes the tree; returns false, leaving it unfinished, when
+    // reject_duplicates is set and two entries share a key
+    bool finish(bool reject_duplicates);
+};
+
+} // namespace sqldb
+
+#endif // BTREE_H
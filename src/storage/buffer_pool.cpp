@@ -0,0 +1,436 @@
+#include "buffer_pool.h"
+#include "wal.h"
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sqldb {
+
+BufferPool::BufferPool(size_t memory_budget_bytes, size_t max_open_files)
+    : capacity(memory_budget_bytes / PAGE_SIZE), clock_hand(0), next_file_id(1),
+      max_open_files(max_open_files), open_files(0), file_clock(0), wal(nullptr) {
+    if (capacity == 0) {
+        throw std::runtime_error("Buffer pool budget must hold at least one page");
+    }
+    if (max_open_files == 0) {
+        throw std::runtime_error("Buffer pool must be allowed at least one open file");
+    }
+    // Frames are allocated on first use so an idle pool costs no memory
+    frames.reserve(capacity);
+    stats.capacity_pages = capacity;
+}
+
+BufferPool::~BufferPool() {
+    try {
+        flush_all();
+    } catch (const std::exception& e) {
+        // Nothing sensible to do on shutdown, pages already written stay valid
+    }
+
+    for (auto& [file_id, file] : files) {
+        if (file.fd >= 0) {
+            ::close(file.fd);
+        }
+    }
+}
+
+int BufferPool::get_fd(FileState& file) {
+    if (file.fd < 0) {
+        open_fd(file);
+    }
+    file.last_used = ++file_clock;
+    return file.fd;
+}
+
+void BufferPool::open_fd(FileState& file) {
+    // Stay within the descriptor budget by closing the least recently used file
+    if (open_files >= max_open_files) {
+        FileState* victim = nullptr;
+        for (auto& [file_id, candidate] : files) {
+            // A descriptor in use by an unlocked read or write stays open
+            if (candidate.fd >= 0 && candidate.io_count == 0 &&
+                (!victim || candidate.last_used < victim->last_used)) {
+                victim = &candidate;
+            }
+        }
+        if (victim) {
+            close_fd(*victim);
+        }
+    }
+
+    file.fd = ::open(file.path.c_str(), O_RDWR);
+    if (file.fd < 0) {
+        throw std::runtime_error("Cannot open file: " + file.path);
+    }
+    open_files++;
+    stats.file_opens++;
+}
+
+void BufferPool::close_fd(FileState& file) {
+    // Closing does not make earlier writes durable; sync_all may no longer
+    // reach them through this descriptor
+    if (file.needs_sync && ::fsync(file.fd) != 0) {
+        throw std::runtime_error("Cannot sync file: " + file.path);
+    }
+    file.needs_sync = false;
+    ::close(file.fd);
+    file.fd = -1;
+    open_files--;
+}
+
+BufferPool::FileState& BufferPool::get_file(uint32_t file_id) {
+    auto it = files.find(file_id);
+    if (it == files.end()) {
+        throw std::runtime_error("Unknown buffer pool file id: " + std::to_string(file_id));
+    }
+    return it->second;
+}
+
+uint32_t BufferPool::register_file(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = file_ids.find(path);
+    if (it != file_ids.end()) {
+        return it->second;
+    }
+
+    FileState file;
+    file.path = path;
+    open_fd(file);
+
+    struct stat st;
+    if (::fstat(file.fd, &st) != 0) {
+        close_fd(file);
+        throw std::runtime_error("Cannot stat file: " + path);
+    }
+    file.page_count = static_cast<uint32_t>(st.st_size / PAGE_SIZE);
+    file.last_used = ++file_clock;
+
+    uint32_t file_id = next_file_id++;
+    files[file_id] = file;
+    file_ids[path] = file_id;
+    return file_id;
+}
+
+void BufferPool::drop_file(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = file_ids.find(path);
+    if (it == file_ids.end()) {
+        return;
+    }
+
+    uint32_t file_id = it->second;
+    discard_frames(file_id);
+
+    FileState& file = get_file(file_id);
+    if (file.fd >= 0) {
+        // The file is about to be deleted, its contents need no sync
+        file.needs_sync = false;
+        close_fd(file);
+    }
+    files.erase(file_id);
+    file_ids.erase(it);
+}
+
+uint32_t BufferPool::get_page_count(uint32_t file_id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return get_file(file_id).page_count;
+}
+
+size_t BufferPool::acquire_frame(std::unique_lock<std::mutex>& lock) {
+    // The frame is handed back pinned, so no other thread takes it while the
+    // lock is down for a write-back or the caller's read
+    if (frames.size() < capacity) {
+        // Capacity is reserved up front, so this never moves other frames
+        frames.emplace_back();
+        frames.back().data = std::make_unique<char[]>(PAGE_SIZE);
+        frames.back().pin_count = 1;
+        return frames.size() - 1;
+    }
+
+    // Clock sweep: two full turns clear every reference bit at least once
+    for (size_t step = 0; step < 2 * frames.size(); step++) {
+        Frame& frame = frames[clock_hand];
+        size_t index = clock_hand;
+        clock_hand = (clock_hand + 1) % frames.size();
+
+        if (frame.pin_count > 0) {
+            continue;
+        }
+        if (frame.referenced) {
+            frame.referenced = false;
+            continue;
+        }
+
+        frame.pin_count = 1;
+        if (frame.in_use) {
+            if (frame.dirty) {
+                // Threads wanting the page wait until it is on disk
+                frame.io_in_progress = true;
+                try {
+                    write_frame_unlocked(lock, frame);
+                } catch (...) {
+                    frame.io_in_progress = false;
+                    frame.pin_count = 0;
+                    io_done.notify_all();
+                    throw;
+                }
+                frame.io_in_progress = false;
+            }
+            page_table.erase(make_key(frame.file_id, frame.page_no));
+            frame.in_use = false;
+            stats.evictions++;
+            io_done.notify_all();
+        }
+        return index;
+    }
+
+    throw std::runtime_error("Buffer pool exhausted: all pages are pinned");
+}
+
+void BufferPool::write_frame_unlocked(std::unique_lock<std::mutex>& lock, Frame& frame) {
+    FileState& file = get_file(frame.file_id);
+    int fd = get_fd(file);
+    file.io_count++;
+    uint64_t lsn = frame.lsn;
+    off_t offset = static_cast<off_t>(frame.page_no) * PAGE_SIZE;
+    // Cleared first, so a change unpinned during the write marks it again
+    frame.dirty = false;
+    lock.unlock();
+
+    ssize_t written;
+    try {
+        // Write-ahead rule: the log must cover every change on the page
+        if (wal && lsn > 0) {
+            wal->flush(lsn);
+        }
+        written = ::pwrite(fd, frame.data.get(), PAGE_SIZE, offset);
+    } catch (...) {
+        lock.lock();
+        file.io_count--;
+        frame.dirty = true;
+        throw;
+    }
+
+    lock.lock();
+    file.io_count--;
+    if (written != static_cast<ssize_t>(PAGE_SIZE)) {
+        frame.dirty = true;
+        throw std::runtime_error("Cannot write page " + std::to_string(frame.page_no) + " of " + file.path);
+    }
+    file.needs_sync = true;
+    stats.writebacks++;
+}
+
+void BufferPool::write_back(std::unique_lock<std::mutex>& lock, Frame& frame) {
+    // Pinned so the clock passes it over while the lock is down
+    frame.pin_count++;
+    frame.io_in_progress = true;
+    try {
+        write_frame_unlocked(lock, frame);
+    } catch (...) {
+        frame.io_in_progress = false;
+        frame.pin_count--;
+        io_done.notify_all();
+        throw;
+    }
+    frame.io_in_progress = false;
+    frame.pin_count--;
+    io_done.notify_all();
+}
+
+void BufferPool::read_into_frame(std::unique_lock<std::mutex>& lock, Frame& frame, FileState& file,
+                                 uint32_t page_no) {
+    int fd = get_fd(file);
+    file.io_count++;
+    lock.unlock();
+
+    off_t offset = static_cast<off_t>(page_no) * PAGE_SIZE;
+    ssize_t bytes_read = ::pread(fd, frame.data.get(), PAGE_SIZE, offset);
+
+    lock.lock();
+    file.io_count--;
+    if (bytes_read != static_cast<ssize_t>(PAGE_SIZE)) {
+        throw std::runtime_error("Short read on page " + std::to_string(page_no) + " of " + file.path);
+    }
+}
+
+void BufferPool::wait_for_io(std::unique_lock<std::mutex>& lock, const Frame& frame) {
+    io_done.wait(lock, [&frame] { return !frame.io_in_progress; });
+}
+
+void BufferPool::discard_frames(uint32_t file_id) {
+    for (Frame& frame : frames) {
+        if (!frame.in_use || frame.file_id != file_id) {
+            continue;
+        }
+        if (frame.pin_count > 0) {
+            throw std::runtime_error("Cannot release a file with pinned pages");
+        }
+        page_table.erase(make_key(frame.file_id, frame.page_no));
+        frame.in_use = false;
+        frame.dirty = false;
+    }
+}
+
+char* BufferPool::fetch_page(uint32_t file_id, uint32_t page_no) {
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t key = make_key(file_id, page_no);
+
+    while (true) {
+        auto it = page_table.find(key);
+        if (it != page_table.end()) {
+            Frame& frame = frames[it->second];
+            // Being read in or written back; look again once that is done
+            if (frame.io_in_progress) {
+                wait_for_io(lock, frame);
+                continue;
+            }
+            frame.pin_count++;
+            frame.referenced = true;
+            stats.hits++;
+            return frame.data.get();
+        }
+
+        FileState& file = get_file(file_id);
+        if (page_no >= file.page_count) {
+            throw std::runtime_error("Page " + std::to_string(page_no) + " is past the end of " + file.path);
+        }
+
+        size_t index = acquire_frame(lock);
+        Frame& frame = frames[index];
+        // Another thread may have read the page in while a victim was written
+        if (page_table.count(key) != 0) {
+            frame.pin_count = 0;
+            continue;
+        }
+
+        stats.misses++;
+        frame.file_id = file_id;
+        frame.page_no = page_no;
+        frame.pin_count = 1;
+        frame.dirty = false;
+        frame.referenced = true;
+        frame.in_use = true;
+        frame.io_in_progress = true;
+        frame.lsn = 0;
+        page_table[key] = index;
+
+        try {
+            read_into_frame(lock, frame, get_file(file_id), page_no);
+        } catch (...) {
+            page_table.erase(key);
+            frame.in_use = false;
+            frame.pin_count = 0;
+            frame.io_in_progress = false;
+            io_done.notify_all();
+            throw;
+        }
+        frame.io_in_progress = false;
+        io_done.notify_all();
+        return frame.data.get();
+    }
+}
+
+char* BufferPool::new_page(uint32_t file_id, uint32_t& page_no) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    size_t index = acquire_frame(lock);
+    Frame& frame = frames[index];
+    std::memset(frame.data.get(), 0, PAGE_SIZE);
+
+    FileState& file = get_file(file_id);
+    page_no = file.page_count++;
+    frame.file_id = file_id;
+    frame.page_no = page_no;
+    frame.pin_count = 1;
+    frame.dirty = true;
+    frame.referenced = true;
+    frame.in_use = true;
+    frame.lsn = 0;
+    page_table[make_key(file_id, page_no)] = index;
+    return frame.data.get();
+}
+
+void BufferPool::unpin_page(uint32_t file_id, uint32_t page_no, bool is_dirty, uint64_t lsn) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = page_table.find(make_key(file_id, page_no));
+    if (it == page_table.end()) {
+        return;
+    }
+
+    Frame& frame = frames[it->second];
+    if (frame.pin_count > 0) {
+        frame.pin_count--;
+    }
+    if (is_dirty) {
+        frame.dirty = true;
+    }
+    if (lsn > frame.lsn) {
+        frame.lsn = lsn;
+    }
+}
+
+// Write-back waits out a page's unlocked I/O: an eviction's write must land
+// before a flush reports the page as on disk
+
+void BufferPool::flush_page(uint32_t file_id, uint32_t page_no) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    auto it = page_table.find(make_key(file_id, page_no));
+    if (it != page_table.end()) {
+        wait_for_io(lock, frames[it->second]);
+    }
+    it = page_table.find(make_key(file_id, page_no));
+    if (it != page_table.end() && frames[it->second].dirty) {
+        write_back(lock, frames[it->second]);
+    }
+}
+
+void BufferPool::flush_file(uint32_t file_id) {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (Frame& frame : frames) {
+        wait_for_io(lock, frame);
+        if (frame.in_use && frame.dirty && frame.file_id == file_id) {
+            write_back(lock, frame);
+        }
+    }
+}
+
+void BufferPool::flush_all() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (Frame& frame : frames) {
+        wait_for_io(lock, frame);
+        if (frame.in_use && frame.dirty) {
+            write_back(lock, frame);
+        }
+    }
+}
+
+void BufferPool::sync_all() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& [file_id, file] : files) {
+        if (!file.needs_sync) {
+            continue;
+        }
+        if (::fsync(get_fd(file)) != 0) {
+            throw std::runtime_error("Cannot sync file: " + file.path);
+        }
+        file.needs_sync = false;
+    }
+}
+
+BufferPoolStats BufferPool::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    BufferPoolStats result = stats;
+    result.resident_pages = page_table.size();
+    result.open_files = open_files;
+    result.max_open_files = max_open_files;
+    return result;
+}
+
+} // namespace sqldb
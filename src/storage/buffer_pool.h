@@ -0,0 +1,157 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include "page.h"
+#include <cstddef>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sqldb {
+
+class WriteAheadLog;
+
+// Counters exposed through the \stats meta command
+struct BufferPoolStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t writebacks = 0;
+    size_t resident_pages = 0;
+    size_t capacity_pages = 0;
+    uint64_t file_opens = 0;
+    size_t open_files = 0;
+    size_t max_open_files = 0;
+};
+
+// Page cache shared by every table. Pages are addressed by a file id handed
+// out by register_file() plus the page number inside that file. Fetched pages
+// stay pinned until unpinned; eviction uses the clock algorithm and writes
+// dirty victims back before reusing their frame. When a write-ahead log is
+// attached, a page is only written after the log is flushed up to its LSN.
+// Registered files keep a descriptor open until more than max_open_files are
+// in use; the least recently used one is then closed and reopened on demand.
+//
+// Reads of missing pages, write-backs and the log flushes before them run
+// without the pool's lock, so threads scanning different pages wait on the
+// disk, not on each other. The frame stays pinned and marked as under I/O
+// meanwhile; threads that want that page wait for the I/O to finish.
+class BufferPool {
+private:
+    struct Frame {
+        uint32_t file_id = 0;
+        uint32_t page_no = 0;
+        int pin_count = 0;
+        bool dirty = false;
+        bool referenced = false;
+        bool in_use = false;
+        bool io_in_progress = false;   // Being read in or written back unlocked
+        uint64_t lsn = 0;   // Newest log record that modified the page
+        std::unique_ptr<char[]> data;
+    };
+
+    struct FileState {
+        std::string path;
+        int fd = -1;
+        uint32_t page_count = 0;
+        uint64_t last_used = 0;
+        bool needs_sync = false;   // Written since the last fsync
+        int io_count = 0;          // Unlocked reads and writes using fd
+    };
+
+    size_t capacity;
+    std::vector<Frame> frames;
+    size_t clock_hand;
+    std::unordered_map<uint64_t, size_t> page_table;
+    std::unordered_map<uint32_t, FileState> files;
+    std::unordered_map<std::string, uint32_t> file_ids;
+    uint32_t next_file_id;
+    size_t max_open_files;
+    size_t open_files;
+    uint64_t file_clock;
+    BufferPoolStats stats;
+    WriteAheadLog* wal;
+    mutable std::mutex mutex;
+    std::condition_variable io_done;
+
+    static uint64_t make_key(uint32_t file_id, uint32_t page_no) {
+        return (static_cast<uint64_t>(file_id) << 32) | page_no;
+    }
+
+    FileState& get_file(uint32_t file_id);
+    int get_fd(FileState& file);
+    void open_fd(FileState& file);
+    void close_fd(FileState& file);
+    size_t acquire_frame(std::unique_lock<std::mutex>& lock);
+    void write_frame_unlocked(std::unique_lock<std::mutex>& lock, Frame& frame);
+    void write_back(std::unique_lock<std::mutex>& lock, Frame& frame);
+    void read_into_frame(std::unique_lock<std::mutex>& lock, Frame& frame, FileState& file, uint32_t page_no);
+    void wait_for_io(std::unique_lock<std::mutex>& lock, const Frame& frame);
+    void discard_frames(uint32_t file_id);
+
+public:
+    explicit BufferPool(size_t memory_budget_bytes, size_t max_open_files = 256);
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    void set_write_ahead_log(WriteAheadLog* log) { wal = log; }
+
+    // File registry
+    uint32_t register_file(const std::string& path);
+    void drop_file(const std::string& path);
+    uint32_t get_page_count(uint32_t file_id);
+
+    // Page access; every fetch/new must be paired with an unpin
+    char* fetch_page(uint32_t file_id, uint32_t page_no);
+    char* new_page(uint32_t file_id, uint32_t& page_no);
+    void unpin_page(uint32_t file_id, uint32_t page_no, bool is_dirty, uint64_t lsn = 0);
+
+    // Write-back
+    void flush_page(uint32_t file_id, uint32_t page_no);
+    void flush_file(uint32_t file_id);
+    void flush_all();
+    void sync_all();
+
+    BufferPoolStats get_stats() const;
+};
+
+// Pins a page for the lifetime of the guard
+class PageGuard {
+private:
+    BufferPool* pool;
+    uint32_t file_id;
+    uint32_t page_no;
+    char* data;
+    bool dirty;
+    uint64_t lsn;
+
+public:
+    PageGuard(BufferPool* pool, uint32_t file_id, uint32_t page_no)
+        : pool(pool), file_id(file_id), page_no(page_no),
+          data(pool->fetch_page(file_id, page_no)), dirty(false), lsn(0) {}
+
+    // Appends a new zeroed page to the file
+    PageGuard(BufferPool* pool, uint32_t file_id)
+        : pool(pool), file_id(file_id), page_no(0),
+          data(pool->new_page(file_id, page_no)), dirty(true), lsn(0) {}
+    ~PageGuard() { pool->unpin_page(file_id, page_no, dirty, lsn); }
+
+    PageGuard(const PageGuard&) = delete;
+    PageGuard& operator=(const PageGuard&) = delete;
+
+    char* get_data() { return data; }
+    const char* get_data() const { return data; }
+    uint32_t get_page_no() const { return page_no; }
+    void mark_dirty() { dirty = true; }
+    void mark_dirty(uint64_t record_lsn) { dirty = true; lsn = record_lsn; }
+};
+
+} // namespace sqldb
+
+#endif // BUFFER_POOL_H
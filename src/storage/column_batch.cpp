@@ -0,0 +1,254 @@
+#include "column_batch.h"
+#include "compare_kernels.h"
+#include "../common/compare.h"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace sqldb {
+
+namespace {
+
+// INTEGER IN lists up to this long are one kernel pass per value; longer
+// ones are searched per selected row
+constexpr size_t IN_KERNEL_VALUES = 8;
+
+// Keeps the selected positions whose value passes; the write index only
+// advances on a match, so the loop has no branch on the outcome
+template <typename Get, typename Compare>
+void refine(std::vector<uint32_t>& selection, Get get, Compare compare) {
+    size_t kept = 0;
+    for (uint32_t position : selection) {
+        selection[kept] = position;
+        kept += compare(get(position)) ? 1 : 0;
+    }
+    selection.resize(kept);
+}
+
+// Binds the operator once, outside the per-row loop
+template <typename T, typename Get>
+void refine_ordered(std::vector<uint32_t>& selection, Get get, T target, TokenType op) {
+    switch (op) {
+        case TokenType::EQUALS:
+            refine(selection, get, [target](T value) { return value == target; });
+            break;
+        case TokenType::NOT_EQUALS:
+            refine(selection, get, [target](T value) { return value != target; });
+            break;
+        case TokenType::LESS_THAN:
+            refine(selection, get, [target](T value) { return value < target; });
+            break;
+        case TokenType::GREATER_THAN:
+            refine(selection, get, [target](T value) { return value > target; });
+            break;
+        case TokenType::LESS_EQUAL:
+            refine(selection, get, [target](T value) { return value <= target; });
+            break;
+        case TokenType::GREATER_EQUAL:
+            refine(selection, get, [target](T value) { return value >= target; });
+            break;
+        default:
+            selection.clear();
+            break;
+    }
+}
+
+// Keeps the selected positions whose bit is set in a mask over the column
+void refine_by_mask(std::vector<uint32_t>& selection, const std::vector<uint64_t>& mask, size_t count) {
+    // Positions are distinct and in order, so a full selection is every row
+    if (selection.size() == count) {
+        selection.clear();
+        mask_to_selection(mask.data(), count, 0, selection);
+        return;
+    }
+    refine(selection, [&mask](uint32_t position) { return (mask[position / 64] >> (position % 64)) & 1; },
+           [](uint64_t bit) { return bit != 0; });
+}
+
+} // namespace
+
+size_t ColumnVector::size() const {
+    switch (type) {
+        case DataType::INTEGER:
+            return integers.size();
+        case DataType::VARCHAR:
+            return varchar_ends.size();
+        case DataType::BOOLEAN:
+            return booleans.size();
+    }
+    return 0;
+}
+
+void ColumnVector::reset(DataType type) {
+    this->type = type;
+    integers.clear();
+    booleans.clear();
+    varchar_ends.clear();
+    varchar_data.clear();
+}
+
+void ColumnVector::append_value(const Value& value) {
+    switch (type) {
+        case DataType::INTEGER:
+            append_integer(std::get<int>(value));
+            break;
+        case DataType::VARCHAR:
+            append_varchar(std::get<std::string>(value));
+            break;
+        case DataType::BOOLEAN:
+            append_boolean(std::get<bool>(value));
+            break;
+    }
+}
+
+Value ColumnVector::value_at(size_t position) const {
+    switch (type) {
+        case DataType::INTEGER:
+            return Value(static_cast<int>(integer_at(position)));
+        case DataType::VARCHAR:
+            return Value(std::string(varchar_at(position)));
+        case DataType::BOOLEAN:
+            return Value(boolean_at(position));
+    }
+    throw std::runtime_error("Unknown data type in column vector");
+}
+
+void ColumnBatch::reset(const std::vector<Column>& schema, const std::vector<int>* needed) {
+    columns.resize(schema.size());
+    loaded.assign(schema.size(), needed ? 0 : 1);
+    if (needed) {
+        for (int column_index : *needed) {
+            loaded[column_index] = 1;
+        }
+    }
+    for (size_t i = 0; i < schema.size(); i++) {
+        columns[i].reset(schema[i].type);
+    }
+    row_count = 0;
+    selection.clear();
+}
+
+void ColumnBatch::clear() {
+    for (ColumnVector& column : columns) {
+        column.clear();
+    }
+    row_count = 0;
+    selection.clear();
+}
+
+void ColumnBatch::append_row(const Row& row) {
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (loaded[i]) {
+            columns[i].append_value(row[i]);
+        }
+    }
+}
+
+void ColumnBatch::set_row_count(size_t rows) {
+    row_count = rows;
+    selection.resize(rows);
+    for (size_t i = 0; i < rows; i++) {
+        selection[i] = static_cast<uint32_t>(i);
+    }
+}
+
+void ColumnBatch::truncate(size_t rows) {
+    if (selection.size() > rows) {
+        selection.resize(rows);
+    }
+}
+
+void ColumnBatch::project(const std::vector<int>& ordinals) {
+    // Vectors are moved, not copied, unless an ordinal repeats
+    std::vector<ColumnVector> projected(ordinals.size());
+    std::vector<int> moved_to(columns.size(), -1);
+    for (size_t i = 0; i < ordinals.size(); i++) {
+        int source = ordinals[i];
+        if (moved_to[source] >= 0) {
+            projected[i] = projected[moved_to[source]];
+        } else {
+            projected[i] = std::move(columns[source]);
+            moved_to[source] = static_cast<int>(i);
+        }
+    }
+    columns = std::move(projected);
+    loaded.assign(columns.size(), 1);
+}
+
+void filter_column(const ColumnVector& column, const BoundCondition& condition, std::vector<uint32_t>& selection) {
+    switch (condition.type) {
+        case DataType::INTEGER: {
+            // The whole column goes through the vector kernels, even rows
+            // no longer selected: a mask is cheaper than a gather
+            std::vector<uint64_t> mask(mask_words(column.size()));
+            compare_int32(column.integer_data(), column.size(), std::get<int>(condition.value),
+                          condition.operator_type, mask.data());
+            refine_by_mask(selection, mask, column.size());
+            break;
+        }
+        case DataType::BOOLEAN: {
+            std::vector<uint64_t> mask(mask_words(column.size()));
+            compare_bool(column.boolean_data(), column.size(), std::get<bool>(condition.value),
+                         condition.operator_type, mask.data());
+            refine_by_mask(selection, mask, column.size());
+            break;
+        }
+        case DataType::VARCHAR: {
+            std::string_view target(std::get<std::string>(condition.value));
+            auto get = [&column](uint32_t position) { return column.varchar_at(position); };
+            if (condition.operator_type != TokenType::LIKE) {
+                refine_ordered<std::string_view>(selection, get, target, condition.operator_type);
+            } else if (like_is_prefix_only(target)) {
+                std::string_view prefix = like_prefix(target);
+                refine(selection, get, [prefix](std::string_view value) {
+                    return value.substr(0, prefix.size()) == prefix;
+                });
+            } else {
+                refine(selection, get, [target](std::string_view value) { return like_matches(value, target); });
+            }
+            break;
+        }
+    }
+}
+
+void filter_column_in(const ColumnVector& column, const InList& list, std::vector<uint32_t>& selection) {
+    switch (list.type) {
+        case DataType::INTEGER: {
+            if (list.integers.size() > IN_KERNEL_VALUES) {
+                refine(selection, [&column](uint32_t position) { return column.integer_at(position); },
+                       [&list](int32_t value) {
+                           return std::binary_search(list.integers.begin(), list.integers.end(), value);
+                       });
+                break;
+            }
+            // The union of one equality mask per value
+            std::vector<uint64_t> mask(mask_words(column.size()));
+            std::vector<uint64_t> matches(mask.size());
+            for (int32_t value : list.integers) {
+                compare_int32(column.integer_data(), column.size(), value, TokenType::EQUALS, matches.data());
+                for (size_t w = 0; w < mask.size(); w++) {
+                    mask[w] |= matches[w];
+                }
+            }
+            refine_by_mask(selection, mask, column.size());
+            break;
+        }
+        case DataType::BOOLEAN: {
+            bool has_true = list.has_true;
+            bool has_false = list.has_false;
+            refine(selection, [&column](uint32_t position) { return column.boolean_at(position); },
+                   [has_true, has_false](bool value) { return value ? has_true : has_false; });
+            break;
+        }
+        case DataType::VARCHAR: {
+            refine(selection, [&column](uint32_t position) { return column.varchar_at(position); },
+                   [&list](std::string_view value) {
+                       return std::binary_search(list.varchars.begin(), list.varchars.end(), value,
+                                                 std::less<>());
+                   });
+            break;
+        }
+    }
+}
+
+} // namespace sqldb
@@ -0,0 +1,124 @@
+#ifndef COLUMN_BATCH_H
+#define COLUMN_BATCH_H
+
+#include "../common/types.h"
+#include "row_codec.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqldb {
+
+// Values of one column, unboxed. Only the storage matching the type is used;
+// VARCHAR values are packed back to back and found through their end offsets.
+class ColumnVector {
+private:
+    DataType type;
+    std::vector<int32_t> integers;
+    std::vector<uint8_t> booleans;
+    std::vector<uint32_t> varchar_ends;
+    std::string varchar_data;
+
+public:
+    explicit ColumnVector(DataType type = DataType::INTEGER) : type(type) {}
+
+    DataType get_type() const { return type; }
+    size_t size() const;
+
+    // Drops the values and switches to another type, keeping the memory
+    void reset(DataType type);
+    void clear() { reset(type); }
+
+    // Appending; the caller guarantees the value has the column's type
+    void append_integer(int32_t value) { integers.push_back(value); }
+    void append_boolean(bool value) { booleans.push_back(value ? 1 : 0); }
+    void append_varchar(std::string_view value) {
+        varchar_data.append(value);
+        varchar_ends.push_back(static_cast<uint32_t>(varchar_data.size()));
+    }
+    void append_value(const Value& value);
+
+    // Access by position
+    int32_t integer_at(size_t position) const { return integers[position]; }
+    bool boolean_at(size_t position) const { return booleans[position] != 0; }
+    std::string_view varchar_at(size_t position) const {
+        uint32_t begin = position == 0 ? 0 : varchar_ends[position - 1];
+        return std::string_view(varchar_data).substr(begin, varchar_ends[position] - begin);
+    }
+    Value value_at(size_t position) const;
+
+    const int32_t* integer_data() const { return integers.data(); }
+    const uint8_t* boolean_data() const { return booleans.data(); }
+};
+
+// A batch of rows held column by column, in the table's column order until a
+// projection reorders it. Scans fill in only the columns the query reads; the
+// others stay empty. The selection vector lists, in order, the positions of
+// the rows still in the batch, so filters and limits drop rows by shrinking
+// it instead of moving values.
+class ColumnBatch {
+private:
+    std::vector<ColumnVector> columns;
+    std::vector<char> loaded;
+    size_t row_count;
+    std::vector<uint32_t> selection;
+
+public:
+    ColumnBatch() : row_count(0) {}
+
+    // Lays the batch out for a schema and empties it; columns, when given,
+    // are the ordinals that get values, otherwise every column does
+    void reset(const std::vector<Column>& schema, const std::vector<int>* needed);
+
+    // Empties the batch, keeping its layout
+    void clear();
+
+    size_t column_count() const { return columns.size(); }
+    ColumnVector& column(size_t index) { return columns[index]; }
+    const ColumnVector& column(size_t index) const { return columns[index]; }
+    bool is_loaded(size_t index) const { return loaded[index] != 0; }
+
+    // Producing: fill in the loaded columns, then publish the row count,
+    // which selects every row
+    void append_row(const Row& row);
+    void set_row_count(size_t rows);
+
+    // Rows still selected
+    size_t size() const { return selection.size(); }
+    bool empty() const { return selection.empty(); }
+    std::vector<uint32_t>& get_selection() { return selection; }
+    const std::vector<uint32_t>& get_selection() const { return selection; }
+
+    // Keeps the first rows selected rows
+    void truncate(size_t rows);
+
+    // Reorders the columns to the given ordinals; one may appear twice
+    void project(const std::vector<int>& ordinals);
+};
+
+// Narrows selection to the positions whose value satisfies the condition.
+// INTEGER and BOOLEAN columns are compared by the vector kernels of
+// compare_kernels.h; VARCHAR gets one typed loop per operator, so nothing is
+// dispatched per row.
+void filter_column(const ColumnVector& column, const BoundCondition& condition, std::vector<uint32_t>& selection);
+
+// Values of an IN list, bound to a column; only those of the column's type
+// are used, sorted and without duplicates
+struct InList {
+    int column_index;
+    DataType type;
+    std::vector<int32_t> integers;
+    std::vector<std::string> varchars;
+    bool has_true;
+    bool has_false;
+};
+
+// Narrows selection to the positions whose value is in the list. Short
+// INTEGER lists go through the vector kernels once per value.
+void filter_column_in(const ColumnVector& column, const InList& list, std::vector<uint32_t>& selection);
+
+} // namespace sqldb
+
+#endif // COLUMN_BATCH_H
@@ -0,0 +1,514 @@
+#include "column_block.h"
+#include "compare_kernels.h"
+#include "../common/compare.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace sqldb {
+
+namespace {
+
+// Slack after every bit-packed run so a code never straddles the end
+constexpr size_t PACK_PADDING = sizeof(uint64_t);
+
+// FOR and DICTIONARY store a one byte bit width
+constexpr size_t WIDTH_SIZE = sizeof(uint8_t);
+
+uint8_t bits_needed(uint64_t max_code) {
+    uint8_t width = 0;
+    while (width < 64 && (max_code >> width) != 0) {
+        width++;
+    }
+    return width;
+}
+
+size_t packed_size(size_t count, uint8_t width) {
+    return (count * width + 7) / 8 + PACK_PADDING;
+}
+
+template <typename T>
+void append_raw(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void append_packed(std::string& out, const std::vector<uint32_t>& codes, uint8_t width) {
+    size_t start = out.size();
+    out.append(packed_size(codes.size(), width), '\0');
+    if (width == 0) {
+        return;
+    }
+
+    char* packed = &out[start];
+    for (size_t i = 0; i < codes.size(); i++) {
+        uint64_t bit = static_cast<uint64_t>(i) * width;
+        uint64_t word;
+        std::memcpy(&word, packed + bit / 8, sizeof(word));
+        word |= static_cast<uint64_t>(codes[i]) << (bit % 8);
+        std::memcpy(packed + bit / 8, &word, sizeof(word));
+    }
+}
+
+// Offsets first so any value can be located without a walk
+size_t varchar_layout_size(const std::vector<std::string_view>& values) {
+    size_t size = (values.size() + 1) * sizeof(uint32_t);
+    for (std::string_view value : values) {
+        size += value.size();
+    }
+    return size;
+}
+
+void append_varchar_layout(std::string& out, const std::vector<std::string_view>& values) {
+    uint32_t offset = 0;
+    append_raw(out, offset);
+    for (std::string_view value : values) {
+        offset += static_cast<uint32_t>(value.size());
+        append_raw(out, offset);
+    }
+    for (std::string_view value : values) {
+        out.append(value);
+    }
+}
+
+// Size of a VARCHAR layout of count values starting at position
+size_t read_varchar_layout_size(const std::string& data, size_t position, uint32_t count) {
+    size_t offsets_size = (static_cast<size_t>(count) + 1) * sizeof(uint32_t);
+    if (data.size() < position + offsets_size) {
+        throw std::runtime_error("Truncated VARCHAR column block");
+    }
+    uint32_t bytes;
+    std::memcpy(&bytes, data.data() + position + count * sizeof(uint32_t), sizeof(bytes));
+    return offsets_size + bytes;
+}
+
+std::string_view read_varchar(const std::string& data, size_t position, uint32_t count, uint32_t index) {
+    uint32_t bounds[2];
+    std::memcpy(bounds, data.data() + position + index * sizeof(uint32_t), sizeof(bounds));
+    const char* bytes = data.data() + position + (static_cast<size_t>(count) + 1) * sizeof(uint32_t);
+    return std::string_view(bytes + bounds[0], bounds[1] - bounds[0]);
+}
+
+std::string encode_integers(const std::vector<Row>& rows, size_t begin, size_t end, int column_index,
+                            ColumnEncoding& encoding) {
+    int32_t low = std::get<int>(rows[begin][column_index]);
+    int32_t high = low;
+    for (size_t i = begin; i < end; i++) {
+        int32_t value = std::get<int>(rows[i][column_index]);
+        low = std::min(low, value);
+        high = std::max(high, value);
+    }
+
+    size_t count = end - begin;
+    uint8_t width = bits_needed(static_cast<uint64_t>(static_cast<int64_t>(high) - low));
+    std::string out;
+
+    if (sizeof(int32_t) + WIDTH_SIZE + packed_size(count, width) < count * sizeof(int32_t)) {
+        std::vector<uint32_t> codes;
+        codes.reserve(count);
+        for (size_t i = begin; i < end; i++) {
+            codes.push_back(static_cast<uint32_t>(static_cast<int64_t>(std::get<int>(rows[i][column_index])) - low));
+        }
+
+        encoding = ColumnEncoding::FOR;
+        append_raw(out, low);
+        append_raw(out, width);
+        append_packed(out, codes, width);
+        return out;
+    }
+
+    encoding = ColumnEncoding::PLAIN;
+    out.reserve(count * sizeof(int32_t));
+    for (size_t i = begin; i < end; i++) {
+        append_raw(out, static_cast<int32_t>(std::get<int>(rows[i][column_index])));
+    }
+    return out;
+}
+
+std::string encode_varchars(const std::vector<Row>& rows, size_t begin, size_t end, int column_index,
+                            ColumnEncoding& encoding) {
+    std::vector<std::string_view> values;
+    values.reserve(end - begin);
+    for (size_t i = begin; i < end; i++) {
+        values.push_back(std::get<std::string>(rows[i][column_index]));
+    }
+
+    // Sorted entries keep code order equal to value order for range filters
+    std::vector<std::string_view> dictionary(values);
+    std::sort(dictionary.begin(), dictionary.end());
+    dictionary.erase(std::unique(dictionary.begin(), dictionary.end()), dictionary.end());
+
+    uint8_t width = bits_needed(dictionary.size() - 1);
+    size_t dictionary_size = sizeof(uint32_t) + varchar_layout_size(dictionary) + WIDTH_SIZE +
+                             packed_size(values.size(), width);
+    std::string out;
+
+    if (dictionary_size < varchar_layout_size(values)) {
+        std::vector<uint32_t> codes;
+        codes.reserve(values.size());
+        for (std::string_view value : values) {
+            auto entry = std::lower_bound(dictionary.begin(), dictionary.end(), value);
+            codes.push_back(static_cast<uint32_t>(entry - dictionary.begin()));
+        }
+
+        encoding = ColumnEncoding::DICTIONARY;
+        out.reserve(dictionary_size);
+        append_raw(out, static_cast<uint32_t>(dictionary.size()));
+        append_varchar_layout(out, dictionary);
+        append_raw(out, width);
+        append_packed(out, codes, width);
+        return out;
+    }
+
+    encoding = ColumnEncoding::PLAIN;
+    out.reserve(varchar_layout_size(values));
+    append_varchar_layout(out, values);
+    return out;
+}
+
+std::string encode_booleans(const std::vector<Row>& rows, size_t begin, size_t end, int column_index,
+                            ColumnEncoding& encoding) {
+    std::vector<uint32_t> bits;
+    bits.reserve(end - begin);
+    for (size_t i = begin; i < end; i++) {
+        bits.push_back(std::get<bool>(rows[i][column_index]) ? 1 : 0);
+    }
+
+    std::string out;
+    if (packed_size(bits.size(), 1) < bits.size()) {
+        encoding = ColumnEncoding::BITMAP;
+        append_packed(out, bits, 1);
+        return out;
+    }
+
+    encoding = ColumnEncoding::PLAIN;
+    for (uint32_t bit : bits) {
+        out.push_back(static_cast<char>(bit));
+    }
+    return out;
+}
+
+} // namespace
+
+std::string encode_column_block(DataType type, const std::vector<Row>& rows, size_t begin, size_t end,
+                                int column_index, ColumnEncoding& encoding) {
+    if (begin >= end) {
+        throw std::runtime_error("Cannot encode an empty column block");
+    }
+
+    switch (type) {
+        case DataType::INTEGER:
+            return encode_integers(rows, begin, end, column_index, encoding);
+        case DataType::VARCHAR:
+            return encode_varchars(rows, begin, end, column_index, encoding);
+        case DataType::BOOLEAN:
+            return encode_booleans(rows, begin, end, column_index, encoding);
+    }
+    throw std::runtime_error("Unknown data type in column block");
+}
+
+ColumnZone compute_column_zone(DataType type, const std::vector<Row>& rows, size_t begin, size_t end,
+                               int column_index) {
+    ColumnZone zone = {};
+    for (size_t i = begin; i < end; i++) {
+        extend_zone(zone, i == begin, type, rows[i][column_index]);
+    }
+    return zone;
+}
+
+void ColumnBlock::load(DataType type, ColumnEncoding encoding, uint32_t row_count, std::string data) {
+    size_t expected = 0;
+    int32_t base = 0;
+    uint32_t dictionary_size = 0;
+    uint8_t bit_width = 0;
+    size_t packed_offset = 0;
+
+    switch (encoding) {
+        case ColumnEncoding::PLAIN:
+            switch (type) {
+                case DataType::INTEGER:
+                    expected = row_count * sizeof(int32_t);
+                    break;
+                case DataType::BOOLEAN:
+                    expected = row_count;
+                    break;
+                case DataType::VARCHAR:
+                    expected = read_varchar_layout_size(data, 0, row_count);
+                    break;
+            }
+            break;
+        case ColumnEncoding::FOR:
+            if (type != DataType::INTEGER) {
+                throw std::runtime_error("Column block encoding doesn't fit its type");
+            }
+            if (data.size() < sizeof(base) + WIDTH_SIZE) {
+                throw std::runtime_error("Truncated column block");
+            }
+            std::memcpy(&base, data.data(), sizeof(base));
+            bit_width = static_cast<uint8_t>(data[sizeof(base)]);
+            packed_offset = sizeof(base) + WIDTH_SIZE;
+            expected = packed_offset + packed_size(row_count, bit_width);
+            break;
+        case ColumnEncoding::DICTIONARY: {
+            if (type != DataType::VARCHAR) {
+                throw std::runtime_error("Column block encoding doesn't fit its type");
+            }
+            if (data.size() < sizeof(dictionary_size)) {
+                throw std::runtime_error("Truncated column block");
+            }
+            std::memcpy(&dictionary_size, data.data(), sizeof(dictionary_size));
+            size_t width_offset = sizeof(dictionary_size) +
+                                  read_varchar_layout_size(data, sizeof(dictionary_size), dictionary_size);
+            if (data.size() < width_offset + WIDTH_SIZE) {
+                throw std::runtime_error("Truncated column block");
+            }
+            bit_width = static_cast<uint8_t>(data[width_offset]);
+            packed_offset = width_offset + WIDTH_SIZE;
+            expected = packed_offset + packed_size(row_count, bit_width);
+            break;
+        }
+        case ColumnEncoding::BITMAP:
+            if (type != DataType::BOOLEAN) {
+                throw std::runtime_error("Column block encoding doesn't fit its type");
+            }
+            bit_width = 1;
+            expected = packed_size(row_count, bit_width);
+            break;
+        default:
+            throw std::runtime_error("Unknown column block encoding");
+    }
+    if (bit_width > 32) {
+        throw std::runtime_error("Invalid bit width in column block");
+    }
+    if (data.size() != expected) {
+        throw std::runtime_error("Column block size doesn't match its row count");
+    }
+
+    this->type = type;
+    this->encoding = encoding;
+    this->row_count = row_count;
+    this->data = std::move(data);
+    this->base = base;
+    this->dictionary_size = dictionary_size;
+    this->bit_width = bit_width;
+    this->packed_offset = packed_offset;
+
+    // A code past the dictionary would index outside the block
+    if (encoding == ColumnEncoding::DICTIONARY) {
+        for (uint32_t row = 0; row < row_count; row++) {
+            if (get_code(row) >= dictionary_size) {
+                this->row_count = 0;
+                throw std::runtime_error("Dictionary code out of range in column block");
+            }
+        }
+    }
+}
+
+uint32_t ColumnBlock::get_code(uint32_t row) const {
+    if (bit_width == 0) {
+        return 0;
+    }
+    uint64_t bit = static_cast<uint64_t>(row) * bit_width;
+    uint64_t word;
+    std::memcpy(&word, data.data() + packed_offset + bit / 8, sizeof(word));
+    return static_cast<uint32_t>((word >> (bit % 8)) & ((uint64_t(1) << bit_width) - 1));
+}
+
+int32_t ColumnBlock::get_integer(uint32_t row) const {
+    if (encoding == ColumnEncoding::FOR) {
+        return static_cast<int32_t>(static_cast<int64_t>(base) + get_code(row));
+    }
+    int32_t value;
+    std::memcpy(&value, data.data() + row * sizeof(int32_t), sizeof(value));
+    return value;
+}
+
+std::string_view ColumnBlock::get_varchar(uint32_t row) const {
+    if (encoding == ColumnEncoding::DICTIONARY) {
+        return get_dictionary_entry(get_code(row));
+    }
+    return read_varchar(data, 0, row_count, row);
+}
+
+std::string_view ColumnBlock::get_dictionary_entry(uint32_t code) const {
+    return read_varchar(data, sizeof(dictionary_size), dictionary_size, code);
+}
+
+Value ColumnBlock::get_value(uint32_t row) const {
+    switch (type) {
+        case DataType::INTEGER:
+            return Value(static_cast<int>(get_integer(row)));
+        case DataType::VARCHAR:
+            return Value(std::string(get_varchar(row)));
+        case DataType::BOOLEAN:
+            return Value(encoding == ColumnEncoding::BITMAP ? get_code(row) != 0 : data[row] != 0);
+    }
+    throw std::runtime_error("Unknown data type in column block");
+}
+
+void ColumnBlock::append_values(const uint32_t* rows, size_t count, ColumnVector& out) const {
+    // The encoding is settled once per call, not once per value
+    switch (type) {
+        case DataType::INTEGER:
+            if (encoding == ColumnEncoding::FOR) {
+                for (size_t i = 0; i < count; i++) {
+                    out.append_integer(static_cast<int32_t>(static_cast<int64_t>(base) + get_code(rows[i])));
+                }
+            } else {
+                for (size_t i = 0; i < count; i++) {
+                    int32_t value;
+                    std::memcpy(&value, data.data() + rows[i] * sizeof(int32_t), sizeof(value));
+                    out.append_integer(value);
+                }
+            }
+            break;
+        case DataType::VARCHAR:
+            for (size_t i = 0; i < count; i++) {
+                out.append_varchar(get_varchar(rows[i]));
+            }
+            break;
+        case DataType::BOOLEAN:
+            if (encoding == ColumnEncoding::BITMAP) {
+                for (size_t i = 0; i < count; i++) {
+                    out.append_boolean(get_code(rows[i]) != 0);
+                }
+            } else {
+                for (size_t i = 0; i < count; i++) {
+                    out.append_boolean(data[rows[i]] != 0);
+                }
+            }
+            break;
+    }
+}
+
+void ColumnBlock::filter(const BoundCondition& condition, std::vector<uint32_t>& selection) const {
+    if (encoding != ColumnEncoding::PLAIN) {
+        filter_codes(condition, selection);
+        return;
+    }
+
+    // One loop per type keeps the variant dispatch out of the per-row work;
+    // fixed-width values are compared by the vector kernels
+    std::vector<uint64_t> mask;
+    switch (type) {
+        case DataType::INTEGER:
+            mask.resize(mask_words(row_count));
+            compare_int32(reinterpret_cast<const int32_t*>(data.data()), row_count, std::get<int>(condition.value),
+                          condition.operator_type, mask.data());
+            mask_to_selection(mask.data(), row_count, 0, selection);
+            break;
+        case DataType::VARCHAR: {
+            std::string_view target(std::get<std::string>(condition.value));
+            for (uint32_t row = 0; row < row_count; row++) {
+                if (compare_ordered(get_varchar(row), target, condition.operator_type)) {
+                    selection.push_back(row);
+                }
+            }
+            break;
+        }
+        case DataType::BOOLEAN:
+            mask.resize(mask_words(row_count));
+            compare_bool(reinterpret_cast<const uint8_t*>(data.data()), row_count, std::get<bool>(condition.value),
+                         condition.operator_type, mask.data());
+            mask_to_selection(mask.data(), row_count, 0, selection);
+            break;
+    }
+}
+
+void ColumnBlock::filter_codes(const BoundCondition& condition, std::vector<uint32_t>& selection) const {
+    // A pattern has no code range; it is tested once per dictionary entry
+    if (condition.operator_type == TokenType::LIKE) {
+        if (encoding != ColumnEncoding::DICTIONARY) {
+            return;
+        }
+        std::string_view pattern(std::get<std::string>(condition.value));
+        std::vector<char> code_matches(dictionary_size);
+        for (uint32_t code = 0; code < dictionary_size; code++) {
+            code_matches[code] = like_matches(get_dictionary_entry(code), pattern);
+        }
+        for (uint32_t row = 0; row < row_count; row++) {
+            if (code_matches[get_code(row)]) {
+                selection.push_back(row);
+            }
+        }
+        return;
+    }
+
+    // Codes order like the values they stand for, so the target splits the
+    // code space at [first code >= target, first code > target)
+    uint64_t code_count = 0;
+    uint64_t lower = 0;
+    uint64_t upper = 0;
+
+    switch (encoding) {
+        case ColumnEncoding::FOR: {
+            code_count = uint64_t(1) << bit_width;
+            int64_t delta = static_cast<int64_t>(std::get<int>(condition.value)) - base;
+            int64_t limit = static_cast<int64_t>(code_count);
+            lower = static_cast<uint64_t>(std::clamp<int64_t>(delta, 0, limit));
+            upper = static_cast<uint64_t>(std::clamp<int64_t>(delta + 1, 0, limit));
+            break;
+        }
+        case ColumnEncoding::DICTIONARY: {
+            std::string_view target(std::get<std::string>(condition.value));
+            uint32_t low = 0;
+            uint32_t high = dictionary_size;
+            while (low < high) {
+                uint32_t middle = low + (high - low) / 2;
+                if (get_dictionary_entry(middle) < target) {
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
+            }
+            code_count = dictionary_size;
+            lower = low;
+            upper = (low < dictionary_size && get_dictionary_entry(low) == target) ? low + 1 : low;
+            break;
+        }
+        case ColumnEncoding::BITMAP:
+            code_count = 2;
+            lower = std::get<bool>(condition.value) ? 1 : 0;
+            upper = lower + 1;
+            break;
+        default:
+            return;
+    }
+
+    uint64_t first = 0;
+    uint64_t last = code_count;
+    bool negate = false;
+    switch (condition.operator_type) {
+        case TokenType::EQUALS:
+            first = lower;
+            last = upper;
+            break;
+        case TokenType::NOT_EQUALS:
+            first = lower;
+            last = upper;
+            negate = true;
+            break;
+        case TokenType::LESS_THAN:
+            last = lower;
+            break;
+        case TokenType::LESS_EQUAL:
+            last = upper;
+            break;
+        case TokenType::GREATER_THAN:
+            first = upper;
+            break;
+        case TokenType::GREATER_EQUAL:
+            first = lower;
+            break;
+        default:
+            return;
+    }
+
+    for (uint32_t row = 0; row < row_count; row++) {
+        uint64_t code = get_code(row);
+        if ((code >= first && code < last) != negate) {
+            selection.push_back(row);
+        }
+    }
+}
+
+} // namespace sqldb
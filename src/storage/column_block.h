@@ -0,0 +1,98 @@
+#ifndef COLUMN_BLOCK_H
+#define COLUMN_BLOCK_H
+
+#include "../common/types.h"
+#include "row_codec.h"
+#include "column_batch.h"
+#include "zone_map.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqldb {
+
+// Rows sealed together into one block of every column segment
+constexpr uint32_t COLUMN_BLOCK_ROWS = 1024;
+
+// How the values of one block are laid out. Every block picks its own:
+//   PLAIN:       INTEGER int32 per row; BOOLEAN one byte per row; VARCHAR
+//                (rows + 1) uint32 end offsets, then the concatenated bytes
+//   FOR:         INTEGER only; int32 block minimum, uint8 bit width, then each
+//                value minus the minimum, bit-packed
+//   DICTIONARY:  VARCHAR only; uint32 entry count, the sorted distinct values
+//                in the plain VARCHAR layout, uint8 bit width, then one
+//                bit-packed dictionary code per row
+//   BITMAP:      BOOLEAN only; one bit per row
+// Bit-packed runs are followed by 8 zero bytes so any code can be read with
+// a single unaligned 64-bit load.
+enum class ColumnEncoding : uint32_t {
+    PLAIN = 0,
+    FOR = 1,
+    DICTIONARY = 2,
+    BITMAP = 3
+};
+
+// Stored in front of each block in a segment file; the zone lets scans skip
+// blocks without reading them
+struct ColumnBlockHeader {
+    uint32_t row_count;
+    uint32_t data_size;
+    ColumnEncoding encoding;
+    ColumnZone zone;
+};
+
+// Encodes one column over rows [begin, end) with whichever encoding is
+// smallest for those values, which is returned in encoding
+std::string encode_column_block(DataType type, const std::vector<Row>& rows, size_t begin, size_t end,
+                                int column_index, ColumnEncoding& encoding);
+
+// Min/max of one column over rows [begin, end)
+ColumnZone compute_column_zone(DataType type, const std::vector<Row>& rows, size_t begin, size_t end,
+                               int column_index);
+
+// The values of one column for one block, read back from a segment. Encoded
+// blocks stay encoded: values are decoded one at a time on access, and
+// filter() turns the condition into a range of codes and compares codes.
+class ColumnBlock {
+private:
+    DataType type;
+    ColumnEncoding encoding;
+    uint32_t row_count;
+    std::string data;
+
+    // Parsed from data by load()
+    int32_t base;               // FOR minimum
+    uint32_t dictionary_size;   // DICTIONARY entries
+    uint8_t bit_width;
+    size_t packed_offset;       // Start of the bit-packed codes
+
+    uint32_t get_code(uint32_t row) const;
+    int32_t get_integer(uint32_t row) const;
+    std::string_view get_varchar(uint32_t row) const;
+    std::string_view get_dictionary_entry(uint32_t code) const;
+    void filter_codes(const BoundCondition& condition, std::vector<uint32_t>& selection) const;
+
+public:
+    ColumnBlock()
+        : type(DataType::INTEGER), encoding(ColumnEncoding::PLAIN), row_count(0), base(0), dictionary_size(0),
+          bit_width(0), packed_offset(0) {}
+
+    // Takes ownership of the block data; throws if it does not fit the type
+    // and encoding
+    void load(DataType type, ColumnEncoding encoding, uint32_t row_count, std::string data);
+
+    uint32_t size() const { return row_count; }
+    Value get_value(uint32_t row) const;
+
+    // Decodes the values at the given rows onto the end of a column vector
+    void append_values(const uint32_t* rows, size_t count, ColumnVector& out) const;
+
+    // Appends the rows whose value satisfies the condition to selection
+    void filter(const BoundCondition& condition, std::vector<uint32_t>& selection) const;
+};
+
+} // namespace sqldb
+
+#endif // COLUMN_BLOCK_H
@@ -0,0 +1,548 @@
+#include "column_storage.h"
+#include "metadata.h"
+#include "buffer_pool.h"
+#include "wal.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sqldb {
+
+namespace {
+
+// Version 2 added the block zone to the block header, version 3 the block
+// encoding
+constexpr char SEGMENT_MAGIC[8] = {'S', 'Q', 'L', 'M', 'C', 'O', 'L', '3'};
+
+void read_exact(int fd, char* data, size_t length, uint64_t offset, const std::string& path) {
+    while (length > 0) {
+        ssize_t bytes_read = ::pread(fd, data, length, static_cast<off_t>(offset));
+        if (bytes_read <= 0) {
+            throw std::runtime_error("Short read in column segment: " + path);
+        }
+        data += bytes_read;
+        length -= static_cast<size_t>(bytes_read);
+        offset += static_cast<uint64_t>(bytes_read);
+    }
+}
+
+void write_exact(int fd, const char* data, size_t length, uint64_t offset, const std::string& path) {
+    while (length > 0) {
+        ssize_t written = ::pwrite(fd, data, length, static_cast<off_t>(offset));
+        if (written < 0) {
+            throw std::runtime_error("Cannot write column segment: " + path);
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+}
+
+// Makes a file written through a stream durable
+void sync_file(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+    int result = ::fsync(fd);
+    ::close(fd);
+    if (result != 0) {
+        throw std::runtime_error("Cannot sync file: " + path);
+    }
+}
+
+// Closes the descriptor when a seal or open step fails halfway
+class FileCloser {
+private:
+    int fd;
+
+public:
+    explicit FileCloser(int fd) : fd(fd) {}
+    ~FileCloser() { ::close(fd); }
+
+    FileCloser(const FileCloser&) = delete;
+    FileCloser& operator=(const FileCloser&) = delete;
+};
+
+// Row id of the row at a position in scan order, one page number per block
+RowId row_id_at(uint64_t position) {
+    return RowId{static_cast<uint32_t>(position / COLUMN_BLOCK_ROWS),
+                 static_cast<uint16_t>(position % COLUMN_BLOCK_ROWS)};
+}
+
+} // namespace
+
+ColumnScanCursor::ColumnScanCursor(const std::vector<Column>& columns, const std::vector<std::string>& segment_paths,
+                                   std::vector<std::vector<ColumnBlockRef>> blocks,
+                                   const BoundCondition* condition, const std::vector<int>* needed_columns,
+                                   std::unique_ptr<TableCursor> tail_cursor)
+    : columns(columns), blocks(std::move(blocks)), has_condition(condition != nullptr), condition{},
+      needed(columns.size(), needed_columns ? 0 : 1), block_index(0), current(columns.size()), selection_pos(0),
+      tail_cursor(std::move(tail_cursor)) {
+    if (has_condition) {
+        this->condition = *condition;
+    }
+    if (needed_columns) {
+        for (int column_index : *needed_columns) {
+            needed[column_index] = 1;
+        }
+    }
+
+    // Segments are only opened when there is something sealed to read
+    if (!this->blocks.empty() && !this->blocks[0].empty()) {
+        for (const std::string& path : segment_paths) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                for (int open_fd : fds) {
+                    ::close(open_fd);
+                }
+                throw std::runtime_error("Cannot open column segment: " + path);
+            }
+            fds.push_back(fd);
+        }
+    }
+}
+
+ColumnScanCursor::~ColumnScanCursor() {
+    for (int fd : fds) {
+        ::close(fd);
+    }
+}
+
+void ColumnScanCursor::read_block(size_t column, size_t block) {
+    const ColumnBlockRef& ref = blocks[column][block];
+    std::string data(ref.data_size, '\0');
+    read_exact(fds[column], data.data(), data.size(), ref.offset, columns[column].name);
+    current[column].load(columns[column].type, ref.encoding, ref.row_count, std::move(data));
+}
+
+void ColumnScanCursor::load_block(size_t block) {
+    selection.clear();
+    selection_pos = 0;
+
+    size_t skip_column = columns.size();
+    if (has_condition) {
+        // Late materialization: the other columns are only read for matches
+        skip_column = static_cast<size_t>(condition.column_index);
+        const ColumnBlockRef& ref = blocks[skip_column][block];
+        if (!zone_may_match(ref.zone, columns[skip_column].type, condition)) {
+            return;
+        }
+        read_block(skip_column, block);
+        current[skip_column].filter(condition, selection);
+        if (selection.empty()) {
+            return;
+        }
+    } else {
+        uint32_t row_count = blocks[0][block].row_count;
+        selection.reserve(row_count);
+        for (uint32_t row = 0; row < row_count; row++) {
+            selection.push_back(row);
+        }
+    }
+
+    for (size_t column = 0; column < columns.size(); column++) {
+        if (column != skip_column && needed[column]) {
+            read_block(column, block);
+        }
+    }
+}
+
+bool ColumnScanCursor::next(Row& row) {
+    while (true) {
+        if (selection_pos < selection.size()) {
+            uint32_t position = selection[selection_pos++];
+            row.clear();
+            row.reserve(columns.size());
+            for (size_t column = 0; column < columns.size(); column++) {
+                row.push_back(needed[column] ? current[column].get_value(position) : Value{});
+            }
+            return true;
+        }
+
+        if (blocks.empty() || block_index >= blocks[0].size()) {
+            break;
+        }
+        load_block(block_index++);
+    }
+
+    return tail_cursor->next(row);
+}
+
+size_t ColumnScanCursor::next_columns(ColumnBatch& batch, size_t max_rows) {
+    // Sealed blocks first; the tail fills batches of its own once they run out
+    while (selection_pos >= selection.size()) {
+        if (blocks.empty() || block_index >= blocks[0].size()) {
+            return tail_cursor->next_columns(batch, max_rows);
+        }
+        load_block(block_index++);
+    }
+
+    // The selection of one block is copied out a column at a time
+    batch.clear();
+    size_t count = std::min(max_rows, selection.size() - selection_pos);
+    for (size_t column = 0; column < columns.size(); column++) {
+        if (batch.is_loaded(column)) {
+            current[column].append_values(selection.data() + selection_pos, count, batch.column(column));
+        }
+    }
+    selection_pos += count;
+    batch.set_row_count(count);
+    return count;
+}
+
+ColumnStorage::ColumnStorage(const std::string& table_name, MetadataManager* metadata_mgr, BufferPool* buffer_pool,
+                             WriteAheadLog* wal)
+    : table_name(table_name), metadata_manager(metadata_mgr), buffer_pool(buffer_pool), wal(wal),
+      sealed_rows(0), key_column(-1), tail_rows(0) {
+    if (!metadata_mgr) {
+        throw std::runtime_error("MetadataManager cannot be null");
+    }
+
+    manifest_path = metadata_manager->get_column_manifest_path(table_name);
+    columns = metadata_manager->get_columns(table_name);
+    for (size_t i = 0; i < columns.size(); i++) {
+        Segment segment;
+        segment.path = metadata_manager->get_column_segment_path(table_name, columns[i].name);
+        segments.push_back(segment);
+        if (columns[i].is_primary_key) {
+            key_column = static_cast<int>(i);
+        }
+    }
+
+    tail = std::make_unique<TableStorage>(table_name, metadata_manager, buffer_pool, wal);
+
+    uint64_t tail_sealed = 0;
+    if (!load_manifest(tail_sealed)) {
+        create_segments();
+        write_manifest(0);
+    }
+    open_segments();
+
+    // A seal committed its blocks but was cut off before emptying the tail
+    if (tail_sealed > 0) {
+        if (tail->get_row_count() > 0) {
+            tail->clear_table();
+            sync_file(tail->get_file_path());
+        }
+        write_manifest(0);
+    }
+    tail_rows = tail->get_row_count();
+
+    if (key_column >= 0) {
+        key_index = std::make_unique<BPlusTree>(buffer_pool, metadata_manager->get_primary_index_path(table_name),
+                                                columns[key_column].type);
+        if (key_index->needs_rebuild()) {
+            build_key_index();
+        }
+    }
+}
+
+bool ColumnStorage::load_manifest(uint64_t& tail_sealed) {
+    std::ifstream file(manifest_path);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    // Format: ROWS:n, TAIL_SEALED:n and one SEGMENT:column:committed_bytes per column
+    std::string line;
+    size_t segment_count = 0;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream iss(line);
+        std::string key;
+        std::getline(iss, key, ':');
+        if (key == "ROWS") {
+            std::string value;
+            std::getline(iss, value);
+            sealed_rows = std::stoull(value);
+        } else if (key == "TAIL_SEALED") {
+            std::string value;
+            std::getline(iss, value);
+            tail_sealed = std::stoull(value);
+        } else if (key == "SEGMENT") {
+            std::string column_name;
+            std::string size_str;
+            std::getline(iss, column_name, ':');
+            std::getline(iss, size_str);
+            if (segment_count >= columns.size() || columns[segment_count].name != column_name) {
+                throw std::runtime_error("Column manifest doesn't match table schema: " + manifest_path);
+            }
+            segments[segment_count++].committed_size = std::stoull(size_str);
+        }
+    }
+
+    if (segment_count != columns.size()) {
+        throw std::runtime_error("Column manifest doesn't match table schema: " + manifest_path);
+    }
+    return true;
+}
+
+void ColumnStorage::write_manifest(uint64_t tail_sealed) {
+    // Written beside the old manifest and renamed over it, so a crash leaves
+    // one complete version
+    std::string temp_path = manifest_path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot write column manifest: " + temp_path);
+        }
+
+        file << "# Column store manifest for table " << table_name << "\n";
+        file << "ROWS:" << sealed_rows << "\n";
+        file << "TAIL_SEALED:" << tail_sealed << "\n";
+        for (size_t i = 0; i < columns.size(); i++) {
+            file << "SEGMENT:" << columns[i].name << ":" << segments[i].committed_size << "\n";
+        }
+
+        if (!file) {
+            throw std::runtime_error("Cannot write column manifest: " + temp_path);
+        }
+    }
+    sync_file(temp_path);
+
+    std::error_code ec;
+    std::filesystem::rename(temp_path, manifest_path, ec);
+    if (ec) {
+        throw std::runtime_error("Cannot replace column manifest: " + manifest_path);
+    }
+}
+
+void ColumnStorage::create_segments() {
+    for (Segment& segment : segments) {
+        int fd = ::open(segment.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot create column segment: " + segment.path);
+        }
+        FileCloser closer(fd);
+
+        write_exact(fd, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC), 0, segment.path);
+        if (::fsync(fd) != 0) {
+            throw std::runtime_error("Cannot sync column segment: " + segment.path);
+        }
+        segment.committed_size = sizeof(SEGMENT_MAGIC);
+        segment.blocks.clear();
+    }
+}
+
+void ColumnStorage::open_segments() {
+    for (Segment& segment : segments) {
+        int fd = ::open(segment.path.c_str(), O_RDWR);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open column segment: " + segment.path);
+        }
+        FileCloser closer(fd);
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            throw std::runtime_error("Cannot stat column segment: " + segment.path);
+        }
+        uint64_t file_size = static_cast<uint64_t>(st.st_size);
+        if (file_size < segment.committed_size || segment.committed_size < sizeof(SEGMENT_MAGIC)) {
+            throw std::runtime_error("Column segment is shorter than its manifest: " + segment.path);
+        }
+
+        // Blocks past the committed size belong to a seal that never finished
+        if (file_size > segment.committed_size &&
+            ::ftruncate(fd, static_cast<off_t>(segment.committed_size)) != 0) {
+            throw std::runtime_error("Cannot truncate column segment: " + segment.path);
+        }
+
+        char magic[sizeof(SEGMENT_MAGIC)];
+        read_exact(fd, magic, sizeof(magic), 0, segment.path);
+        if (std::memcmp(magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC) - 1) != 0) {
+            throw std::runtime_error("Not a column segment file: " + segment.path);
+        }
+        if (magic[sizeof(SEGMENT_MAGIC) - 1] != SEGMENT_MAGIC[sizeof(SEGMENT_MAGIC) - 1]) {
+            throw std::runtime_error("Unsupported column segment version: " + segment.path);
+        }
+
+        // Rebuild the block directory from the block headers
+        segment.blocks.clear();
+        uint64_t offset = sizeof(SEGMENT_MAGIC);
+        while (offset < segment.committed_size) {
+            ColumnBlockHeader header;
+            read_exact(fd, reinterpret_cast<char*>(&header), sizeof(header), offset, segment.path);
+            offset += sizeof(header);
+            segment.blocks.push_back(
+                ColumnBlockRef{offset, header.row_count, header.data_size, header.encoding, header.zone});
+            offset += header.data_size;
+        }
+        if (offset != segment.committed_size) {
+            throw std::runtime_error("Corrupt block directory in column segment: " + segment.path);
+        }
+    }
+
+    uint64_t row_total = 0;
+    if (!segments.empty()) {
+        for (const ColumnBlockRef& block : segments[0].blocks) {
+            row_total += block.row_count;
+        }
+    }
+    for (const Segment& segment : segments) {
+        if (segment.blocks.size() != segments[0].blocks.size()) {
+            throw std::runtime_error("Column segments of table '" + table_name + "' are out of step");
+        }
+    }
+    if (row_total != sealed_rows) {
+        throw std::runtime_error("Column segments of table '" + table_name + "' don't match the manifest");
+    }
+}
+
+void ColumnStorage::seal_tail() {
+    // The tail must be in its file, not only in the log, before it is emptied
+    wal->checkpoint(buffer_pool);
+
+    std::vector<Row> rows = tail->select_all();
+    if (rows.empty()) {
+        return;
+    }
+
+    for (size_t column = 0; column < columns.size(); column++) {
+        Segment& segment = segments[column];
+
+        std::string out;
+        std::vector<ColumnBlockRef> new_blocks;
+        uint64_t offset = segment.committed_size;
+        for (size_t begin = 0; begin < rows.size(); begin += COLUMN_BLOCK_ROWS) {
+            size_t end = std::min(rows.size(), begin + COLUMN_BLOCK_ROWS);
+            ColumnEncoding encoding;
+            std::string data = encode_column_block(columns[column].type, rows, begin, end,
+                                                   static_cast<int>(column), encoding);
+
+            ColumnBlockHeader header{static_cast<uint32_t>(end - begin), static_cast<uint32_t>(data.size()),
+                                     encoding,
+                                     compute_column_zone(columns[column].type, rows, begin, end,
+                                                         static_cast<int>(column))};
+            out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.append(data);
+            new_blocks.push_back(ColumnBlockRef{offset + out.size() - data.size(), header.row_count,
+                                                header.data_size, header.encoding, header.zone});
+        }
+
+        int fd = ::open(segment.path.c_str(), O_WRONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open column segment: " + segment.path);
+        }
+        FileCloser closer(fd);
+        write_exact(fd, out.data(), out.size(), offset, segment.path);
+        if (::fdatasync(fd) != 0) {
+            throw std::runtime_error("Cannot sync column segment: " + segment.path);
+        }
+
+        segment.committed_size += out.size();
+        segment.blocks.insert(segment.blocks.end(), new_blocks.begin(), new_blocks.end());
+    }
+    sealed_rows += rows.size();
+
+    // Commit point: the blocks are part of the table from here on
+    write_manifest(rows.size());
+
+    tail->clear_table();
+    sync_file(tail->get_file_path());
+    tail_rows = 0;
+    write_manifest(0);
+}
+
+void ColumnStorage::build_key_index() {
+    key_index->clear();
+    BTreeBuilder builder(key_index.get());
+    std::vector<int> needed = {key_column};
+    std::unique_ptr<TableCursor> cursor = open_cursor(nullptr, &needed);
+    Row row;
+    uint64_t position = 0;
+    while (cursor->next(row)) {
+        builder.add(row[key_column], std::string_view(), row_id_at(position++));
+    }
+    // Rows from before the key was enforced may repeat it
+    builder.finish(false);
+    key_index->finish_build();
+}
+
+void ColumnStorage::rebuild_indexes() {
+    if (key_index) {
+        build_key_index();
+    }
+}
+
+void ColumnStorage::insert_row(const std::vector<Value>& values) {
+    metadata_manager->validate_insert_values(table_name, values);
+    if (key_index) {
+        key_index->check_key(values[key_column]);
+        if (key_index->contains(values[key_column])) {
+            throw std::runtime_error("Duplicate value for primary key column '" + columns[key_column].name + "'");
+        }
+    }
+
+    uint64_t lsn = tail->append_row(values);
+    if (key_index) {
+        key_index->insert(values[key_column], row_id_at(sealed_rows + tail_rows), lsn);
+    }
+    tail_rows++;
+
+    if (tail_rows >= COLUMN_BLOCK_ROWS) {
+        seal_tail();
+    }
+}
+
+bool ColumnStorage::redo_insert(uint32_t page_no, const std::string& record, uint64_t lsn) {
+    if (!tail->redo_insert(page_no, record, lsn)) {
+        return false;
+    }
+    tail_rows++;
+    return true;
+}
+
+void ColumnStorage::create_index(const IndexDefinition& index) {
+    throw std::runtime_error("Cannot create index '" + index.name + "': column tables have no indexes");
+}
+
+void ColumnStorage::drop_index(const std::string& index_name) {
+    throw std::runtime_error("Index '" + index_name + "' does not exist");
+}
+
+std::unique_ptr<TableCursor> ColumnStorage::open_cursor(const WhereCondition* condition,
+                                                        const std::vector<int>* columns) {
+    // The tail cursor validates the condition
+    std::unique_ptr<TableCursor> tail_cursor = tail->open_cursor(condition, columns);
+
+    BoundCondition bound{};
+    if (condition) {
+        bound = metadata_manager->get_row_codec(table_name)->bind(*condition);
+    }
+
+    std::vector<std::string> paths;
+    std::vector<std::vector<ColumnBlockRef>> blocks;
+    for (const Segment& segment : segments) {
+        paths.push_back(segment.path);
+        blocks.push_back(segment.blocks);
+    }
+
+    return std::make_unique<ColumnScanCursor>(this->columns, paths, std::move(blocks), condition ? &bound : nullptr,
+                                              columns, std::move(tail_cursor));
+}
+
+void ColumnStorage::delete_table_files() {
+    tail->delete_table_files();
+    if (key_index) {
+        key_index->delete_file();
+    }
+
+    std::error_code ec;
+    for (const Segment& segment : segments) {
+        std::filesystem::remove(segment.path, ec);
+    }
+    std::filesystem::remove(manifest_path, ec);
+    // Ignore errors if files don't exist
+}
+
+} // namespace sqldb
@@ -0,0 +1,139 @@
+#ifndef COLUMN_STORAGE_H
+#define COLUMN_STORAGE_H
+
+#include "../common/types.h"
+#include "../common/config.h"
+#include "table_engine.h"
+#include "table.h"
+#include "btree.h"
+#include "column_block.h"
+#include "row_codec.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sqldb {
+
+// Location of one block inside a column segment file
+struct ColumnBlockRef {
+    uint64_t offset;      // Start of the block data, past its header
+    uint32_t row_count;
+    uint32_t data_size;
+    ColumnEncoding encoding;
+    ColumnZone zone;
+};
+
+// Scans the sealed blocks of a column table, then its row-format tail. With
+// a condition, blocks whose predicate column zone rules it out are skipped
+// unread, the predicate column is read for the rest, and the other columns
+// only for blocks that have at least one match. Columns the caller does not
+// read are never loaded and come back unset.
+class ColumnScanCursor : public TableCursor {
+private:
+    std::vector<Column> columns;
+    std::vector<int> fds;
+    std::vector<std::vector<ColumnBlockRef>> blocks;
+    bool has_condition;
+    BoundCondition condition;
+    std::vector<char> needed;   // Columns the caller reads
+
+    // Position
+    size_t block_index;
+    std::vector<ColumnBlock> current;
+    std::vector<uint32_t> selection;
+    size_t selection_pos;
+    std::unique_ptr<TableCursor> tail_cursor;
+
+    void load_block(size_t block);
+    void read_block(size_t column, size_t block);
+
+public:
+    ColumnScanCursor(const std::vector<Column>& columns, const std::vector<std::string>& segment_paths,
+                     std::vector<std::vector<ColumnBlockRef>> blocks, const BoundCondition* condition,
+                     const std::vector<int>* needed_columns, std::unique_ptr<TableCursor> tail_cursor);
+    ~ColumnScanCursor();
+
+    ColumnScanCursor(const ColumnScanCursor&) = delete;
+    ColumnScanCursor& operator=(const ColumnScanCursor&) = delete;
+
+    bool next(Row& row) override;
+    size_t next_columns(ColumnBatch& batch, size_t max_rows) override;
+};
+
+// Column store: every column lives in its own append-only segment file
+// (<table>.<column>.seg) made of blocks of up to COLUMN_BLOCK_ROWS values.
+// New rows go to a row-format tail (the table's .tbl file, logged like any
+// row table) and are sealed into a new block of every segment once the tail
+// holds COLUMN_BLOCK_ROWS rows. A primary key is kept in a B+tree, as for
+// row tables, whose row ids number the rows in scan order. The manifest
+// (<table>.colmeta) records how much of each segment is committed, so a crash
+// mid-seal leaves no partial block behind.
+class ColumnStorage : public TableEngine {
+private:
+    struct Segment {
+        std::string path;
+        uint64_t committed_size = 0;
+        std::vector<ColumnBlockRef> blocks;
+    };
+
+    std::string table_name;
+    std::string manifest_path;
+    MetadataManager* metadata_manager;
+    BufferPool* buffer_pool;
+    WriteAheadLog* wal;
+    std::vector<Column> columns;
+    std::vector<Segment> segments;
+    uint64_t sealed_rows;
+    int key_column;  // Ordinal of the primary key, -1 without one
+    std::unique_ptr<BPlusTree> key_index;
+
+    // Rows not yet sealed into blocks
+    std::unique_ptr<TableStorage> tail;
+    size_t tail_rows;
+
+    // Manifest
+    bool load_manifest(uint64_t& tail_sealed);
+    void write_manifest(uint64_t tail_sealed);
+
+    // Segment files
+    void create_segments();
+    void open_segments();
+    void seal_tail();
+
+    // Primary key index, filled from the sealed blocks and the tail
+    void build_key_index();
+
+public:
+    ColumnStorage(const std::string& table_name, MetadataManager* metadata_mgr, BufferPool* buffer_pool,
+                  WriteAheadLog* wal);
+
+    // Data operations
+    void insert_row(const std::vector<Value>& values) override;
+    bool redo_insert(uint32_t page_no, const std::string& record, uint64_t lsn) override;
+
+    // Rebuilds the primary key index; column tables have no other indexes
+    void rebuild_indexes() override;
+    void create_index(const IndexDefinition& index) override;
+    void drop_index(const std::string& index_name) override;
+
+    // Streaming scan, condition may be null; every column is decoded
+    std::unique_ptr<TableCursor> open_cursor(const WhereCondition* condition = nullptr,
+                                             const std::vector<int>* columns = nullptr) override;
+
+    // Segments are always read with pread; the mode applies to the tail
+    void set_scan_mode(ScanMode mode) override { tail->set_scan_mode(mode); }
+
+    // Sealed blocks are read by one thread; the tail is too small to split
+    void set_scan_threads(size_t) override {}
+
+    // Utility
+    size_t get_row_count() override { return sealed_rows + tail_rows; }
+
+    // File operations
+    void delete_table_files() override;
+};
+
+} // namespace sqldb
+
+#endif // COLUMN_STORAGE_H
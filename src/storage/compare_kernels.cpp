@@ -0,0 +1,289 @@
+#include "compare_kernels.h"
+#include "../common/compare.h"
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SQLDB_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace sqldb {
+
+namespace {
+
+// Every comparison is one of three lane tests, possibly negated:
+// != is not =, <= is not >, >= is not <
+enum class LaneTest {
+    EQUAL,
+    GREATER,
+    LESS
+};
+
+bool split_operator(TokenType op, LaneTest& test, bool& negate) {
+    switch (op) {
+        case TokenType::EQUALS:
+            test = LaneTest::EQUAL;
+            negate = false;
+            return true;
+        case TokenType::NOT_EQUALS:
+            test = LaneTest::EQUAL;
+            negate = true;
+            return true;
+        case TokenType::GREATER_THAN:
+            test = LaneTest::GREATER;
+            negate = false;
+            return true;
+        case TokenType::LESS_EQUAL:
+            test = LaneTest::GREATER;
+            negate = true;
+            return true;
+        case TokenType::LESS_THAN:
+            test = LaneTest::LESS;
+            negate = false;
+            return true;
+        case TokenType::GREATER_EQUAL:
+            test = LaneTest::LESS;
+            negate = true;
+            return true;
+        default:
+            return false;
+    }
+}
+
+uint64_t low_bits(size_t count) {
+    return count >= 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+}
+
+template <LaneTest TEST>
+bool lane_passes(int32_t value, int32_t target) {
+    if constexpr (TEST == LaneTest::EQUAL) {
+        return value == target;
+    } else if constexpr (TEST == LaneTest::GREATER) {
+        return value > target;
+    } else {
+        return value < target;
+    }
+}
+
+// One mask word from up to 64 values; also finishes the vector kernels,
+// whose loops only take whole words
+template <LaneTest TEST>
+uint64_t int32_word(const int32_t* values, size_t count, int32_t target, uint64_t flip) {
+    uint64_t word = 0;
+    for (size_t i = 0; i < count; i++) {
+        word |= static_cast<uint64_t>(lane_passes<TEST>(values[i], target)) << i;
+    }
+    return (word ^ flip) & low_bits(count);
+}
+
+uint64_t truth_word(const uint8_t* values, size_t count) {
+    uint64_t word = 0;
+    for (size_t i = 0; i < count; i++) {
+        word |= static_cast<uint64_t>(values[i] != 0) << i;
+    }
+    return word;
+}
+
+template <LaneTest TEST>
+void int32_scalar(const int32_t* values, size_t count, int32_t target, uint64_t flip, uint64_t* mask) {
+    for (size_t w = 0; w * 64 < count; w++) {
+        mask[w] = int32_word<TEST>(values + w * 64, std::min<size_t>(64, count - w * 64), target, flip);
+    }
+}
+
+// Sets the bits of values that are not zero
+void truth_scalar(const uint8_t* values, size_t count, uint64_t* mask) {
+    for (size_t w = 0; w * 64 < count; w++) {
+        mask[w] = truth_word(values + w * 64, std::min<size_t>(64, count - w * 64));
+    }
+}
+
+#ifdef SQLDB_X86_KERNELS
+
+// Four lanes per compare, sixteen compares per mask word
+template <LaneTest TEST>
+__attribute__((target("sse4.2")))
+void int32_sse42(const int32_t* values, size_t count, int32_t target, uint64_t flip, uint64_t* mask) {
+    const __m128i broadcast = _mm_set1_epi32(target);
+    size_t whole_words = count / 64;
+    for (size_t w = 0; w < whole_words; w++) {
+        uint64_t word = 0;
+        for (size_t lane = 0; lane < 64; lane += 4) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + w * 64 + lane));
+            __m128i result;
+            if constexpr (TEST == LaneTest::EQUAL) {
+                result = _mm_cmpeq_epi32(block, broadcast);
+            } else if constexpr (TEST == LaneTest::GREATER) {
+                result = _mm_cmpgt_epi32(block, broadcast);
+            } else {
+                result = _mm_cmplt_epi32(block, broadcast);
+            }
+            word |= static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(result))) << lane;
+        }
+        mask[w] = word ^ flip;
+    }
+    if (count % 64 != 0) {
+        mask[whole_words] = int32_word<TEST>(values + whole_words * 64, count % 64, target, flip);
+    }
+}
+
+__attribute__((target("sse4.2")))
+void truth_sse42(const uint8_t* values, size_t count, uint64_t* mask) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t whole_words = count / 64;
+    for (size_t w = 0; w < whole_words; w++) {
+        uint64_t zeros = 0;
+        for (size_t lane = 0; lane < 64; lane += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + w * 64 + lane));
+            uint32_t bits = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, zero)));
+            zeros |= static_cast<uint64_t>(bits) << lane;
+        }
+        mask[w] = ~zeros;
+    }
+    if (count % 64 != 0) {
+        mask[whole_words] = truth_word(values + whole_words * 64, count % 64);
+    }
+}
+
+// Eight lanes per compare, eight compares per mask word
+template <LaneTest TEST>
+__attribute__((target("avx2")))
+void int32_avx2(const int32_t* values, size_t count, int32_t target, uint64_t flip, uint64_t* mask) {
+    const __m256i broadcast = _mm256_set1_epi32(target);
+    size_t whole_words = count / 64;
+    for (size_t w = 0; w < whole_words; w++) {
+        uint64_t word = 0;
+        for (size_t lane = 0; lane < 64; lane += 8) {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + w * 64 + lane));
+            __m256i result;
+            if constexpr (TEST == LaneTest::EQUAL) {
+                result = _mm256_cmpeq_epi32(block, broadcast);
+            } else if constexpr (TEST == LaneTest::GREATER) {
+                result = _mm256_cmpgt_epi32(block, broadcast);
+            } else {
+                result = _mm256_cmpgt_epi32(broadcast, block);
+            }
+            word |= static_cast<uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(result))) << lane;
+        }
+        mask[w] = word ^ flip;
+    }
+    if (count % 64 != 0) {
+        mask[whole_words] = int32_word<TEST>(values + whole_words * 64, count % 64, target, flip);
+    }
+}
+
+__attribute__((target("avx2")))
+void truth_avx2(const uint8_t* values, size_t count, uint64_t* mask) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t whole_words = count / 64;
+    for (size_t w = 0; w < whole_words; w++) {
+        __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + w * 64));
+        __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + w * 64 + 32));
+        uint32_t low_zeros = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, zero)));
+        uint32_t high_zeros = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, zero)));
+        mask[w] = ~(static_cast<uint64_t>(high_zeros) << 32 | low_zeros);
+    }
+    if (count % 64 != 0) {
+        mask[whole_words] = truth_word(values + whole_words * 64, count % 64);
+    }
+}
+
+#endif // SQLDB_X86_KERNELS
+
+using Int32Kernel = void (*)(const int32_t* values, size_t count, int32_t target, uint64_t flip, uint64_t* mask);
+using TruthKernel = void (*)(const uint8_t* values, size_t count, uint64_t* mask);
+
+// Indexed by CompareKernels, then by LaneTest
+#ifdef SQLDB_X86_KERNELS
+const Int32Kernel INT32_KERNELS[3][3] = {
+    {int32_scalar<LaneTest::EQUAL>, int32_scalar<LaneTest::GREATER>, int32_scalar<LaneTest::LESS>},
+    {int32_sse42<LaneTest::EQUAL>, int32_sse42<LaneTest::GREATER>, int32_sse42<LaneTest::LESS>},
+    {int32_avx2<LaneTest::EQUAL>, int32_avx2<LaneTest::GREATER>, int32_avx2<LaneTest::LESS>}};
+const TruthKernel TRUTH_KERNELS[3] = {truth_scalar, truth_sse42, truth_avx2};
+#else
+const Int32Kernel INT32_KERNELS[3][3] = {
+    {int32_scalar<LaneTest::EQUAL>, int32_scalar<LaneTest::GREATER>, int32_scalar<LaneTest::LESS>},
+    {int32_scalar<LaneTest::EQUAL>, int32_scalar<LaneTest::GREATER>, int32_scalar<LaneTest::LESS>},
+    {int32_scalar<LaneTest::EQUAL>, int32_scalar<LaneTest::GREATER>, int32_scalar<LaneTest::LESS>}};
+const TruthKernel TRUTH_KERNELS[3] = {truth_scalar, truth_scalar, truth_scalar};
+#endif
+
+CompareKernels best_supported_kernels() {
+#ifdef SQLDB_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return CompareKernels::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return CompareKernels::SSE42;
+    }
+#endif
+    return CompareKernels::SCALAR;
+}
+
+// -1 until the first kernel runs
+std::atomic<int> selected_kernels{-1};
+
+} // namespace
+
+CompareKernels get_compare_kernels() {
+    int kernels = selected_kernels.load(std::memory_order_relaxed);
+    if (kernels < 0) {
+        kernels = static_cast<int>(best_supported_kernels());
+        selected_kernels.store(kernels, std::memory_order_relaxed);
+    }
+    return static_cast<CompareKernels>(kernels);
+}
+
+const char* get_compare_kernels_name(CompareKernels kernels) {
+    switch (kernels) {
+        case CompareKernels::SCALAR:
+            return "scalar";
+        case CompareKernels::SSE42:
+            return "sse4.2";
+        case CompareKernels::AVX2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+void set_compare_kernels(CompareKernels kernels) {
+    int best = static_cast<int>(best_supported_kernels());
+    selected_kernels.store(std::min(static_cast<int>(kernels), best), std::memory_order_relaxed);
+}
+
+void compare_int32(const int32_t* values, size_t count, int32_t target, TokenType op, uint64_t* mask) {
+    LaneTest test;
+    bool negate;
+    if (!split_operator(op, test, negate)) {
+        std::fill(mask, mask + mask_words(count), 0);
+        return;
+    }
+    Int32Kernel kernel = INT32_KERNELS[static_cast<int>(get_compare_kernels())][static_cast<int>(test)];
+    kernel(values, count, target, negate ? ~uint64_t(0) : 0, mask);
+}
+
+void compare_bool(const uint8_t* values, size_t count, bool target, TokenType op, uint64_t* mask) {
+    // A boolean column only holds two values: find the true ones, then keep
+    // them, their complement, both or neither, depending on which pass
+    TRUTH_KERNELS[static_cast<int>(get_compare_kernels())](values, count, mask);
+    uint64_t keep_true = compare_ordered(true, target, op) ? ~uint64_t(0) : 0;
+    uint64_t keep_false = compare_ordered(false, target, op) ? ~uint64_t(0) : 0;
+    for (size_t w = 0; w * 64 < count; w++) {
+        uint64_t truth = mask[w];
+        mask[w] = ((truth & keep_true) | (~truth & keep_false)) & low_bits(count - w * 64);
+    }
+}
+
+void mask_to_selection(const uint64_t* mask, size_t count, uint32_t base, std::vector<uint32_t>& selection) {
+    for (size_t w = 0; w * 64 < count; w++) {
+        uint64_t word = mask[w];
+        while (word != 0) {
+            selection.push_back(base + static_cast<uint32_t>(w * 64 + __builtin_ctzll(word)));
+            word &= word - 1;
+        }
+    }
+}
+
+} // namespace sqldb
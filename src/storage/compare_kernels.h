@@ -0,0 +1,42 @@
+#ifndef COMPARE_KERNELS_H
+#define COMPARE_KERNELS_H
+
+#include "../common/types.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sqldb {
+
+// Instruction sets the comparison kernels come in. The best one the CPU
+// supports is picked the first time a kernel runs.
+enum class CompareKernels {
+    SCALAR,
+    SSE42,
+    AVX2
+};
+
+CompareKernels get_compare_kernels();
+const char* get_compare_kernels_name(CompareKernels kernels);
+
+// Overrides the detected choice, for benchmarks; kernels the CPU lacks fall
+// back to the best it has
+void set_compare_kernels(CompareKernels kernels);
+
+// Words of a bitmask with one bit per value
+inline size_t mask_words(size_t count) {
+    return (count + 63) / 64;
+}
+
+// Compare count values against a constant with a comparison operator token.
+// Bit i of mask is set when value i passes; bits past count are cleared.
+// Operators other than the six comparisons match nothing.
+void compare_int32(const int32_t* values, size_t count, int32_t target, TokenType op, uint64_t* mask);
+void compare_bool(const uint8_t* values, size_t count, bool target, TokenType op, uint64_t* mask);
+
+// Appends base + i to selection for every set bit i, in order
+void mask_to_selection(const uint64_t* mask, size_t count, uint32_t base, std::vector<uint32_t>& selection);
+
+} // namespace sqldb
+
+#endif // COMPARE_KERNELS_H
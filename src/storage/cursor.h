@@ -0,0 +1,49 @@
+#ifndef CURSOR_H
+#define CURSOR_H
+
+#include "../common/types.h"
+#include "column_batch.h"
+#include <cstddef>
+#include <vector>
+
+namespace sqldb {
+
+// Incremental iteration over the rows produced by a table scan. Only the
+// current row or batch is held in memory.
+class TableCursor {
+public:
+    virtual ~TableCursor() = default;
+
+    // Fetches the next row; returns false once the scan is exhausted
+    virtual bool next(Row& row) = 0;
+
+    // Replaces the contents of batch with up to max_rows rows and returns
+    // how many were produced; 0 means the scan is exhausted
+    virtual size_t next_batch(std::vector<Row>& batch, size_t max_rows) {
+        batch.clear();
+        Row row;
+        while (batch.size() < max_rows && next(row)) {
+            batch.push_back(std::move(row));
+        }
+        return batch.size();
+    }
+
+    // Replaces the rows of batch, already laid out for the table, with up to
+    // max_rows rows and returns how many were produced; 0 means the scan is
+    // exhausted. Cursors that can decode straight into column vectors
+    // override this; the default goes through rows.
+    virtual size_t next_columns(ColumnBatch& batch, size_t max_rows) {
+        std::vector<Row> rows;
+        next_batch(rows, max_rows);
+        batch.clear();
+        for (const Row& row : rows) {
+            batch.append_row(row);
+        }
+        batch.set_row_count(rows.size());
+        return rows.size();
+    }
+};
+
+} // namespace sqldb
+
+#endif // CURSOR_H
@@ -0,0 +1,118 @@
+#include "hash_index.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace sqldb {
+
+namespace {
+
+constexpr size_t INITIAL_SLOTS = 64;
+
+} // namespace
+
+HashIndex::HashIndex(DataType key_type) : key_type(key_type), key_count(0), built(false) {
+    slots.assign(INITIAL_SLOTS, 0);
+}
+
+std::string_view HashIndex::key_view(const Value& key, char* scratch) const {
+    // Equal values give equal bytes; VARCHAR keys are hashed in place
+    switch (key_type) {
+        case DataType::INTEGER: {
+            int value = std::get<int>(key);
+            std::memcpy(scratch, &value, sizeof(value));
+            return std::string_view(scratch, sizeof(value));
+        }
+        case DataType::BOOLEAN:
+            scratch[0] = std::get<bool>(key) ? 1 : 0;
+            return std::string_view(scratch, 1);
+        case DataType::VARCHAR:
+            return std::get<std::string>(key);
+    }
+    return std::string_view();
+}
+
+size_t HashIndex::find_slot(std::string_view key, uint64_t hash) const {
+    // Returns the slot holding the key, or the empty slot where it belongs
+    size_t mask = slots.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        if (slots[slot] == 0) {
+            return slot;
+        }
+        const Entry& head = entries[slots[slot] - 1];
+        if (head.hash == hash && head.key_size == key.size() &&
+            std::memcmp(key_bytes.data() + head.key_offset, key.data(), key.size()) == 0) {
+            return slot;
+        }
+    }
+}
+
+void HashIndex::grow() {
+    // Chain heads are distinct keys, so they only need an empty slot
+    std::vector<uint32_t> old_slots(slots.size() * 2, 0);
+    old_slots.swap(slots);
+    size_t mask = slots.size() - 1;
+    for (uint32_t head : old_slots) {
+        if (head == 0) {
+            continue;
+        }
+        size_t slot = entries[head - 1].hash & mask;
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = head;
+    }
+}
+
+void HashIndex::insert(const Value& key, RowId row_id, uint64_t) {
+    char scratch[sizeof(int)];
+    std::string_view bytes = key_view(key, scratch);
+    uint64_t hash = std::hash<std::string_view>()(bytes);
+
+    size_t slot = find_slot(bytes, hash);
+    Entry entry{hash, 0, static_cast<uint32_t>(bytes.size()), slots[slot], row_id};
+    if (slots[slot] != 0) {
+        entry.key_offset = entries[slots[slot] - 1].key_offset;
+    } else {
+        entry.key_offset = key_bytes.size();
+        key_bytes.append(bytes);
+        key_count++;
+    }
+    entries.push_back(entry);
+    slots[slot] = static_cast<uint32_t>(entries.size());
+
+    // At most half the slots in use keeps probe sequences short
+    if (key_count * 2 > slots.size()) {
+        grow();
+    }
+}
+
+void HashIndex::clear() {
+    key_bytes.clear();
+    entries.clear();
+    slots.assign(INITIAL_SLOTS, 0);
+    key_count = 0;
+    built = false;
+}
+
+bool HashIndex::contains(const Value& key) {
+    char scratch[sizeof(int)];
+    std::string_view bytes = key_view(key, scratch);
+    return slots[find_slot(bytes, std::hash<std::string_view>()(bytes))] != 0;
+}
+
+std::unique_ptr<RowIdCursor> HashIndex::open_equal(const Value& key) {
+    char scratch[sizeof(int)];
+    std::string_view bytes = key_view(key, scratch);
+    std::vector<RowId> row_ids;
+    for (uint32_t entry = slots[find_slot(bytes, std::hash<std::string_view>()(bytes))]; entry != 0;
+         entry = entries[entry - 1].next) {
+        row_ids.push_back(entries[entry - 1].row_id);
+    }
+
+    // Chains run newest first; hand the rows out in table order
+    std::reverse(row_ids.begin(), row_ids.end());
+    return std::make_unique<RowIdListCursor>(std::move(row_ids));
+}
+
+} // namespace sqldb
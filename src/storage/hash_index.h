@@ -0,0 +1,62 @@
+#ifndef HASH_INDEX_H
+#define HASH_INDEX_H
+
+#include "../common/types.h"
+#include "key_index.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqldb {
+
+// Open-addressing hash table from key to row ids, held in memory only. It
+// is never written out: the table rebuilds it from its rows when it opens
+// and after recovery, and every insert adds to it afterwards. Equality
+// lookups cost one probe sequence regardless of the table size; there is no
+// key order, so ranges are left to a B+tree or a scan.
+class HashIndex : public KeyIndex {
+private:
+    // Rows with the same key form a chain, newest first; only the chain head
+    // has a slot
+    struct Entry {
+        uint64_t hash;
+        uint64_t key_offset;  // Into key_bytes, shared along a chain
+        uint32_t key_size;
+        uint32_t next;        // Entry number + 1 of the next row with this key, 0 at the end
+        RowId row_id;
+    };
+
+    DataType key_type;
+    std::string key_bytes;          // Distinct keys, back to back
+    std::vector<Entry> entries;
+    std::vector<uint32_t> slots;    // Chain head entry number + 1, 0 when empty; linear probing
+    size_t key_count;
+    bool built;
+
+    std::string_view key_view(const Value& key, char* scratch) const;
+    size_t find_slot(std::string_view key, uint64_t hash) const;
+    void grow();
+
+public:
+    explicit HashIndex(DataType key_type);
+
+    // Empty until the owner has inserted every row once
+    bool needs_rebuild() const override { return !built; }
+
+    // Maintenance; nothing is logged, so the lsn is not needed
+    void check_key(const Value&) const override {}
+    void insert(const Value& key, RowId row_id, uint64_t lsn = 0) override;
+    void clear() override;
+    void finish_build() override { built = true; }
+    void delete_file() override { clear(); }
+
+    // Lookups
+    bool contains(const Value& key) override;
+    std::unique_ptr<RowIdCursor> open_equal(const Value& key) override;
+};
+
+} // namespace sqldb
+
+#endif // HASH_INDEX_H
@@ -0,0 +1,106 @@
+#ifndef KEY_INDEX_H
+#define KEY_INDEX_H
+
+#include "../common/types.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace sqldb {
+
+// Location of a row in a row table: data page number and slot within it
+struct RowId {
+    uint32_t page_no;
+    uint16_t slot;
+};
+
+// Row ids produced by an index lookup
+class RowIdCursor {
+public:
+    virtual ~RowIdCursor() = default;
+
+    // Returns false once the lookup is exhausted
+    virtual bool next(RowId& row_id) = 0;
+};
+
+// Row ids collected before the cursor is handed out
+class RowIdListCursor : public RowIdCursor {
+private:
+    std::vector<RowId> row_ids;
+    size_t position;
+
+public:
+    explicit RowIdListCursor(std::vector<RowId> row_ids) : row_ids(std::move(row_ids)), position(0) {}
+
+    bool next(RowId& row_id) override {
+        if (position >= row_ids.size()) {
+            return false;
+        }
+        row_id = row_ids[position++];
+        return true;
+    }
+};
+
+// Smallest string above every string that starts with prefix; false when
+// there is none, as for an empty prefix or one of only 0xFF bytes
+inline bool prefix_successor(const std::string& prefix, std::string& successor) {
+    successor = prefix;
+    while (!successor.empty() && static_cast<unsigned char>(successor.back()) == 0xFF) {
+        successor.pop_back();
+    }
+    if (successor.empty()) {
+        return false;
+    }
+    successor.back() = static_cast<char>(static_cast<unsigned char>(successor.back()) + 1);
+    return true;
+}
+
+// Maps the values of one column of a row table to the rows holding them.
+// Entries are only ever added; the table rebuilds an index from its rows
+// whenever the index may have fallen behind.
+class KeyIndex {
+public:
+    virtual ~KeyIndex() = default;
+
+    // True when the contents cannot be trusted; the owner must then call
+    // clear(), insert every row again, then finish_build()
+    virtual bool needs_rebuild() const = 0;
+
+    // Maintenance; lsn is the log record of the row insert
+    virtual void check_key(const Value& key) const = 0;
+    virtual void insert(const Value& key, RowId row_id, uint64_t lsn = 0) = 0;
+    virtual void clear() = 0;
+    virtual void finish_build() = 0;
+    virtual void delete_file() = 0;
+
+    // Equality lookups
+    virtual bool contains(const Value& key) = 0;
+    virtual std::unique_ptr<RowIdCursor> open_equal(const Value& key) = 0;
+
+    // Range lookups, for indexes that keep their keys in order; a null bound
+    // leaves that side of the range open
+    virtual bool is_ordered() const { return false; }
+    virtual std::unique_ptr<RowIdCursor> open_range(const Value*, bool, const Value*, bool) {
+        throw std::runtime_error("Index does not support range lookups");
+    }
+
+    // Keys of a VARCHAR column starting with prefix; ordered indexes find
+    // them as the range from the prefix up to the first string past it
+    virtual bool supports_prefix() const { return is_ordered(); }
+    virtual std::unique_ptr<RowIdCursor> open_prefix(const std::string& prefix) {
+        Value lower(prefix);
+        std::string upper;
+        if (!prefix_successor(prefix, upper)) {
+            return open_range(&lower, true, nullptr, true);
+        }
+        Value upper_value(upper);
+        return open_range(&lower, true, &upper_value, false);
+    }
+};
+
+} // namespace sqldb
+
+#endif // KEY_INDEX_H
@@ -0,0 +1,127 @@
+#include "lsm_memtable.h"
+#include <cstring>
+#include <new>
+
+namespace sqldb {
+
+namespace {
+
+constexpr size_t CHUNK_SIZE = 256 * 1024;
+
+} // namespace
+
+MemTable::MemTable()
+    : chunk_position(nullptr), chunk_remaining(0), memory_usage(0), head(nullptr), max_height(1), entry_count(0),
+      max_lsn(0), random_state(0x9E3779B9u) {
+    head = new_node(std::string_view(), std::string_view(), MAX_HEIGHT);
+}
+
+char* MemTable::allocate(size_t bytes) {
+    // Node pointers need their alignment; keys and records share the padding
+    bytes = (bytes + alignof(Node) - 1) & ~(alignof(Node) - 1);
+    if (bytes > chunk_remaining) {
+        // Oversized records get a chunk of their own
+        size_t chunk_size = bytes > CHUNK_SIZE / 4 ? bytes : CHUNK_SIZE;
+        chunks.emplace_back(new char[chunk_size]);
+        memory_usage.fetch_add(chunk_size, std::memory_order_relaxed);
+        if (chunk_size != CHUNK_SIZE) {
+            return chunks.back().get();
+        }
+        chunk_position = chunks.back().get();
+        chunk_remaining = chunk_size;
+    }
+    char* result = chunk_position;
+    chunk_position += bytes;
+    chunk_remaining -= bytes;
+    return result;
+}
+
+MemTable::Node* MemTable::new_node(std::string_view key, std::string_view record, int height) {
+    size_t node_size = sizeof(Node) + sizeof(std::atomic<Node*>) * (height - 1);
+    char* memory = allocate(node_size + key.size() + record.size());
+    char* key_data = memory + node_size;
+    char* record_data = key_data + key.size();
+    std::memcpy(key_data, key.data(), key.size());
+    std::memcpy(record_data, record.data(), record.size());
+
+    Node* node = new (memory) Node{key_data, record_data, static_cast<uint32_t>(key.size()),
+                                   static_cast<uint32_t>(record.size()), {}};
+    for (int level = 0; level < height; level++) {
+        new (&node->next[level]) std::atomic<Node*>(nullptr);
+    }
+    return node;
+}
+
+int MemTable::random_height() {
+    // Each level holds about a quarter of the nodes of the one below
+    int height = 1;
+    while (height < MAX_HEIGHT) {
+        random_state ^= random_state << 13;
+        random_state ^= random_state >> 17;
+        random_state ^= random_state << 5;
+        if ((random_state & 3) != 0) {
+            break;
+        }
+        height++;
+    }
+    return height;
+}
+
+MemTable::Node* MemTable::find_greater_or_equal(std::string_view key, Node** prev) const {
+    Node* node = head;
+    int level = max_height.load(std::memory_order_relaxed) - 1;
+    while (true) {
+        Node* next = node->next[level].load(std::memory_order_acquire);
+        if (next && next->key_view() < key) {
+            node = next;
+            continue;
+        }
+        if (prev) {
+            prev[level] = node;
+        }
+        if (level == 0) {
+            return next;
+        }
+        level--;
+    }
+}
+
+void MemTable::insert(std::string_view key, std::string_view record, uint64_t lsn) {
+    Node* prev[MAX_HEIGHT];
+    find_greater_or_equal(key, prev);
+
+    int height = random_height();
+    int current_height = max_height.load(std::memory_order_relaxed);
+    if (height > current_height) {
+        for (int level = current_height; level < height; level++) {
+            prev[level] = head;
+        }
+        // Readers that see the new height before the links just drop from
+        // the head to a lower level
+        max_height.store(height, std::memory_order_relaxed);
+    }
+
+    // Link bottom up; the release store publishes the node on each level
+    Node* node = new_node(key, record, height);
+    for (int level = 0; level < height; level++) {
+        node->next[level].store(prev[level]->next[level].load(std::memory_order_relaxed),
+                                std::memory_order_relaxed);
+        prev[level]->next[level].store(node, std::memory_order_release);
+    }
+
+    entry_count.fetch_add(1, std::memory_order_release);
+    if (lsn > max_lsn.load(std::memory_order_relaxed)) {
+        max_lsn.store(lsn, std::memory_order_release);
+    }
+}
+
+bool MemTable::get(std::string_view key, std::string& record) const {
+    Node* node = find_greater_or_equal(key, nullptr);
+    if (!node || node->key_view() != key) {
+        return false;
+    }
+    record.assign(node->record, node->record_size);
+    return true;
+}
+
+} // namespace sqldb
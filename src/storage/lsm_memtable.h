@@ -0,0 +1,99 @@
+#ifndef LSM_MEMTABLE_H
+#define LSM_MEMTABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqldb {
+
+// Entries of an LSM table in key order: encoded key and row record
+class EntryIterator {
+public:
+    virtual ~EntryIterator() = default;
+
+    virtual bool valid() const = 0;
+    virtual std::string_view key() const = 0;
+    virtual std::string_view record() const = 0;
+    virtual void next() = 0;
+
+    // Positions at the first entry whose key is not less than key
+    virtual void seek(std::string_view key) = 0;
+    virtual void seek_to_first() = 0;
+};
+
+// Write buffer of an LSM table: a skiplist over (key, record) entries whose
+// nodes live in an arena and are never freed or unlinked. One thread inserts
+// at a time; readers need no lock, because a node is fully built before the
+// release store that links it in and readers follow links with acquire loads.
+class MemTable {
+private:
+    static constexpr int MAX_HEIGHT = 12;
+
+    struct Node {
+        const char* key;
+        const char* record;
+        uint32_t key_size;
+        uint32_t record_size;
+        std::atomic<Node*> next[1];  // Really height entries
+
+        std::string_view key_view() const { return std::string_view(key, key_size); }
+    };
+
+    // Arena
+    std::vector<std::unique_ptr<char[]>> chunks;
+    char* chunk_position;
+    size_t chunk_remaining;
+    std::atomic<size_t> memory_usage;
+
+    Node* head;
+    std::atomic<int> max_height;
+    std::atomic<size_t> entry_count;
+    std::atomic<uint64_t> max_lsn;
+    uint32_t random_state;
+
+    char* allocate(size_t bytes);
+    Node* new_node(std::string_view key, std::string_view record, int height);
+    int random_height();
+
+    // Last node before key on every level; prev may be null
+    Node* find_greater_or_equal(std::string_view key, Node** prev) const;
+
+public:
+    class Iterator : public EntryIterator {
+    private:
+        const MemTable* table;
+        Node* node;
+
+    public:
+        explicit Iterator(const MemTable* table) : table(table), node(nullptr) {}
+
+        bool valid() const override { return node != nullptr; }
+        std::string_view key() const override { return node->key_view(); }
+        std::string_view record() const override { return std::string_view(node->record, node->record_size); }
+        void next() override { node = node->next[0].load(std::memory_order_acquire); }
+        void seek(std::string_view key) override { node = table->find_greater_or_equal(key, nullptr); }
+        void seek_to_first() override { node = table->head->next[0].load(std::memory_order_acquire); }
+    };
+
+    MemTable();
+
+    MemTable(const MemTable&) = delete;
+    MemTable& operator=(const MemTable&) = delete;
+
+    // Keys must be new; lsn is the log record of the insert
+    void insert(std::string_view key, std::string_view record, uint64_t lsn);
+    bool get(std::string_view key, std::string& record) const;
+
+    size_t get_memory_usage() const { return memory_usage.load(std::memory_order_relaxed); }
+    size_t size() const { return entry_count.load(std::memory_order_acquire); }
+    uint64_t get_max_lsn() const { return max_lsn.load(std::memory_order_acquire); }
+};
+
+} // namespace sqldb
+
+#endif // LSM_MEMTABLE_H
@@ -0,0 +1,348 @@
+#include "lsm_run.h"
+#include "bloom_filter.h"
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sqldb {
+
+namespace {
+
+constexpr char RUN_MAGIC[8] = {'S', 'Q', 'L', 'M', 'R', 'U', 'N', '1'};
+constexpr size_t FOOTER_SIZE = 8 + 4 + 8 + 4 + 8 + sizeof(RUN_MAGIC);
+
+// Ten bits and seven probes per key: about one false positive in a hundred
+constexpr size_t FILTER_BITS_PER_KEY = 10;
+constexpr int FILTER_PROBES = 7;
+
+void read_exact(int fd, char* data, size_t length, uint64_t offset, const std::string& path) {
+    while (length > 0) {
+        ssize_t bytes_read = ::pread(fd, data, length, static_cast<off_t>(offset));
+        if (bytes_read <= 0) {
+            throw std::runtime_error("Short read in LSM run: " + path);
+        }
+        data += bytes_read;
+        length -= static_cast<size_t>(bytes_read);
+        offset += static_cast<uint64_t>(bytes_read);
+    }
+}
+
+template <typename T>
+T load(const char* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+template <typename T>
+void append(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Double hashing: probe i tests bit h1 + i * h2, as in the page Bloom filters
+uint64_t filter_bit(uint64_t hash, int probe, size_t filter_size) {
+    uint32_t h1 = static_cast<uint32_t>(hash);
+    uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+    return (h1 + static_cast<uint64_t>(probe) * h2) % (static_cast<uint64_t>(filter_size) * 8);
+}
+
+} // namespace
+
+SortedRun::SortedRun(uint64_t number, const std::string& path)
+    : number(number), path(path), fd(-1), file_size(0), entry_count(0), obsolete(false) {}
+
+SortedRun::~SortedRun() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    if (obsolete.load()) {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        // Ignore errors; the next open removes files no manifest lists
+    }
+}
+
+std::shared_ptr<SortedRun> SortedRun::open(uint64_t number, const std::string& path) {
+    std::shared_ptr<SortedRun> run(new SortedRun(number, path));
+    run->fd = ::open(path.c_str(), O_RDONLY);
+    if (run->fd < 0) {
+        throw std::runtime_error("Cannot open LSM run: " + path);
+    }
+
+    struct stat st;
+    if (::fstat(run->fd, &st) != 0) {
+        throw std::runtime_error("Cannot stat LSM run: " + path);
+    }
+    run->file_size = static_cast<uint64_t>(st.st_size);
+    if (run->file_size < FOOTER_SIZE) {
+        throw std::runtime_error("LSM run is truncated: " + path);
+    }
+
+    char footer[FOOTER_SIZE];
+    read_exact(run->fd, footer, FOOTER_SIZE, run->file_size - FOOTER_SIZE, path);
+    if (std::memcmp(footer + FOOTER_SIZE - sizeof(RUN_MAGIC), RUN_MAGIC, sizeof(RUN_MAGIC)) != 0) {
+        throw std::runtime_error("Not an LSM run file: " + path);
+    }
+    uint64_t index_offset = load<uint64_t>(footer);
+    uint32_t index_size = load<uint32_t>(footer + 8);
+    uint64_t filter_offset = load<uint64_t>(footer + 12);
+    uint32_t filter_size = load<uint32_t>(footer + 20);
+    run->entry_count = load<uint64_t>(footer + 24);
+    if (index_offset + index_size > filter_offset || filter_offset + filter_size + FOOTER_SIZE != run->file_size ||
+        filter_size == 0) {
+        throw std::runtime_error("Corrupt LSM run footer: " + path);
+    }
+
+    std::string index(index_size, '\0');
+    read_exact(run->fd, index.data(), index_size, index_offset, path);
+    run->filter.resize(filter_size);
+    read_exact(run->fd, run->filter.data(), filter_size, filter_offset, path);
+
+    // Smallest key, then one handle per block
+    const char* position = index.data();
+    const char* end = index.data() + index.size();
+    auto read_key = [&](std::string& key) {
+        if (end - position < 2 || end - position < 2 + load<uint16_t>(position)) {
+            throw std::runtime_error("Corrupt LSM run index: " + path);
+        }
+        uint16_t key_size = load<uint16_t>(position);
+        key.assign(position + 2, key_size);
+        position += 2 + key_size;
+    };
+    read_key(run->smallest_key);
+    while (position < end) {
+        BlockHandle handle;
+        read_key(handle.last_key);
+        if (end - position < 12) {
+            throw std::runtime_error("Corrupt LSM run index: " + path);
+        }
+        handle.offset = load<uint64_t>(position);
+        handle.size = load<uint32_t>(position + 8);
+        position += 12;
+        run->blocks.push_back(std::move(handle));
+    }
+    if (run->blocks.empty()) {
+        throw std::runtime_error("LSM run has no entries: " + path);
+    }
+    return run;
+}
+
+size_t SortedRun::find_block(std::string_view key) const {
+    size_t low = 0;
+    size_t high = blocks.size();
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (std::string_view(blocks[middle].last_key) < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+std::string SortedRun::read_block(size_t block_index) const {
+    const BlockHandle& handle = blocks[block_index];
+    std::string data(handle.size, '\0');
+    read_exact(fd, data.data(), handle.size, handle.offset, path);
+    return data;
+}
+
+bool SortedRun::may_contain(std::string_view key) const {
+    uint64_t hash = bloom_hash(key.data(), key.size());
+    for (int probe = 0; probe < FILTER_PROBES; probe++) {
+        uint64_t bit = filter_bit(hash, probe, filter.size());
+        if (!(filter[bit / 8] & (1 << (bit % 8)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SortedRun::get(std::string_view key, std::string& record) const {
+    if (key < smallest_key || !may_contain(key)) {
+        return false;
+    }
+    Iterator iterator(this);
+    iterator.seek(key);
+    if (!iterator.valid() || iterator.key() != key) {
+        return false;
+    }
+    record.assign(iterator.record());
+    return true;
+}
+
+void SortedRun::Iterator::load_block(size_t block_index) {
+    block = block_index;
+    data = run->read_block(block_index);
+    position = 0;
+}
+
+void SortedRun::Iterator::next() {
+    // Blocks are never empty, so one step past the end of a block is enough
+    if (position >= data.size()) {
+        if (block + 1 >= run->blocks.size()) {
+            has_entry = false;
+            return;
+        }
+        load_block(block + 1);
+    }
+
+    const char* entry = data.data() + position;
+    uint16_t key_size = load<uint16_t>(entry);
+    uint32_t record_size = load<uint32_t>(entry + 2 + key_size);
+    if (position + 2 + key_size + 4 + record_size > data.size()) {
+        throw std::runtime_error("Corrupt LSM run block: " + run->path);
+    }
+    current_key = std::string_view(entry + 2, key_size);
+    current_record = std::string_view(entry + 2 + key_size + 4, record_size);
+    position += 2 + key_size + 4 + record_size;
+    has_entry = true;
+}
+
+void SortedRun::Iterator::seek(std::string_view key) {
+    size_t block_index = run->find_block(key);
+    if (block_index >= run->blocks.size()) {
+        has_entry = false;
+        return;
+    }
+    load_block(block_index);
+    next();
+    while (has_entry && current_key < key) {
+        next();
+    }
+}
+
+void SortedRun::Iterator::seek_to_first() {
+    load_block(0);
+    next();
+}
+
+RunWriter::RunWriter(const std::string& path) : path(path), fd(-1), offset(0), entry_count(0) {
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create LSM run: " + path);
+    }
+}
+
+RunWriter::~RunWriter() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+void RunWriter::write(const std::string& data) {
+    const char* position = data.data();
+    size_t length = data.size();
+    while (length > 0) {
+        ssize_t written = ::pwrite(fd, position, length, static_cast<off_t>(offset));
+        if (written < 0) {
+            throw std::runtime_error("Cannot write LSM run: " + path);
+        }
+        position += written;
+        length -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+}
+
+void RunWriter::flush_block() {
+    if (block.empty()) {
+        return;
+    }
+    append<uint16_t>(index, static_cast<uint16_t>(last_key.size()));
+    index.append(last_key);
+    append<uint64_t>(index, offset);
+    append<uint32_t>(index, static_cast<uint32_t>(block.size()));
+    write(block);
+    block.clear();
+}
+
+void RunWriter::add(std::string_view key, std::string_view record) {
+    if (entry_count == 0) {
+        smallest_key.assign(key);
+    }
+    append<uint16_t>(block, static_cast<uint16_t>(key.size()));
+    block.append(key);
+    append<uint32_t>(block, static_cast<uint32_t>(record.size()));
+    block.append(record);
+    last_key.assign(key);
+    key_hashes.push_back(bloom_hash(key.data(), key.size()));
+    entry_count++;
+
+    if (block.size() >= LSM_BLOCK_SIZE) {
+        flush_block();
+    }
+}
+
+void RunWriter::finish() {
+    flush_block();
+
+    std::string index_block;
+    append<uint16_t>(index_block, static_cast<uint16_t>(smallest_key.size()));
+    index_block.append(smallest_key);
+    index_block.append(index);
+    uint64_t index_offset = offset;
+    write(index_block);
+
+    std::string filter((key_hashes.size() * FILTER_BITS_PER_KEY + 63) / 64 * 8, '\0');
+    for (uint64_t hash : key_hashes) {
+        for (int probe = 0; probe < FILTER_PROBES; probe++) {
+            uint64_t bit = filter_bit(hash, probe, filter.size());
+            filter[bit / 8] = static_cast<char>(filter[bit / 8] | (1 << (bit % 8)));
+        }
+    }
+    uint64_t filter_offset = offset;
+    write(filter);
+
+    std::string footer;
+    append<uint64_t>(footer, index_offset);
+    append<uint32_t>(footer, static_cast<uint32_t>(index_block.size()));
+    append<uint64_t>(footer, filter_offset);
+    append<uint32_t>(footer, static_cast<uint32_t>(filter.size()));
+    append<uint64_t>(footer, entry_count);
+    footer.append(RUN_MAGIC, sizeof(RUN_MAGIC));
+    write(footer);
+
+    if (::fdatasync(fd) != 0) {
+        throw std::runtime_error("Cannot sync LSM run: " + path);
+    }
+}
+
+void MergingIterator::pick_smallest() {
+    current = nullptr;
+    for (const std::unique_ptr<EntryIterator>& input : inputs) {
+        if (input->valid() && (!current || input->key() < current->key())) {
+            current = input.get();
+        }
+    }
+}
+
+void MergingIterator::next() {
+    // Older copies of the key just returned are passed over as well
+    for (const std::unique_ptr<EntryIterator>& input : inputs) {
+        if (input.get() != current && input->valid() && input->key() == current->key()) {
+            input->next();
+        }
+    }
+    current->next();
+    pick_smallest();
+}
+
+void MergingIterator::seek(std::string_view key) {
+    for (const std::unique_ptr<EntryIterator>& input : inputs) {
+        input->seek(key);
+    }
+    pick_smallest();
+}
+
+void MergingIterator::seek_to_first() {
+    for (const std::unique_ptr<EntryIterator>& input : inputs) {
+        input->seek_to_first();
+    }
+    pick_smallest();
+}
+
+} // namespace sqldb
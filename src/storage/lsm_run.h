@@ -0,0 +1,161 @@
+#ifndef LSM_RUN_H
+#define LSM_RUN_H
+
+#include "lsm_memtable.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sqldb {
+
+// Runs are cut into blocks of about this many bytes; a point read fetches one
+constexpr size_t LSM_BLOCK_SIZE = 4096;
+
+// Immutable sorted file of an LSM table (<table>.<number>.run):
+//
+//   data blocks   entries back to back: u16 key size, key, u32 record size, record
+//   index block   u16 size and bytes of the smallest key, then per data block
+//                 u16 size and bytes of its largest key, u64 offset, u32 size
+//   Bloom filter  bit array over every key
+//   footer        u64 index offset, u32 index size, u64 filter offset,
+//                 u32 filter size, u64 entry count, magic
+//
+// The index and the filter stay in memory while the run is open; data blocks
+// are read with pread, so any number of threads can read a run at once. A run
+// marked obsolete removes its file once the last reader lets go of it.
+class SortedRun {
+private:
+    struct BlockHandle {
+        std::string last_key;
+        uint64_t offset;
+        uint32_t size;
+    };
+
+    uint64_t number;
+    std::string path;
+    int fd;
+    uint64_t file_size;
+    uint64_t entry_count;
+    std::string smallest_key;
+    std::vector<BlockHandle> blocks;
+    std::string filter;
+    std::atomic<bool> obsolete;
+
+    SortedRun(uint64_t number, const std::string& path);
+
+    // First block whose largest key is not less than key
+    size_t find_block(std::string_view key) const;
+
+public:
+    // Opens and checks an existing run file
+    static std::shared_ptr<SortedRun> open(uint64_t number, const std::string& path);
+    ~SortedRun();
+
+    SortedRun(const SortedRun&) = delete;
+    SortedRun& operator=(const SortedRun&) = delete;
+
+    class Iterator : public EntryIterator {
+    private:
+        const SortedRun* run;
+        size_t block;
+        std::string data;
+        size_t position;       // Next entry in data
+        bool has_entry;
+        std::string_view current_key;
+        std::string_view current_record;
+
+        void load_block(size_t block_index);
+
+    public:
+        explicit Iterator(const SortedRun* run) : run(run), block(0), position(0), has_entry(false) {}
+
+        bool valid() const override { return has_entry; }
+        std::string_view key() const override { return current_key; }
+        std::string_view record() const override { return current_record; }
+        void next() override;
+        void seek(std::string_view key) override;
+        void seek_to_first() override;
+    };
+
+    // Point read; the filter rules out most runs without reading a block
+    bool may_contain(std::string_view key) const;
+    bool get(std::string_view key, std::string& record) const;
+
+    uint64_t get_number() const { return number; }
+    uint64_t get_file_size() const { return file_size; }
+    uint64_t get_entry_count() const { return entry_count; }
+    const std::string& get_smallest_key() const { return smallest_key; }
+    const std::string& get_largest_key() const { return blocks.back().last_key; }
+    bool overlaps(std::string_view smallest, std::string_view largest) const {
+        return !(get_largest_key() < smallest || largest < get_smallest_key());
+    }
+
+    // The file goes away with the last reference
+    void mark_obsolete() { obsolete.store(true); }
+
+    // Reads a block for iterators
+    std::string read_block(size_t block_index) const;
+    size_t block_count() const { return blocks.size(); }
+};
+
+// Writes entries, given in key order, into a new run file. finish() makes the
+// file durable; a writer dropped before that leaves a partial file behind that
+// the table ignores and removes on the next open.
+class RunWriter {
+private:
+    std::string path;
+    int fd;
+    uint64_t offset;
+    uint64_t entry_count;
+    std::string smallest_key;
+    std::string last_key;
+    std::string block;
+    std::string index;
+    std::vector<uint64_t> key_hashes;
+
+    void write(const std::string& data);
+    void flush_block();
+
+public:
+    explicit RunWriter(const std::string& path);
+    ~RunWriter();
+
+    RunWriter(const RunWriter&) = delete;
+    RunWriter& operator=(const RunWriter&) = delete;
+
+    void add(std::string_view key, std::string_view record);
+    void finish();
+
+    uint64_t get_entry_count() const { return entry_count; }
+    uint64_t estimated_size() const { return offset + block.size(); }
+};
+
+// Merges iterators over disjoint or overlapping key sets into one stream in
+// key order. A key present in several inputs is taken from the first of them,
+// so inputs are listed newest first.
+class MergingIterator : public EntryIterator {
+private:
+    std::vector<std::unique_ptr<EntryIterator>> inputs;
+    EntryIterator* current;
+
+    void pick_smallest();
+
+public:
+    explicit MergingIterator(std::vector<std::unique_ptr<EntryIterator>> inputs)
+        : inputs(std::move(inputs)), current(nullptr) {}
+
+    bool valid() const override { return current != nullptr; }
+    std::string_view key() const override { return current->key(); }
+    std::string_view record() const override { return current->record(); }
+    void next() override;
+    void seek(std::string_view key) override;
+    void seek_to_first() override;
+};
+
+} // namespace sqldb
+
+#endif // LSM_RUN_H
@@ -0,0 +1,706 @@
+#include "lsm_storage.h"
+#include "metadata.h"
+#include "btree.h"
+#include "wal.h"
+#include "../common/compare.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sqldb {
+
+namespace {
+
+void sync_file(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+    int result = ::fsync(fd);
+    ::close(fd);
+    if (result != 0) {
+        throw std::runtime_error("Cannot sync file: " + path);
+    }
+}
+
+// Level 1 holds LSM_LEVEL1_BYTES, every deeper level ten times the one above
+uint64_t max_level_bytes(int level) {
+    uint64_t bytes = LSM_LEVEL1_BYTES;
+    for (int i = 1; i < level; i++) {
+        bytes *= 10;
+    }
+    return bytes;
+}
+
+uint64_t level_bytes(const std::vector<std::shared_ptr<SortedRun>>& runs) {
+    uint64_t bytes = 0;
+    for (const std::shared_ptr<SortedRun>& run : runs) {
+        bytes += run->get_file_size();
+    }
+    return bytes;
+}
+
+void sort_level(std::vector<std::shared_ptr<SortedRun>>& runs) {
+    std::sort(runs.begin(), runs.end(), [](const std::shared_ptr<SortedRun>& a, const std::shared_ptr<SortedRun>& b) {
+        return a->get_smallest_key() < b->get_smallest_key();
+    });
+}
+
+} // namespace
+
+LsmScanCursor::LsmScanCursor(std::vector<std::shared_ptr<MemTable>> memtables,
+                             std::vector<std::shared_ptr<SortedRun>> runs, std::shared_ptr<const RowCodec> codec,
+                             const std::string* lower, const std::string* upper, bool upper_inclusive,
+                             const BoundCondition* filter)
+    : memtables(std::move(memtables)), runs(std::move(runs)), codec(std::move(codec)), has_upper(upper != nullptr),
+      upper_inclusive(upper_inclusive), has_filter(filter != nullptr), filter{} {
+    if (upper) {
+        this->upper = *upper;
+    }
+    if (filter) {
+        this->filter = *filter;
+    }
+
+    std::vector<std::unique_ptr<EntryIterator>> inputs;
+    for (const std::shared_ptr<MemTable>& memtable : this->memtables) {
+        inputs.push_back(std::make_unique<MemTable::Iterator>(memtable.get()));
+    }
+    for (const std::shared_ptr<SortedRun>& run : this->runs) {
+        inputs.push_back(std::make_unique<SortedRun::Iterator>(run.get()));
+    }
+    entries = std::make_unique<MergingIterator>(std::move(inputs));
+    if (lower) {
+        entries->seek(*lower);
+    } else {
+        entries->seek_to_first();
+    }
+}
+
+bool LsmScanCursor::next(Row& row) {
+    while (entries->valid()) {
+        if (has_upper) {
+            int order = entries->key().compare(upper);
+            if (order > 0 || (order == 0 && !upper_inclusive)) {
+                return false;
+            }
+        }
+
+        // The record view only lasts until the iterator moves on
+        std::string_view record = entries->record();
+        bool match = !has_filter || codec->matches(record, filter);
+        if (match) {
+            row = codec->decode(record);
+        }
+        entries->next();
+        if (match) {
+            return true;
+        }
+    }
+    return false;
+}
+
+LsmStorage::LsmStorage(const std::string& table_name, MetadataManager* metadata_mgr, WriteAheadLog* wal)
+    : table_name(table_name), metadata_manager(metadata_mgr), wal(wal), key_column(-1), checkpoint_hook(-1),
+      next_run_number(1), flushed_lsn(0), stopping(false) {
+    if (!metadata_mgr) {
+        throw std::runtime_error("MetadataManager cannot be null");
+    }
+
+    manifest_path = metadata_manager->get_lsm_manifest_path(table_name);
+    codec = metadata_manager->get_row_codec(table_name);
+    const std::vector<Column> columns = metadata_manager->get_columns(table_name);
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (columns[i].is_primary_key) {
+            key_column = static_cast<int>(i);
+            break;
+        }
+    }
+
+    auto version = std::make_shared<LsmVersion>();
+    if (!load_manifest(*version)) {
+        write_manifest(*version);
+    }
+    remove_orphan_runs(*version);
+    current = version;
+    active = std::make_shared<MemTable>();
+
+    // Logged rows still in memory must reach a run before the log is emptied
+    checkpoint_hook = wal->add_checkpoint_hook([this]() { flush_memtables(); });
+    background = std::thread(&LsmStorage::background_loop, this);
+}
+
+LsmStorage::~LsmStorage() {
+    if (background.joinable()) {
+        try {
+            flush_memtables();
+        } catch (...) {
+            // The rows stay in the log and are replayed on the next open
+        }
+        stop_background();
+    }
+    if (checkpoint_hook >= 0) {
+        wal->remove_checkpoint_hook(checkpoint_hook);
+    }
+}
+
+bool LsmStorage::load_manifest(LsmVersion& version) {
+    std::ifstream file(manifest_path);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    // Format: NEXT_RUN:n, FLUSHED_LSN:n and one RUN:level:number per run,
+    // level 0 newest first
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream iss(line);
+        std::string key;
+        std::getline(iss, key, ':');
+        if (key == "NEXT_RUN") {
+            std::string value;
+            std::getline(iss, value);
+            next_run_number = std::stoull(value);
+        } else if (key == "FLUSHED_LSN") {
+            std::string value;
+            std::getline(iss, value);
+            flushed_lsn = std::stoull(value);
+        } else if (key == "RUN") {
+            std::string level_str;
+            std::string number_str;
+            std::getline(iss, level_str, ':');
+            std::getline(iss, number_str);
+            int level = std::stoi(level_str);
+            if (level < 0 || level >= LSM_LEVELS) {
+                throw std::runtime_error("Bad level in LSM manifest: " + manifest_path);
+            }
+            uint64_t number = std::stoull(number_str);
+            version.levels[level].push_back(SortedRun::open(number, get_run_path(number)));
+        }
+    }
+
+    for (int level = 1; level < LSM_LEVELS; level++) {
+        sort_level(version.levels[level]);
+    }
+    return true;
+}
+
+void LsmStorage::write_manifest(const LsmVersion& version) {
+    // Written beside the old manifest and renamed over it, so a crash leaves
+    // one complete version
+    std::string temp_path = manifest_path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot write LSM manifest: " + temp_path);
+        }
+
+        file << "# LSM manifest for table " << table_name << "\n";
+        file << "NEXT_RUN:" << next_run_number << "\n";
+        file << "FLUSHED_LSN:" << flushed_lsn << "\n";
+        for (int level = 0; level < LSM_LEVELS; level++) {
+            for (const std::shared_ptr<SortedRun>& run : version.levels[level]) {
+                file << "RUN:" << level << ":" << run->get_number() << "\n";
+            }
+        }
+
+        if (!file) {
+            throw std::runtime_error("Cannot write LSM manifest: " + temp_path);
+        }
+    }
+    sync_file(temp_path);
+
+    std::error_code ec;
+    std::filesystem::rename(temp_path, manifest_path, ec);
+    if (ec) {
+        throw std::runtime_error("Cannot replace LSM manifest: " + manifest_path);
+    }
+}
+
+void LsmStorage::remove_orphan_runs(const LsmVersion& version) {
+    // Runs written by a flush or compaction that never got installed
+    std::set<std::string> live;
+    for (int level = 0; level < LSM_LEVELS; level++) {
+        for (const std::shared_ptr<SortedRun>& run : version.levels[level]) {
+            live.insert(std::filesystem::path(get_run_path(run->get_number())).filename().string());
+        }
+    }
+
+    std::string prefix = table_name + ".";
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(metadata_manager->get_data_directory(), ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() <= prefix.size() + 4 || name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - 4, 4, ".run") != 0) {
+            continue;
+        }
+        std::string number = name.substr(prefix.size(), name.size() - prefix.size() - 4);
+        if (number.find_first_not_of("0123456789") == std::string::npos && !live.count(name)) {
+            std::error_code remove_ec;
+            std::filesystem::remove(entry.path(), remove_ec);
+        }
+    }
+}
+
+std::string LsmStorage::get_run_path(uint64_t number) const {
+    return metadata_manager->get_lsm_run_path(table_name, number);
+}
+
+std::string LsmStorage::make_key(const Row& row, uint64_t lsn) const {
+    if (key_column >= 0) {
+        return encode_index_key(codec->get_columns()[key_column].type, row[key_column]);
+    }
+
+    // Big-endian log position keeps keyless tables in insertion order
+    char bytes[sizeof(lsn)];
+    for (size_t i = 0; i < sizeof(lsn); i++) {
+        bytes[i] = static_cast<char>(lsn >> (8 * (sizeof(lsn) - 1 - i)));
+    }
+    return std::string(bytes, sizeof(bytes));
+}
+
+void LsmStorage::check_background_error() const {
+    if (!background_error.empty()) {
+        throw std::runtime_error("LSM table '" + table_name + "' failed in the background: " + background_error);
+    }
+}
+
+void LsmStorage::make_room(std::unique_lock<std::mutex>& lock) {
+    while (true) {
+        check_background_error();
+
+        // Writes stall while level 0 is too deep for reads to stay cheap
+        if (current->levels[0].size() >= LSM_L0_STOP_RUNS) {
+            work_done.wait(lock);
+            continue;
+        }
+        if (active->get_memory_usage() < LSM_MEMTABLE_BYTES) {
+            return;
+        }
+        if (immutable) {
+            work_done.wait(lock);
+            continue;
+        }
+        immutable = active;
+        active = std::make_shared<MemTable>();
+        work_ready.notify_one();
+        return;
+    }
+}
+
+void LsmStorage::flush_memtables() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (immutable && background_error.empty()) {
+        work_done.wait(lock);
+    }
+    if (active->size() > 0 && background_error.empty()) {
+        immutable = active;
+        active = std::make_shared<MemTable>();
+        work_ready.notify_one();
+    }
+    while (immutable && background_error.empty()) {
+        work_done.wait(lock);
+    }
+    check_background_error();
+}
+
+void LsmStorage::background_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (!background_error.empty()) {
+            work_ready.wait(lock);
+            continue;
+        }
+
+        // Flushes come first: a writer may be waiting for the memtable
+        std::shared_ptr<MemTable> memtable = immutable;
+        lock.unlock();
+        bool worked = true;
+        try {
+            if (memtable) {
+                flush_immutable(memtable);
+            } else {
+                worked = compact_once();
+            }
+        } catch (const std::exception& e) {
+            lock.lock();
+            background_error = e.what();
+            work_done.notify_all();
+            continue;
+        }
+        lock.lock();
+
+        if (worked) {
+            work_done.notify_all();
+        } else if (!immutable && !stopping) {
+            work_ready.wait(lock);
+        }
+    }
+}
+
+void LsmStorage::flush_immutable(std::shared_ptr<MemTable> memtable) {
+    MemTable::Iterator entries(memtable.get());
+    entries.seek_to_first();
+    install({}, 0, write_runs(entries, false), memtable.get());
+}
+
+bool LsmStorage::compact_once() {
+    std::shared_ptr<const LsmVersion> version;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        version = current;
+    }
+
+    // Level 0 runs overlap, so they all move down together; below that the
+    // first level over its size gives up one run, taken in turn by key range
+    int level = -1;
+    std::vector<std::shared_ptr<SortedRun>> inputs;
+    if (version->levels[0].size() >= LSM_L0_COMPACTION_RUNS) {
+        level = 0;
+        inputs = version->levels[0];
+    } else {
+        for (int candidate = 1; candidate < LSM_LEVELS - 1 && level < 0; candidate++) {
+            const std::vector<std::shared_ptr<SortedRun>>& runs = version->levels[candidate];
+            if (level_bytes(runs) <= max_level_bytes(candidate)) {
+                continue;
+            }
+            level = candidate;
+            inputs.push_back(runs.front());
+            for (const std::shared_ptr<SortedRun>& run : runs) {
+                if (run->get_largest_key() > compact_pointer[candidate]) {
+                    inputs.back() = run;
+                    break;
+                }
+            }
+        }
+    }
+    if (level < 0) {
+        return false;
+    }
+
+    std::string smallest = inputs.front()->get_smallest_key();
+    std::string largest = inputs.front()->get_largest_key();
+    for (const std::shared_ptr<SortedRun>& run : inputs) {
+        smallest = std::min(smallest, run->get_smallest_key());
+        largest = std::max(largest, run->get_largest_key());
+    }
+    std::vector<std::shared_ptr<SortedRun>> overlapping;
+    for (const std::shared_ptr<SortedRun>& run : version->levels[level + 1]) {
+        if (run->overlaps(smallest, largest)) {
+            overlapping.push_back(run);
+        }
+    }
+    compact_pointer[level] = largest;
+
+    // A lone run that overlaps nothing below just changes level
+    if (level > 0 && overlapping.empty()) {
+        install(inputs, level + 1, inputs, nullptr);
+        return true;
+    }
+
+    // Level 0 is newest first and every level is newer than the next
+    std::vector<std::unique_ptr<EntryIterator>> iterators;
+    for (const std::shared_ptr<SortedRun>& run : inputs) {
+        iterators.push_back(std::make_unique<SortedRun::Iterator>(run.get()));
+    }
+    for (const std::shared_ptr<SortedRun>& run : overlapping) {
+        iterators.push_back(std::make_unique<SortedRun::Iterator>(run.get()));
+    }
+    MergingIterator merged(std::move(iterators));
+    merged.seek_to_first();
+    std::vector<std::shared_ptr<SortedRun>> outputs = write_runs(merged, true);
+
+    inputs.insert(inputs.end(), overlapping.begin(), overlapping.end());
+    install(inputs, level + 1, outputs, nullptr);
+    return true;
+}
+
+std::vector<std::shared_ptr<SortedRun>> LsmStorage::write_runs(EntryIterator& entries, bool split) {
+    std::vector<std::shared_ptr<SortedRun>> runs;
+    while (entries.valid()) {
+        uint64_t number;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            number = next_run_number++;
+        }
+        std::string path = get_run_path(number);
+        {
+            RunWriter writer(path);
+            while (entries.valid() && (!split || writer.estimated_size() < LSM_RUN_BYTES)) {
+                writer.add(entries.key(), entries.record());
+                entries.next();
+            }
+            writer.finish();
+        }
+        runs.push_back(SortedRun::open(number, path));
+    }
+    return runs;
+}
+
+void LsmStorage::install(const std::vector<std::shared_ptr<SortedRun>>& removed, int output_level,
+                         const std::vector<std::shared_ptr<SortedRun>>& added, const MemTable* flushed) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto next = std::make_shared<LsmVersion>(*current);
+    for (int level = 0; level < LSM_LEVELS; level++) {
+        std::vector<std::shared_ptr<SortedRun>>& runs = next->levels[level];
+        runs.erase(std::remove_if(runs.begin(), runs.end(),
+                                  [&](const std::shared_ptr<SortedRun>& run) {
+                                      return std::find(removed.begin(), removed.end(), run) != removed.end();
+                                  }),
+                   runs.end());
+    }
+
+    std::vector<std::shared_ptr<SortedRun>>& output = next->levels[output_level];
+    if (output_level == 0) {
+        output.insert(output.begin(), added.begin(), added.end());
+    } else {
+        output.insert(output.end(), added.begin(), added.end());
+        sort_level(output);
+    }
+
+    uint64_t previous_lsn = flushed_lsn;
+    if (flushed) {
+        flushed_lsn = std::max(flushed_lsn, flushed->get_max_lsn());
+    }
+    try {
+        write_manifest(*next);
+    } catch (...) {
+        flushed_lsn = previous_lsn;
+        throw;
+    }
+
+    // Readers holding the old version keep the removed files until they finish
+    current = next;
+    for (const std::shared_ptr<SortedRun>& run : removed) {
+        if (std::find(added.begin(), added.end(), run) == added.end()) {
+            run->mark_obsolete();
+        }
+    }
+    if (flushed) {
+        immutable.reset();
+    }
+}
+
+void LsmStorage::stop_background() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_ready.notify_all();
+    background.join();
+}
+
+bool LsmStorage::get(const std::string& key, std::string& record) {
+    std::shared_ptr<MemTable> newest;
+    std::shared_ptr<MemTable> flushing;
+    std::shared_ptr<const LsmVersion> version;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        newest = active;
+        flushing = immutable;
+        version = current;
+    }
+
+    if (newest->get(key, record) || (flushing && flushing->get(key, record))) {
+        return true;
+    }
+    for (const std::shared_ptr<SortedRun>& run : version->levels[0]) {
+        if (run->get(key, record)) {
+            return true;
+        }
+    }
+
+    // Deeper levels have at most one run whose range holds the key
+    for (int level = 1; level < LSM_LEVELS; level++) {
+        const std::vector<std::shared_ptr<SortedRun>>& runs = version->levels[level];
+        auto it = std::lower_bound(runs.begin(), runs.end(), key,
+                                   [](const std::shared_ptr<SortedRun>& run, const std::string& target) {
+                                       return run->get_largest_key() < target;
+                                   });
+        if (it != runs.end() && (*it)->get(key, record)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void LsmStorage::insert_row(const std::vector<Value>& values) {
+    metadata_manager->validate_insert_values(table_name, values);
+    std::string record = codec->encode(values);
+
+    std::string key;
+    if (key_column >= 0) {
+        key = make_key(values, 0);
+        std::string existing;
+        if (get(key, existing)) {
+            throw std::runtime_error("Duplicate value for primary key column '" +
+                                     codec->get_columns()[key_column].name + "'");
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        make_room(lock);
+    }
+
+    // Only this thread swaps the active memtable, so it can be used unlocked
+    uint64_t lsn = wal->append(WalRecordType::INSERT, table_name, 0, record);
+    if (key_column < 0) {
+        key = make_key(values, lsn);
+    }
+    active->insert(key, record, lsn);
+    wal->commit(lsn);
+}
+
+bool LsmStorage::redo_insert(uint32_t, const std::string& record, uint64_t lsn) {
+    {
+        // Records up to the manifest's position are already in a run
+        std::unique_lock<std::mutex> lock(mutex);
+        if (lsn <= flushed_lsn) {
+            return false;
+        }
+        make_room(lock);
+    }
+    active->insert(make_key(key_column >= 0 ? codec->decode(record) : Row(), lsn), record, lsn);
+    return true;
+}
+
+void LsmStorage::create_index(const IndexDefinition& index) {
+    throw std::runtime_error("Cannot create index '" + index.name + "': LSM tables have no indexes");
+}
+
+void LsmStorage::drop_index(const std::string& index_name) {
+    throw std::runtime_error("Index '" + index_name + "' does not exist");
+}
+
+std::unique_ptr<TableCursor> LsmStorage::open_cursor(const WhereCondition* condition, const std::vector<int>*) {
+    BoundCondition bound{};
+    if (condition) {
+        metadata_manager->validate_where_condition(table_name, *condition);
+        bound = codec->bind(*condition);
+    }
+
+    std::vector<std::shared_ptr<MemTable>> memtables;
+    std::shared_ptr<const LsmVersion> version;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        memtables.push_back(active);
+        if (immutable) {
+            memtables.push_back(immutable);
+        }
+        version = current;
+    }
+
+    // Conditions on the primary key become a key range; the filter stays
+    // only where the range is wider than the condition
+    bool keyed = condition && key_column >= 0 && bound.column_index == key_column &&
+                 bound.operator_type != TokenType::NOT_EQUALS;
+    if (keyed && bound.type == DataType::VARCHAR &&
+        std::get<std::string>(bound.value).size() > MAX_INDEX_KEY_SIZE) {
+        keyed = false;
+    }
+    std::string lower;
+    std::string upper;
+    bool has_lower = false;
+    bool has_upper = false;
+    bool upper_inclusive = true;
+    bool needs_filter = condition != nullptr;
+    if (keyed) {
+        needs_filter = false;
+        if (bound.operator_type == TokenType::LIKE) {
+            lower = std::string(like_prefix(std::get<std::string>(bound.value)));
+            has_lower = true;
+            has_upper = prefix_successor(lower, upper);
+            upper_inclusive = false;
+            needs_filter = !like_is_prefix_only(std::get<std::string>(bound.value));
+        } else {
+            std::string key = encode_index_key(bound.type, bound.value);
+            switch (bound.operator_type) {
+                case TokenType::EQUALS:
+                    lower = key;
+                    upper = key;
+                    has_lower = true;
+                    has_upper = true;
+                    break;
+                case TokenType::LESS_THAN:
+                case TokenType::LESS_EQUAL:
+                    upper = key;
+                    has_upper = true;
+                    upper_inclusive = bound.operator_type == TokenType::LESS_EQUAL;
+                    break;
+                case TokenType::GREATER_THAN:
+                    // No key sorts between a key and the key with a zero byte appended
+                    lower = key + '\0';
+                    has_lower = true;
+                    break;
+                default:
+                    lower = key;
+                    has_lower = true;
+                    break;
+            }
+        }
+    }
+
+    // Runs that cannot hold a key in range are left out; an equality lookup
+    // also asks each run's Bloom filter
+    bool point = keyed && bound.operator_type == TokenType::EQUALS;
+    std::vector<std::shared_ptr<SortedRun>> runs;
+    for (int level = 0; level < LSM_LEVELS; level++) {
+        for (const std::shared_ptr<SortedRun>& run : version->levels[level]) {
+            if ((has_lower && run->get_largest_key() < lower) || (has_upper && run->get_smallest_key() > upper) ||
+                (point && !run->may_contain(lower))) {
+                continue;
+            }
+            runs.push_back(run);
+        }
+    }
+
+    return std::make_unique<LsmScanCursor>(std::move(memtables), std::move(runs), codec,
+                                           has_lower ? &lower : nullptr, has_upper ? &upper : nullptr,
+                                           upper_inclusive, needs_filter ? &bound : nullptr);
+}
+
+size_t LsmStorage::get_row_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = active->size() + (immutable ? immutable->size() : 0);
+    for (int level = 0; level < LSM_LEVELS; level++) {
+        for (const std::shared_ptr<SortedRun>& run : current->levels[level]) {
+            count += run->get_entry_count();
+        }
+    }
+    return count;
+}
+
+void LsmStorage::delete_table_files() {
+    // The rows go with the table, so nothing is flushed first
+    if (background.joinable()) {
+        stop_background();
+    }
+    wal->remove_checkpoint_hook(checkpoint_hook);
+    checkpoint_hook = -1;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int level = 0; level < LSM_LEVELS; level++) {
+        for (const std::shared_ptr<SortedRun>& run : current->levels[level]) {
+            run->mark_obsolete();
+        }
+    }
+    current = std::make_shared<LsmVersion>();
+    active = std::make_shared<MemTable>();
+    immutable.reset();
+
+    std::error_code ec;
+    std::filesystem::remove(manifest_path, ec);
+    std::filesystem::remove(manifest_path + ".tmp", ec);
+    // Ignore errors if files don't exist
+}
+
+} // namespace sqldb
@@ -0,0 +1,168 @@
+#ifndef LSM_STORAGE_H
+#define LSM_STORAGE_H
+
+#include "../common/types.h"
+#include "../common/config.h"
+#include "table_engine.h"
+#include "row_codec.h"
+#include "lsm_memtable.h"
+#include "lsm_run.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sqldb {
+
+// Sizes that drive flushing and compaction
+constexpr size_t LSM_MEMTABLE_BYTES = 4 * 1024 * 1024;
+constexpr size_t LSM_RUN_BYTES = 2 * 1024 * 1024;
+constexpr size_t LSM_L0_COMPACTION_RUNS = 4;
+constexpr size_t LSM_L0_STOP_RUNS = 12;
+constexpr uint64_t LSM_LEVEL1_BYTES = 10 * 1024 * 1024;
+constexpr int LSM_LEVELS = 7;
+
+// The runs of an LSM table at one point in time. Level 0 holds flushed
+// memtables, newest first, whose key ranges may overlap; every deeper level
+// holds runs with disjoint key ranges in key order. Versions are never
+// changed once published, so readers keep using theirs while compaction
+// installs the next.
+struct LsmVersion {
+    std::vector<std::shared_ptr<SortedRun>> levels[LSM_LEVELS];
+};
+
+// Merges memtables and runs, newest first, in key order from a lower key up
+// to an upper one, and decodes the entries that pass the filter
+class LsmScanCursor : public TableCursor {
+private:
+    // Keep what the iterator reads alive
+    std::vector<std::shared_ptr<MemTable>> memtables;
+    std::vector<std::shared_ptr<SortedRun>> runs;
+    std::unique_ptr<MergingIterator> entries;
+    std::shared_ptr<const RowCodec> codec;
+
+    bool has_upper;
+    std::string upper;
+    bool upper_inclusive;
+    bool has_filter;
+    BoundCondition filter;
+
+public:
+    LsmScanCursor(std::vector<std::shared_ptr<MemTable>> memtables, std::vector<std::shared_ptr<SortedRun>> runs,
+                  std::shared_ptr<const RowCodec> codec, const std::string* lower, const std::string* upper,
+                  bool upper_inclusive, const BoundCondition* filter);
+
+    bool next(Row& row) override;
+};
+
+// Write-optimized table engine. Inserts are logged to the shared write-ahead
+// log and land in a skiplist memtable; a full memtable is frozen and a
+// background thread writes it out as an immutable sorted run, then merges
+// runs level by level (leveled compaction) so that each level is about ten
+// times the size of the one above and a key lives in at most one run per
+// level below level 0. Nothing is ever updated in place.
+//
+// Rows are kept in primary key order, or in insertion order for tables
+// without a primary key. Reads merge the memtables with every level; lookups
+// by primary key stop at the first run holding the key and skip most runs
+// through their Bloom filters.
+//
+// The manifest (<table>.lsm) lists the live runs and the last log record they
+// include. Replay skips records up to that point, and before every checkpoint
+// empties the log the memtables are flushed, so no logged row is lost.
+class LsmStorage : public TableEngine {
+private:
+    std::string table_name;
+    std::string manifest_path;
+    MetadataManager* metadata_manager;
+    WriteAheadLog* wal;
+    std::shared_ptr<const RowCodec> codec;
+    int key_column;     // Primary key ordinal, -1 to key rows by log position
+    int checkpoint_hook;
+
+    // Guards everything below; the writer and the background thread only
+    // hold it while swapping memtables or versions
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+    std::shared_ptr<MemTable> active;
+    std::shared_ptr<MemTable> immutable;   // Being flushed, null when none
+    std::shared_ptr<const LsmVersion> current;
+    uint64_t next_run_number;
+    uint64_t flushed_lsn;
+    std::string background_error;
+    bool stopping;
+    std::thread background;
+
+    // Only used by the background thread: where the next compaction of each
+    // level starts, so every key range gets its turn
+    std::string compact_pointer[LSM_LEVELS];
+
+    // Manifest
+    bool load_manifest(LsmVersion& version);
+    void write_manifest(const LsmVersion& version);
+    void remove_orphan_runs(const LsmVersion& version);
+    std::string get_run_path(uint64_t number) const;
+
+    // Keys
+    std::string make_key(const Row& row, uint64_t lsn) const;
+
+    // Memtables
+    void make_room(std::unique_lock<std::mutex>& lock);
+    void flush_memtables();
+    void check_background_error() const;
+
+    // Background work
+    void background_loop();
+    void flush_immutable(std::shared_ptr<MemTable> memtable);
+    bool compact_once();
+    std::vector<std::shared_ptr<SortedRun>> write_runs(EntryIterator& entries, bool split);
+    // Publishes the next version; flushed is the memtable the added run holds
+    void install(const std::vector<std::shared_ptr<SortedRun>>& removed, int output_level,
+                 const std::vector<std::shared_ptr<SortedRun>>& added, const MemTable* flushed);
+    void stop_background();
+
+    // Point read through every memtable and level
+    bool get(const std::string& key, std::string& record);
+
+public:
+    LsmStorage(const std::string& table_name, MetadataManager* metadata_mgr, WriteAheadLog* wal);
+    ~LsmStorage();
+
+    LsmStorage(const LsmStorage&) = delete;
+    LsmStorage& operator=(const LsmStorage&) = delete;
+
+    // Data operations
+    void insert_row(const std::vector<Value>& values) override;
+    bool redo_insert(uint32_t page_no, const std::string& record, uint64_t lsn) override;
+
+    // LSM tables have no secondary indexes; the primary key orders the runs
+    void rebuild_indexes() override {}
+    void create_index(const IndexDefinition& index) override;
+    void drop_index(const std::string& index_name) override;
+
+    // Streaming scan, condition may be null; conditions on the primary key
+    // read only the matching key range
+    std::unique_ptr<TableCursor> open_cursor(const WhereCondition* condition = nullptr,
+                                             const std::vector<int>* columns = nullptr) override;
+
+    // Runs are always read with pread
+    void set_scan_mode(ScanMode) override {}
+
+    // Scans merge every run in key order, which one thread does
+    void set_scan_threads(size_t) override {}
+
+    // Utility
+    size_t get_row_count() override;
+
+    // File operations
+    void delete_table_files() override;
+};
+
+} // namespace sqldb
+
+#endif // LSM_STORAGE_H
@@ -0,0 +1,73 @@
+#include "mapped_file.h"
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sqldb {
+
+MappedFile::MappedFile(const std::string& path)
+    : path(path), fd(-1), data(nullptr), length(0) {
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file for mapping: " + path);
+    }
+
+    try {
+        refresh();
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+}
+
+MappedFile::~MappedFile() {
+    unmap();
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+void MappedFile::map(size_t new_length) {
+    if (new_length == 0) {
+        return;
+    }
+
+    void* address = ::mmap(nullptr, new_length, PROT_READ, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("Cannot map file: " + path);
+    }
+
+    // Scans walk the file front to back
+    ::madvise(address, new_length, MADV_SEQUENTIAL);
+
+    data = static_cast<const char*>(address);
+    length = new_length;
+}
+
+void MappedFile::unmap() {
+    if (data) {
+        ::munmap(const_cast<char*>(data), length);
+        data = nullptr;
+        length = 0;
+    }
+}
+
+bool MappedFile::refresh() {
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        throw std::runtime_error("Cannot stat file: " + path);
+    }
+
+    size_t new_length = static_cast<size_t>(st.st_size);
+    if (data && new_length == length) {
+        return false;
+    }
+
+    unmap();
+    map(new_length);
+    return true;
+}
+
+} // namespace sqldb
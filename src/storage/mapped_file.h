@@ -0,0 +1,37 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace sqldb {
+
+// Read-only memory mapping of a file that can follow the file as it grows
+class MappedFile {
+private:
+    std::string path;
+    int fd;
+    const char* data;
+    size_t length;
+
+    void map(size_t new_length);
+    void unmap();
+
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Re-maps the file if its size changed since the last call.
+    // Returns true when the mapping was replaced.
+    bool refresh();
+
+    const char* get_data() const { return data; }
+    size_t size() const { return length; }
+};
+
+} // namespace sqldb
+
+#endif // MAPPED_FILE_H
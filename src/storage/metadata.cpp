@@ -1,4 +1,5 @@
 #include "metadata.h"
+#include "page.h"
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
@@ -8,7 +9,7 @@
 namespace sqldb {
 
 MetadataManager::MetadataManager(const std::string& data_dir) 
-    : data_directory(data_dir), metadata_file(data_dir + "/metadata.db") {
+    : data_directory(data_dir), metadata_file(data_dir + "/metadata.db"), schema_version_counter(0) {
     ensure_data_directory();
     load_metadata();
 }
@@ -39,7 +40,7 @@ void MetadataManager::load_metadata() {
         }
         
         // Parse table definition line
-        // Format: TABLE:table_name:column_count
+        // Format: TABLE:table_name:column_count[:storage]
         if (line.substr(0, 6) == "TABLE:") {
             std::istringstream iss(line);
             std::string token;
@@ -49,11 +50,17 @@ void MetadataManager::load_metadata() {
             std::getline(iss, table_name, ':');
             
             std::string count_str;
-            std::getline(iss, count_str);
+            std::getline(iss, count_str, ':');
             int column_count = std::stoi(count_str);
             
             auto schema = std::make_unique<TableSchema>(table_name);
             
+            // Files written before storage types existed hold row tables only
+            std::string storage_str;
+            if (std::getline(iss, storage_str)) {
+                schema->storage = deserialize_storage_type(storage_str);
+            }
+            
             // Read column definitions
             for (int i = 0; i < column_count; i++) {
                 if (!std::getline(file, line)) {
@@ -63,6 +70,9 @@ void MetadataManager::load_metadata() {
             }
             
             tables[table_name] = std::move(schema);
+            schema_versions[table_name] = ++schema_version_counter;
+        } else if (line.substr(0, 6) == "INDEX:") {
+            deserialize_index(line);
         }
     }
 }
@@ -74,15 +84,21 @@ void MetadataManager::save_metadata() {
     }
     
     file << "# SQL Database Engine Metadata\n";
-    file << "# Format: TABLE:name:column_count followed by column definitions\n\n";
+    file << "# Format: TABLE:name:column_count:storage followed by column definitions,\n";
+    file << "# then INDEX:name:table:column:unique:method[:included,columns] for each index of the table\n\n";
     
     for (const auto& [table_name, schema] : tables) {
-        file << "TABLE:" << table_name << ":" << schema->columns.size() << "\n";
+        file << "TABLE:" << table_name << ":" << schema->columns.size() << ":"
+             << serialize_storage_type(schema->storage) << "\n";
         
         for (const auto& column : schema->columns) {
             file << serialize_column(column) << "\n";
         }
         
+        for (const auto& index : schema->indexes) {
+            file << serialize_index(table_name, index) << "\n";
+        }
+        
         file << "\n";
     }
 }
@@ -103,6 +119,40 @@ DataType MetadataManager::deserialize_data_type(const std::string& type_str) {
     throw std::runtime_error("Unknown data type: " + type_str);
 }
 
+std::string MetadataManager::serialize_storage_type(StorageType storage) {
+    switch (storage) {
+        case StorageType::ROW: return "ROW";
+        case StorageType::COLUMN: return "COLUMN";
+        case StorageType::LSM: return "LSM";
+        default: return "UNKNOWN";
+    }
+}
+
+StorageType MetadataManager::deserialize_storage_type(const std::string& storage_str) {
+    if (storage_str == "ROW") return StorageType::ROW;
+    if (storage_str == "COLUMN") return StorageType::COLUMN;
+    if (storage_str == "LSM") return StorageType::LSM;
+    throw std::runtime_error("Unknown storage type: " + storage_str);
+}
+
+std::string MetadataManager::serialize_index_method(IndexMethod method) {
+    switch (method) {
+        case IndexMethod::BTREE: return "BTREE";
+        case IndexMethod::HASH: return "HASH";
+        case IndexMethod::BITMAP: return "BITMAP";
+        case IndexMethod::ART: return "ART";
+        default: return "UNKNOWN";
+    }
+}
+
+IndexMethod MetadataManager::deserialize_index_method(const std::string& method_str) {
+    if (method_str == "BTREE") return IndexMethod::BTREE;
+    if (method_str == "HASH") return IndexMethod::HASH;
+    if (method_str == "BITMAP") return IndexMethod::BITMAP;
+    if (method_str == "ART") return IndexMethod::ART;
+    throw std::runtime_error("Unknown index method: " + method_str);
+}
+
 std::string MetadataManager::serialize_column(const Column& column) {
     std::ostringstream oss;
     oss << "COLUMN:" << column.name << ":" << serialize_data_type(column.type);
@@ -115,6 +165,7 @@ std::string MetadataManager::serialize_column(const Column& column) {
     
     oss << ":" << (column.is_primary_key ? "1" : "0");
     oss << ":" << (column.is_not_null ? "1" : "0");
+    oss << ":" << (column.has_bloom_filter ? "1" : "0");
     
     return oss.str();
 }
@@ -141,17 +192,75 @@ Column MetadataManager::deserialize_column(const std::string& column_str) {
     bool is_primary_key = (pk_str == "1");
     
     std::string nn_str;
-    std::getline(iss, nn_str);
+    std::getline(iss, nn_str, ':');
     bool is_not_null = (nn_str == "1");
     
-    return Column(name, type, varchar_length, is_primary_key, is_not_null);
+    Column column(name, type, varchar_length, is_primary_key, is_not_null);
+    
+    // Files written before Bloom filters existed end here
+    std::string bloom_str;
+    if (std::getline(iss, bloom_str)) {
+        column.has_bloom_filter = (bloom_str == "1");
+    }
+    
+    return column;
+}
+
+std::string MetadataManager::serialize_index(const std::string& table_name, const IndexDefinition& index) {
+    std::string line = "INDEX:" + index.name + ":" + table_name + ":" + index.column_name + ":" +
+                       (index.is_unique ? "1" : "0") + ":" + serialize_index_method(index.method);
+    
+    // Covering indexes append their INCLUDE columns, comma separated
+    for (size_t i = 0; i < index.include_columns.size(); i++) {
+        line += (i == 0 ? ":" : ",") + index.include_columns[i];
+    }
+    return line;
+}
+
+void MetadataManager::deserialize_index(const std::string& index_str) {
+    std::istringstream iss(index_str);
+    std::string token;
+    
+    std::getline(iss, token, ':'); // Skip "INDEX"
+    
+    std::string name;
+    std::getline(iss, name, ':');
+    
+    std::string table_name;
+    std::getline(iss, table_name, ':');
+    
+    std::string column_name;
+    std::getline(iss, column_name, ':');
+    
+    std::string unique_str;
+    std::getline(iss, unique_str, ':');
+    
+    // Indexes written before index methods existed are B+trees
+    IndexMethod method = IndexMethod::BTREE;
+    std::string method_str;
+    if (std::getline(iss, method_str, ':')) {
+        method = deserialize_index_method(method_str);
+    }
+    
+    IndexDefinition index(name, column_name, unique_str == "1", method);
+    std::string include_str;
+    while (std::getline(iss, include_str, ',')) {
+        index.include_columns.push_back(include_str);
+    }
+    
+    auto it = tables.find(table_name);
+    if (it == tables.end()) {
+        throw std::runtime_error("Index '" + name + "' refers to unknown table '" + table_name + "'");
+    }
+    it->second->indexes.push_back(std::move(index));
 }
 
 bool MetadataManager::table_exists(const std::string& table_name) const {
     return tables.find(table_name) != tables.end();
 }
 
-void MetadataManager::create_table(const std::string& table_name, const std::vector<Column>& columns) {
+void MetadataManager::create_table(const std::string& table_name, const std::vector<Column>& columns,
+                                   StorageType storage) {
     if (table_exists(table_name)) {
         throw std::runtime_error("Table '" + table_name + "' already exists");
     }
@@ -196,9 +305,36 @@ void MetadataManager::create_table(const std::string& table_name, const std::vec
         throw std::runtime_error("Table can have at most one primary key");
     }
     
+    // Row tables, and the tail of a column table, keep each row in one page
+    if (storage != StorageType::LSM) {
+        size_t max_row_size = 0;
+        for (const auto& column : columns) {
+            switch (column.type) {
+                case DataType::INTEGER:
+                    max_row_size += 4;
+                    break;
+                case DataType::BOOLEAN:
+                    max_row_size += 1;
+                    break;
+                case DataType::VARCHAR:
+                    max_row_size += 2 + static_cast<size_t>(column.varchar_length);
+                    break;
+            }
+        }
+        if (max_row_size > SlottedPage::MAX_RECORD_SIZE) {
+            throw std::runtime_error("Rows of table '" + table_name + "' can take up to " +
+                                     std::to_string(max_row_size) + " bytes, more than the " +
+                                     std::to_string(SlottedPage::MAX_RECORD_SIZE) +
+                                     " a page holds; use shorter VARCHAR columns or WITH (storage = lsm)");
+        }
+    }
+    
     auto schema = std::make_unique<TableSchema>(table_name);
     schema->columns = columns;
+    schema->storage = storage;
     tables[table_name] = std::move(schema);
+    schema_versions[table_name] = ++schema_version_counter;
+    row_codecs.erase(table_name);
     
     save_metadata();
 }
@@ -209,6 +345,8 @@ void MetadataManager::drop_table(const std::string& table_name) {
     }
     
     tables.erase(table_name);
+    schema_versions.erase(table_name);
+    row_codecs.erase(table_name);
     save_metadata();
     
     // Also delete the table data file
@@ -218,6 +356,74 @@ void MetadataManager::drop_table(const std::string& table_name) {
     // Ignore errors if file doesn't exist
 }
 
+void MetadataManager::validate_new_index(const std::string& table_name, const IndexDefinition& index) const {
+    validate_table_name(table_name);
+    
+    if (index.name.empty()) {
+        throw std::runtime_error("Index name cannot be empty");
+    }
+    if (!get_index_table(index.name).empty()) {
+        throw std::runtime_error("Index '" + index.name + "' already exists");
+    }
+    if (get_table_schema(table_name)->storage != StorageType::ROW) {
+        throw std::runtime_error("Indexes can only be created on row tables");
+    }
+    const Column* column = get_column(table_name, index.column_name);
+    if (!column) {
+        throw std::runtime_error("Column '" + index.column_name + "' does not exist in table '" + table_name + "'");
+    }
+    if (index.method == IndexMethod::ART && column->type != DataType::VARCHAR) {
+        throw std::runtime_error("ART indexes need a VARCHAR column, '" + index.column_name + "' is not one");
+    }
+    
+    // Only B+tree entries have room for the values of other columns
+    if (!index.include_columns.empty() && index.method != IndexMethod::BTREE) {
+        throw std::runtime_error("INCLUDE is only supported by B+tree indexes");
+    }
+    for (size_t i = 0; i < index.include_columns.size(); i++) {
+        const std::string& name = index.include_columns[i];
+        if (!get_column(table_name, name)) {
+            throw std::runtime_error("Column '" + name + "' does not exist in table '" + table_name + "'");
+        }
+        if (name == index.column_name ||
+            std::find(index.include_columns.begin(), index.include_columns.begin() + i, name) !=
+                index.include_columns.begin() + i) {
+            throw std::runtime_error("Column '" + name + "' appears more than once in index '" + index.name + "'");
+        }
+    }
+}
+
+void MetadataManager::create_index(const std::string& table_name, const IndexDefinition& index) {
+    validate_new_index(table_name, index);
+    
+    tables[table_name]->indexes.push_back(index);
+    save_metadata();
+}
+
+void MetadataManager::drop_index(const std::string& index_name) {
+    std::string table_name = get_index_table(index_name);
+    if (table_name.empty()) {
+        throw std::runtime_error("Index '" + index_name + "' does not exist");
+    }
+    
+    std::vector<IndexDefinition>& indexes = tables[table_name]->indexes;
+    indexes.erase(std::remove_if(indexes.begin(), indexes.end(),
+                                 [&](const IndexDefinition& index) { return index.name == index_name; }),
+                  indexes.end());
+    save_metadata();
+}
+
+std::string MetadataManager::get_index_table(const std::string& index_name) const {
+    for (const auto& [table_name, schema] : tables) {
+        for (const auto& index : schema->indexes) {
+            if (index.name == index_name) {
+                return table_name;
+            }
+        }
+    }
+    return "";
+}
+
 const TableSchema* MetadataManager::get_table_schema(const std::string& table_name) const {
     auto it = tables.find(table_name);
     return (it != tables.end()) ? it->second.get() : nullptr;
@@ -271,6 +477,27 @@ int MetadataManager::get_column_index(const std::string& table_name, const std::
     return -1;
 }
 
+uint64_t MetadataManager::get_schema_version(const std::string& table_name) const {
+    auto it = schema_versions.find(table_name);
+    return (it != schema_versions.end()) ? it->second : 0;
+}
+
+std::shared_ptr<const RowCodec> MetadataManager::get_row_codec(const std::string& table_name) const {
+    auto it = row_codecs.find(table_name);
+    if (it != row_codecs.end()) {
+        return it->second;
+    }
+    
+    const TableSchema* schema = get_table_schema(table_name);
+    if (!schema) {
+        throw std::runtime_error("Table '" + table_name + "' does not exist");
+    }
+    
+    auto codec = std::make_shared<const RowCodec>(*schema, get_schema_version(table_name));
+    row_codecs[table_name] = codec;
+    return codec;
+}
+
 void MetadataManager::validate_table_name(const std::string& table_name) const {
     if (!table_exists(table_name)) {
         throw std::runtime_error("Table '" + table_name + "' does not exist");
@@ -345,8 +572,60 @@ void MetadataManager::validate_where_condition(const std::string& table_name, co
     }
 }
 
+void MetadataManager::validate_where_clause(const std::string& table_name, const WhereExpression& expression) const {
+    switch (expression.kind) {
+        case WhereExpression::Kind::COMPARISON:
+            validate_where_condition(table_name, *expression.comparison);
+            break;
+        case WhereExpression::Kind::IN:
+            // Every listed value must fit the column, as if compared with =
+            for (const Value& value : expression.values) {
+                validate_where_condition(table_name, WhereCondition(expression.column_name, TokenType::EQUALS, value));
+            }
+            break;
+        default:
+            for (const auto& child : expression.children) {
+                validate_where_clause(table_name, *child);
+            }
+            break;
+    }
+}
+
 std::string MetadataManager::get_table_file_path(const std::string& table_name) const {
     return data_directory + "/" + table_name + ".tbl";
 }
 
+std::string MetadataManager::get_column_segment_path(const std::string& table_name,
+                                                     const std::string& column_name) const {
+    return data_directory + "/" + table_name + "." + column_name + ".seg";
+}
+
+std::string MetadataManager::get_column_manifest_path(const std::string& table_name) const {
+    return data_directory + "/" + table_name + ".colmeta";
+}
+
+std::string MetadataManager::get_lsm_manifest_path(const std::string& table_name) const {
+    return data_directory + "/" + table_name + ".lsm";
+}
+
+std::string MetadataManager::get_lsm_run_path(const std::string& table_name, uint64_t run_number) const {
+    return data_directory + "/" + table_name + "." + std::to_string(run_number) + ".run";
+}
+
+std::string MetadataManager::get_zone_map_path(const std::string& table_name) const {
+    return data_directory + "/" + table_name + ".zmap";
+}
+
+std::string MetadataManager::get_bloom_filter_path(const std::string& table_name) const {
+    return data_directory + "/" + table_name + ".bloom";
+}
+
+std::string MetadataManager::get_primary_index_path(const std::string& table_name) const {
+    return data_directory + "/" + table_name + ".pk.idx";
+}
+
+std::string MetadataManager::get_index_path(const std::string& index_name) const {
+    return data_directory + "/" + index_name + ".idx";
+}
+
 } // namespace sqldb
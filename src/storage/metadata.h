@@ -2,6 +2,7 @@
 #define METADATA_H
 
 #include "../common/types.h"
+#include "row_codec.h"
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -15,6 +16,12 @@ private:
     std::string metadata_file;
     std::unordered_map<std::string, std::unique_ptr<TableSchema>> tables;
     
+    // Schema versions change whenever a table is (re)created, which
+    // invalidates the cached row codecs built for the old schema
+    std::unordered_map<std::string, uint64_t> schema_versions;
+    uint64_t schema_version_counter;
+    mutable std::unordered_map<std::string, std::shared_ptr<const RowCodec>> row_codecs;
+    
     // File I/O helpers
     void ensure_data_directory();
     void load_metadata();
@@ -23,8 +30,14 @@ private:
     // Serialization helpers
     std::string serialize_data_type(DataType type);
     DataType deserialize_data_type(const std::string& type_str);
+    std::string serialize_storage_type(StorageType storage);
+    StorageType deserialize_storage_type(const std::string& storage_str);
+    std::string serialize_index_method(IndexMethod method);
+    IndexMethod deserialize_index_method(const std::string& method_str);
     std::string serialize_column(const Column& column);
     Column deserialize_column(const std::string& column_str);
+    std::string serialize_index(const std::string& table_name, const IndexDefinition& index);
+    void deserialize_index(const std::string& index_str);
     
 public:
     explicit MetadataManager(const std::string& data_dir = "data");
@@ -32,9 +45,16 @@ public:
     
     // Table management
     bool table_exists(const std::string& table_name) const;
-    void create_table(const std::string& table_name, const std::vector<Column>& columns);
+    void create_table(const std::string& table_name, const std::vector<Column>& columns,
+                      StorageType storage = StorageType::ROW);
     void drop_table(const std::string& table_name);
     
+    // Index management; index names are unique across all tables
+    void validate_new_index(const std::string& table_name, const IndexDefinition& index) const;
+    void create_index(const std::string& table_name, const IndexDefinition& index);
+    void drop_index(const std::string& index_name);
+    std::string get_index_table(const std::string& index_name) const;
+    
     // Schema access
     const TableSchema* get_table_schema(const std::string& table_name) const;
     std::vector<std::string> get_table_names() const;
@@ -44,14 +64,27 @@ public:
     std::vector<Column> get_columns(const std::string& table_name) const;
     int get_column_index(const std::string& table_name, const std::string& column_name) const;
     
+    // Compiled row format
+    uint64_t get_schema_version(const std::string& table_name) const;
+    std::shared_ptr<const RowCodec> get_row_codec(const std::string& table_name) const;
+    
     // Validation
     void validate_table_name(const std::string& table_name) const;
     void validate_insert_values(const std::string& table_name, const std::vector<Value>& values) const;
     void validate_where_condition(const std::string& table_name, const WhereCondition& condition) const;
+    void validate_where_clause(const std::string& table_name, const WhereExpression& expression) const;
     
     // Data directory
     std::string get_data_directory() const { return data_directory; }
     std::string get_table_file_path(const std::string& table_name) const;
+    std::string get_column_segment_path(const std::string& table_name, const std::string& column_name) const;
+    std::string get_column_manifest_path(const std::string& table_name) const;
+    std::string get_lsm_manifest_path(const std::string& table_name) const;
+    std::string get_lsm_run_path(const std::string& table_name, uint64_t run_number) const;
+    std::string get_zone_map_path(const std::string& table_name) const;
+    std::string get_bloom_filter_path(const std::string& table_name) const;
+    std::string get_primary_index_path(const std::string& table_name) const;
+    std::string get_index_path(const std::string& index_name) const;
 };
 
 } // namespace sqldb
@@ -0,0 +1,124 @@
+#include "page.h"
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace sqldb {
+
+namespace {
+
+constexpr size_t HEADER_MAGIC_OFFSET = 0;
+constexpr size_t HEADER_VERSION_OFFSET = 8;
+constexpr size_t HEADER_PAGE_SIZE_OFFSET = 12;
+
+constexpr size_t LSN_OFFSET = 0;
+constexpr size_t SLOT_COUNT_OFFSET = 8;
+constexpr size_t FREE_END_OFFSET = 10;
+
+uint16_t load_u16(const char* data, size_t offset) {
+    uint16_t value;
+    std::memcpy(&value, data + offset, sizeof(value));
+    return value;
+}
+
+void store_u16(char* data, size_t offset, uint16_t value) {
+    std::memcpy(data + offset, &value, sizeof(value));
+}
+
+uint32_t load_u32(const char* data, size_t offset) {
+    uint32_t value;
+    std::memcpy(&value, data + offset, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+void FileHeaderPage::init(char* data) {
+    std::memset(data, 0, PAGE_SIZE);
+    std::memcpy(data + HEADER_MAGIC_OFFSET, TABLE_FILE_MAGIC, sizeof(TABLE_FILE_MAGIC));
+
+    uint32_t version = TABLE_FILE_VERSION;
+    uint32_t page_size = static_cast<uint32_t>(PAGE_SIZE);
+    std::memcpy(data + HEADER_VERSION_OFFSET, &version, sizeof(version));
+    std::memcpy(data + HEADER_PAGE_SIZE_OFFSET, &page_size, sizeof(page_size));
+}
+
+bool FileHeaderPage::is_valid(const char* data) {
+    if (std::memcmp(data + HEADER_MAGIC_OFFSET, TABLE_FILE_MAGIC, sizeof(TABLE_FILE_MAGIC)) != 0) {
+        return false;
+    }
+    return load_u32(data, HEADER_VERSION_OFFSET) == TABLE_FILE_VERSION &&
+           load_u32(data, HEADER_PAGE_SIZE_OFFSET) == PAGE_SIZE;
+}
+
+void SlottedPage::init(char* page_data) {
+    std::memset(page_data, 0, PAGE_SIZE);
+    store_u16(page_data, FREE_END_OFFSET, static_cast<uint16_t>(PAGE_SIZE));
+}
+
+uint64_t SlottedPage::get_lsn() const {
+    uint64_t lsn;
+    std::memcpy(&lsn, data + LSN_OFFSET, sizeof(lsn));
+    return lsn;
+}
+
+void SlottedPage::set_lsn(uint64_t lsn) {
+    std::memcpy(data + LSN_OFFSET, &lsn, sizeof(lsn));
+}
+
+uint16_t SlottedPage::slot_count() const {
+    return load_u16(data, SLOT_COUNT_OFFSET);
+}
+
+size_t SlottedPage::free_space() const {
+    size_t directory_end = HEADER_SIZE + slot_count() * SLOT_SIZE;
+    size_t free_end = load_u16(data, FREE_END_OFFSET);
+    return free_end > directory_end ? free_end - directory_end : 0;
+}
+
+bool SlottedPage::can_insert(size_t record_size) const {
+    return record_size + SLOT_SIZE <= free_space();
+}
+
+uint16_t SlottedPage::insert_record(const char* record, size_t record_size) {
+    if (!can_insert(record_size)) {
+        throw std::runtime_error("Not enough space in page for record");
+    }
+
+    uint16_t slot = slot_count();
+    size_t free_end = load_u16(data, FREE_END_OFFSET);
+    size_t record_offset = free_end - record_size;
+    std::memcpy(data + record_offset, record, record_size);
+
+    size_t slot_offset = HEADER_SIZE + slot * SLOT_SIZE;
+    store_u16(data, slot_offset, static_cast<uint16_t>(record_offset));
+    store_u16(data, slot_offset + 2, static_cast<uint16_t>(record_size));
+
+    store_u16(data, FREE_END_OFFSET, static_cast<uint16_t>(record_offset));
+    store_u16(data, SLOT_COUNT_OFFSET, static_cast<uint16_t>(slot + 1));
+    return slot;
+}
+
+std::string_view SlottedPage::get_record(uint16_t slot) const {
+    return ConstSlottedPage(data).get_record(slot);
+}
+
+uint16_t ConstSlottedPage::slot_count() const {
+    return load_u16(data, SLOT_COUNT_OFFSET);
+}
+
+std::string_view ConstSlottedPage::get_record(uint16_t slot) const {
+    if (slot >= slot_count()) {
+        throw std::runtime_error("Invalid slot number: " + std::to_string(slot));
+    }
+
+    size_t slot_offset = SlottedPage::HEADER_SIZE + slot * SlottedPage::SLOT_SIZE;
+    uint16_t offset = load_u16(data, slot_offset);
+    uint16_t length = load_u16(data, slot_offset + 2);
+    if (static_cast<size_t>(offset) + length > PAGE_SIZE) {
+        throw std::runtime_error("Corrupt slot directory entry");
+    }
+    return std::string_view(data + offset, length);
+}
+
+} // namespace sqldb
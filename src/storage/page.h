@@ -0,0 +1,70 @@
+#ifndef PAGE_H
+#define PAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace sqldb {
+
+// Table files are a sequence of fixed-size pages. Page 0 is the file header,
+// every following page is a slotted data page.
+constexpr size_t PAGE_SIZE = 4096;
+constexpr uint32_t TABLE_FILE_VERSION = 1;
+constexpr char TABLE_FILE_MAGIC[8] = {'S', 'Q', 'L', 'M', 'T', 'B', 'L', '1'};
+
+// File header page (page 0)
+class FileHeaderPage {
+public:
+    static void init(char* data);
+    static bool is_valid(const char* data);
+};
+
+// Slotted data page layout:
+//   [0..8)    page LSN
+//   [8..10)   slot count
+//   [10..12)  start of the record area (records grow down from the page end)
+//   [12..16)  reserved
+//   [16..)    slot directory, one {offset, length} pair per record
+class SlottedPage {
+private:
+    char* data;
+
+public:
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr size_t SLOT_SIZE = 4;
+
+    // Largest record that fits in an empty page
+    static constexpr size_t MAX_RECORD_SIZE = PAGE_SIZE - HEADER_SIZE - SLOT_SIZE;
+
+    explicit SlottedPage(char* page_data) : data(page_data) {}
+
+    static void init(char* page_data);
+
+    uint64_t get_lsn() const;
+    void set_lsn(uint64_t lsn);
+
+    uint16_t slot_count() const;
+    size_t free_space() const;
+    bool can_insert(size_t record_size) const;
+
+    // Returns the slot number of the new record
+    uint16_t insert_record(const char* record, size_t record_size);
+    std::string_view get_record(uint16_t slot) const;
+};
+
+// Read-only view over a page that is not owned by a buffer (e.g. a mapping)
+class ConstSlottedPage {
+private:
+    const char* data;
+
+public:
+    explicit ConstSlottedPage(const char* page_data) : data(page_data) {}
+
+    uint16_t slot_count() const;
+    std::string_view get_record(uint16_t slot) const;
+};
+
+} // namespace sqldb
+
+#endif // PAGE_H
@@ -0,0 +1,141 @@
+#include "roaring_bitmap.h"
+#include <algorithm>
+#include <iterator>
+
+namespace sqldb {
+
+namespace {
+
+constexpr size_t BITMAP_WORDS = 65536 / 64;
+
+} // namespace
+
+void RoaringBitmap::Container::add(uint16_t low) {
+    if (is_bitmap()) {
+        uint64_t& word = bits[low / 64];
+        uint64_t mask = uint64_t(1) << (low % 64);
+        if (!(word & mask)) {
+            word |= mask;
+            cardinality++;
+        }
+        return;
+    }
+
+    // Rows are mostly added in increasing order
+    if (values.empty() || values.back() < low) {
+        values.push_back(low);
+    } else {
+        auto it = std::lower_bound(values.begin(), values.end(), low);
+        if (*it == low) {
+            return;
+        }
+        values.insert(it, low);
+    }
+    cardinality++;
+    if (cardinality > ARRAY_LIMIT) {
+        convert_to_bitmap();
+    }
+}
+
+void RoaringBitmap::Container::convert_to_bitmap() {
+    bits.assign(BITMAP_WORDS, 0);
+    for (uint16_t low : values) {
+        bits[low / 64] |= uint64_t(1) << (low % 64);
+    }
+    values.clear();
+    values.shrink_to_fit();
+}
+
+void RoaringBitmap::Container::union_with(const Container& other) {
+    if (!is_bitmap() && !other.is_bitmap()) {
+        std::vector<uint16_t> merged;
+        merged.reserve(values.size() + other.values.size());
+        std::set_union(values.begin(), values.end(), other.values.begin(), other.values.end(),
+                       std::back_inserter(merged));
+        values.swap(merged);
+        cardinality = static_cast<uint32_t>(values.size());
+        if (cardinality > ARRAY_LIMIT) {
+            convert_to_bitmap();
+        }
+        return;
+    }
+
+    if (!is_bitmap()) {
+        convert_to_bitmap();
+    }
+    if (other.is_bitmap()) {
+        for (size_t i = 0; i < BITMAP_WORDS; i++) {
+            bits[i] |= other.bits[i];
+        }
+    } else {
+        for (uint16_t low : other.values) {
+            bits[low / 64] |= uint64_t(1) << (low % 64);
+        }
+    }
+    cardinality = 0;
+    for (uint64_t word : bits) {
+        cardinality += static_cast<uint32_t>(__builtin_popcountll(word));
+    }
+}
+
+RoaringBitmap::Container& RoaringBitmap::container_for(uint16_t high) {
+    if (!containers.empty() && containers.back().high == high) {
+        return containers.back();
+    }
+    auto it = std::lower_bound(containers.begin(), containers.end(), high,
+                               [](const Container& container, uint16_t h) { return container.high < h; });
+    if (it == containers.end() || it->high != high) {
+        it = containers.insert(it, Container{high, 0, {}, {}});
+    }
+    return *it;
+}
+
+void RoaringBitmap::add(uint32_t value) {
+    container_for(static_cast<uint16_t>(value >> 16)).add(static_cast<uint16_t>(value & 0xFFFF));
+}
+
+void RoaringBitmap::union_with(const RoaringBitmap& other) {
+    for (const Container& container : other.containers) {
+        container_for(container.high).union_with(container);
+    }
+}
+
+size_t RoaringBitmap::cardinality() const {
+    size_t count = 0;
+    for (const Container& container : containers) {
+        count += container.cardinality;
+    }
+    return count;
+}
+
+bool RoaringBitmap::Reader::next(uint32_t& value) {
+    while (container < bitmap->containers.size()) {
+        const Container& current = bitmap->containers[container];
+        uint32_t high = static_cast<uint32_t>(current.high) << 16;
+
+        if (!current.is_bitmap()) {
+            if (position < current.values.size()) {
+                value = high | current.values[position++];
+                return true;
+            }
+        } else {
+            // Skip to the next set bit, a word at a time
+            while (position < 65536) {
+                uint64_t word = current.bits[position / 64] >> (position % 64);
+                if (word == 0) {
+                    position = (position / 64 + 1) * 64;
+                    continue;
+                }
+                position += static_cast<size_t>(__builtin_ctzll(word));
+                value = high | static_cast<uint32_t>(position++);
+                return true;
+            }
+        }
+
+        container++;
+        position = 0;
+    }
+    return false;
+}
+
+} // namespace sqldb
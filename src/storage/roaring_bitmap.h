@@ -0,0 +1,60 @@
+#ifndef ROARING_BITMAP_H
+#define ROARING_BITMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sqldb {
+
+// Compressed set of 32-bit integers in the style of Roaring bitmaps. Values
+// are split by their high 16 bits into containers; a container holds its
+// low halves as a sorted array while it has at most ARRAY_LIMIT of them and
+// as a 65536-bit bitmap beyond that, so sparse and dense stretches both stay
+// small and set operations work a container at a time.
+class RoaringBitmap {
+public:
+    static constexpr size_t ARRAY_LIMIT = 4096;
+
+private:
+    struct Container {
+        uint16_t high;
+        uint32_t cardinality;
+        std::vector<uint16_t> values;  // Sorted low halves, while sparse
+        std::vector<uint64_t> bits;    // 1024 words, once dense
+
+        bool is_bitmap() const { return !bits.empty(); }
+        void add(uint16_t low);
+        void convert_to_bitmap();
+        void union_with(const Container& other);
+    };
+
+    std::vector<Container> containers;  // Sorted by high
+
+    Container& container_for(uint16_t high);
+
+public:
+    // Walks the values in increasing order
+    class Reader {
+    private:
+        const RoaringBitmap* bitmap;
+        size_t container;
+        size_t position;   // Array index, or bit number in a bitmap container
+
+    public:
+        explicit Reader(const RoaringBitmap* bitmap) : bitmap(bitmap), container(0), position(0) {}
+
+        // Returns false once every value has been read
+        bool next(uint32_t& value);
+    };
+
+    void add(uint32_t value);
+    void union_with(const RoaringBitmap& other);
+
+    size_t cardinality() const;
+    bool empty() const { return containers.empty(); }
+};
+
+} // namespace sqldb
+
+#endif // ROARING_BITMAP_H
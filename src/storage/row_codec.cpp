@@ -0,0 +1,362 @@
+#include "row_codec.h"
+#include "column_batch.h"
+#include "../common/compare.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace sqldb {
+
+namespace {
+
+void encode_integer(const Value& value, std::string& out) {
+    int32_t int_value = std::get<int>(value);
+    out.append(reinterpret_cast<const char*>(&int_value), sizeof(int_value));
+}
+
+void encode_varchar(const Value& value, std::string& out) {
+    const std::string& str = std::get<std::string>(value);
+    if (str.size() > UINT16_MAX) {
+        throw std::runtime_error("VARCHAR value too long to store");
+    }
+    uint16_t length = static_cast<uint16_t>(str.size());
+    out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.append(str);
+}
+
+void encode_boolean(const Value& value, std::string& out) {
+    out.push_back(std::get<bool>(value) ? 1 : 0);
+}
+
+Value decode_integer(const char*& pos, const char* end) {
+    if (end - pos < static_cast<std::ptrdiff_t>(sizeof(int32_t))) {
+        throw std::runtime_error("Truncated INTEGER value in record");
+    }
+    int32_t int_value;
+    std::memcpy(&int_value, pos, sizeof(int_value));
+    pos += sizeof(int_value);
+    return Value(static_cast<int>(int_value));
+}
+
+uint16_t read_varchar_length(const char*& pos, const char* end) {
+    if (end - pos < static_cast<std::ptrdiff_t>(sizeof(uint16_t))) {
+        throw std::runtime_error("Truncated VARCHAR length in record");
+    }
+    uint16_t length;
+    std::memcpy(&length, pos, sizeof(length));
+    pos += sizeof(length);
+    if (end - pos < length) {
+        throw std::runtime_error("Truncated VARCHAR value in record");
+    }
+    return length;
+}
+
+Value decode_varchar(const char*& pos, const char* end) {
+    uint16_t length = read_varchar_length(pos, end);
+    std::string str(pos, length);
+    pos += length;
+    return Value(std::move(str));
+}
+
+Value decode_boolean(const char*& pos, const char* end) {
+    if (pos >= end) {
+        throw std::runtime_error("Truncated BOOLEAN value in record");
+    }
+    bool bool_value = (*pos != 0);
+    pos++;
+    return Value(bool_value);
+}
+
+size_t fixed_width(DataType type) {
+    switch (type) {
+        case DataType::INTEGER: return sizeof(int32_t);
+        case DataType::BOOLEAN: return 1;
+        default: return 0;
+    }
+}
+
+} // namespace
+
+RowCodec::RowCodec(const TableSchema& schema, uint64_t schema_version)
+    : columns(schema.columns), schema_version(schema_version), shape(Shape::FIXED_WIDTH),
+      fixed_prefix_size(0), first_variable_column(-1), fixed_record_size(0) {
+    for (size_t i = 0; i < columns.size(); i++) {
+        const Column& column = columns[i];
+        column_ordinals[column.name] = static_cast<int>(i);
+
+        switch (column.type) {
+            case DataType::INTEGER:
+                encoders.push_back(encode_integer);
+                decoders.push_back(decode_integer);
+                break;
+            case DataType::VARCHAR:
+                encoders.push_back(encode_varchar);
+                decoders.push_back(decode_varchar);
+                break;
+            case DataType::BOOLEAN:
+                encoders.push_back(encode_boolean);
+                decoders.push_back(decode_boolean);
+                break;
+        }
+
+        if (first_variable_column < 0 && column.type != DataType::VARCHAR) {
+            fixed_offsets.push_back(static_cast<int>(fixed_prefix_size));
+            fixed_prefix_size += fixed_width(column.type);
+        } else {
+            if (first_variable_column < 0) {
+                first_variable_column = static_cast<int>(i);
+            }
+            fixed_offsets.push_back(-1);
+        }
+    }
+
+    if (first_variable_column < 0) {
+        fixed_record_size = fixed_prefix_size;
+    } else {
+        shape = Shape::VARIABLE_WIDTH;
+    }
+}
+
+void RowCodec::encode(const Row& row, std::string& out) const {
+    if (row.size() != columns.size()) {
+        throw std::runtime_error("Row size doesn't match table schema");
+    }
+
+    for (size_t i = 0; i < row.size(); i++) {
+        encoders[i](row[i], out);
+    }
+}
+
+std::string RowCodec::encode(const Row& row) const {
+    std::string record;
+    record.reserve(fixed_prefix_size);
+    encode(row, record);
+    return record;
+}
+
+Row RowCodec::decode(std::string_view record) const {
+    if (shape == Shape::FIXED_WIDTH) {
+        return decode_fixed_width(record);
+    }
+    return decode_variable_width(record);
+}
+
+Row RowCodec::decode_fixed_width(std::string_view record) const {
+    // One size check up front replaces the per-field bounds checks
+    if (record.size() != fixed_record_size) {
+        throw std::runtime_error("Row data doesn't match table schema");
+    }
+
+    Row row;
+    row.reserve(columns.size());
+    const char* base = record.data();
+    for (size_t i = 0; i < columns.size(); i++) {
+        const char* pos = base + fixed_offsets[i];
+        if (columns[i].type == DataType::INTEGER) {
+            int32_t int_value;
+            std::memcpy(&int_value, pos, sizeof(int_value));
+            row.emplace_back(static_cast<int>(int_value));
+        } else {
+            row.emplace_back(*pos != 0);
+        }
+    }
+    return row;
+}
+
+Row RowCodec::decode_variable_width(std::string_view record) const {
+    const char* pos = record.data();
+    const char* end = record.data() + record.size();
+
+    Row row;
+    row.reserve(columns.size());
+    for (DecodeFn decode_field : decoders) {
+        row.push_back(decode_field(pos, end));
+    }
+
+    if (pos != end) {
+        throw std::runtime_error("Row data doesn't match table schema");
+    }
+    return row;
+}
+
+std::string_view RowCodec::locate_field(std::string_view record, int column_index) const {
+    if (column_index < 0 || column_index >= static_cast<int>(columns.size())) {
+        throw std::runtime_error("Column index out of range");
+    }
+
+    const char* end = record.data() + record.size();
+    int offset = fixed_offsets[column_index];
+    if (offset >= 0) {
+        size_t width = fixed_width(columns[column_index].type);
+        if (static_cast<size_t>(offset) + width > record.size()) {
+            throw std::runtime_error("Row data doesn't match table schema");
+        }
+        return std::string_view(record.data() + offset, width);
+    }
+
+    // Walk the variable-width tail, skipping fields without decoding them
+    const char* pos = record.data() + fixed_prefix_size;
+    for (int i = first_variable_column; i < column_index; i++) {
+        if (columns[i].type == DataType::VARCHAR) {
+            pos += read_varchar_length(pos, end);
+        } else {
+            pos += fixed_width(columns[i].type);
+        }
+        if (pos > end) {
+            throw std::runtime_error("Row data doesn't match table schema");
+        }
+    }
+
+    if (columns[column_index].type == DataType::VARCHAR) {
+        const char* start = pos;
+        pos += read_varchar_length(pos, end);
+        return std::string_view(start, pos - start);
+    }
+
+    size_t width = fixed_width(columns[column_index].type);
+    if (pos + width > end) {
+        throw std::runtime_error("Row data doesn't match table schema");
+    }
+    return std::string_view(pos, width);
+}
+
+bool RowCodec::matches(std::string_view record, const BoundCondition& condition) const {
+    std::string_view field = locate_field(record, condition.column_index);
+
+    switch (condition.type) {
+        case DataType::INTEGER: {
+            int32_t value;
+            std::memcpy(&value, field.data(), sizeof(value));
+            return compare_ordered(static_cast<int>(value), std::get<int>(condition.value),
+                                   condition.operator_type);
+        }
+        case DataType::VARCHAR:
+            return compare_ordered(field.substr(sizeof(uint16_t)),
+                                   std::string_view(std::get<std::string>(condition.value)),
+                                   condition.operator_type);
+        case DataType::BOOLEAN:
+            return compare_ordered(field[0] != 0, std::get<bool>(condition.value), condition.operator_type);
+    }
+
+    return false;
+}
+
+void RowCodec::decode_field(std::string_view record, int column_index, ColumnVector& out) const {
+    std::string_view field = locate_field(record, column_index);
+
+    switch (columns[column_index].type) {
+        case DataType::INTEGER: {
+            int32_t value;
+            std::memcpy(&value, field.data(), sizeof(value));
+            out.append_integer(value);
+            break;
+        }
+        case DataType::VARCHAR:
+            out.append_varchar(field.substr(sizeof(uint16_t)));
+            break;
+        case DataType::BOOLEAN:
+            out.append_boolean(field[0] != 0);
+            break;
+    }
+}
+
+void RowCodec::decode_into(std::string_view record, ColumnBatch& batch) const {
+    const char* pos = record.data();
+    const char* end = record.data() + record.size();
+
+    // Check the layout first, so a bad record leaves the vectors the same length
+    if (shape == Shape::FIXED_WIDTH) {
+        if (record.size() != fixed_record_size) {
+            throw std::runtime_error("Row data doesn't match table schema");
+        }
+    } else {
+        if (record.size() < fixed_prefix_size) {
+            throw std::runtime_error("Row data doesn't match table schema");
+        }
+        const char* check = pos + fixed_prefix_size;
+        for (size_t i = static_cast<size_t>(first_variable_column); i < columns.size(); i++) {
+            if (columns[i].type == DataType::VARCHAR) {
+                check += read_varchar_length(check, end);
+            } else {
+                check += fixed_width(columns[i].type);
+            }
+            if (check > end) {
+                throw std::runtime_error("Row data doesn't match table schema");
+            }
+        }
+        if (check != end) {
+            throw std::runtime_error("Row data doesn't match table schema");
+        }
+    }
+
+    for (size_t i = 0; i < columns.size(); i++) {
+        bool loaded = batch.is_loaded(i);
+        switch (columns[i].type) {
+            case DataType::INTEGER:
+                if (loaded) {
+                    int32_t value;
+                    std::memcpy(&value, pos, sizeof(value));
+                    batch.column(i).append_integer(value);
+                }
+                pos += sizeof(int32_t);
+                break;
+            case DataType::VARCHAR: {
+                uint16_t length;
+                std::memcpy(&length, pos, sizeof(length));
+                pos += sizeof(length);
+                if (loaded) {
+                    batch.column(i).append_varchar(std::string_view(pos, length));
+                }
+                pos += length;
+                break;
+            }
+            case DataType::BOOLEAN:
+                if (loaded) {
+                    batch.column(i).append_boolean(*pos != 0);
+                }
+                pos++;
+                break;
+        }
+    }
+}
+
+BoundCondition RowCodec::bind(const WhereCondition& condition) const {
+    int column_index = get_column_index(condition.column_name);
+    if (column_index < 0) {
+        throw std::runtime_error("Column '" + condition.column_name + "' does not exist");
+    }
+
+    BoundCondition bound{column_index, columns[column_index].type, condition.operator_type, condition.value};
+    if (bound.operator_type == TokenType::LIKE) {
+        if (bound.type != DataType::VARCHAR || !std::holds_alternative<std::string>(bound.value)) {
+            throw std::runtime_error("LIKE needs a VARCHAR column, '" + condition.column_name + "' is not one");
+        }
+        // A pattern without wildcards is a plain equality, which every
+        // index, zone and Bloom filter understands
+        const std::string& pattern = std::get<std::string>(bound.value);
+        if (pattern.find_first_of("%_") == std::string::npos) {
+            bound.operator_type = TokenType::EQUALS;
+        }
+    }
+    return bound;
+}
+
+bool row_matches(const Row& row, const BoundCondition& condition) {
+    const Value& value = row[condition.column_index];
+    switch (condition.type) {
+        case DataType::INTEGER:
+            return compare_ordered(std::get<int>(value), std::get<int>(condition.value), condition.operator_type);
+        case DataType::VARCHAR:
+            return compare_ordered(std::string_view(std::get<std::string>(value)),
+                                   std::string_view(std::get<std::string>(condition.value)), condition.operator_type);
+        case DataType::BOOLEAN:
+            return compare_ordered(std::get<bool>(value), std::get<bool>(condition.value), condition.operator_type);
+    }
+    return false;
+}
+
+int RowCodec::get_column_index(const std::string& column_name) const {
+    auto it = column_ordinals.find(column_name);
+    return (it != column_ordinals.end()) ? it->second : -1;
+}
+
+} // namespace sqldb
@@ -0,0 +1,93 @@
+#ifndef ROW_CODEC_H
+#define ROW_CODEC_H
+
+#include "../common/types.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sqldb {
+
+class ColumnVector;
+class ColumnBatch;
+
+// WHERE condition resolved against a schema: the column is an ordinal and the
+// type is known, so evaluating it needs no name lookups
+struct BoundCondition {
+    int column_index;
+    DataType type;
+    TokenType operator_type;
+    Value value;
+};
+
+// Evaluates a condition against a decoded row
+bool row_matches(const Row& row, const BoundCondition& condition);
+
+// Encoder/decoder for the binary record format of one table schema. Built once
+// per schema version; all per-column decisions are made at construction time.
+//
+// Record layout: columns in schema order, INTEGER as raw int32, VARCHAR as a
+// u16 length followed by the bytes, BOOLEAN as one byte.
+class RowCodec {
+public:
+    // Schemas without VARCHAR columns have a fixed record size and every field
+    // sits at a constant offset
+    enum class Shape {
+        FIXED_WIDTH,
+        VARIABLE_WIDTH
+    };
+
+private:
+    using EncodeFn = void (*)(const Value& value, std::string& out);
+    using DecodeFn = Value (*)(const char*& pos, const char* end);
+
+    std::vector<Column> columns;
+    std::unordered_map<std::string, int> column_ordinals;
+    uint64_t schema_version;
+    Shape shape;
+
+    // Type dispatch tables, one entry per column
+    std::vector<EncodeFn> encoders;
+    std::vector<DecodeFn> decoders;
+
+    // Offset of each column that precedes the first VARCHAR, -1 after it
+    std::vector<int> fixed_offsets;
+    size_t fixed_prefix_size;
+    int first_variable_column;
+    size_t fixed_record_size;
+
+    Row decode_fixed_width(std::string_view record) const;
+    Row decode_variable_width(std::string_view record) const;
+
+public:
+    RowCodec(const TableSchema& schema, uint64_t schema_version);
+
+    // Encoding
+    void encode(const Row& row, std::string& out) const;
+    std::string encode(const Row& row) const;
+    Row decode(std::string_view record) const;
+
+    // Field access without decoding the whole record
+    std::string_view locate_field(std::string_view record, int column_index) const;
+    bool matches(std::string_view record, const BoundCondition& condition) const;
+
+    // Vectorized decoding: appends one field to a column vector, or every
+    // column the batch loads to its vectors. A malformed record throws
+    // before anything is appended.
+    void decode_field(std::string_view record, int column_index, ColumnVector& out) const;
+    void decode_into(std::string_view record, ColumnBatch& batch) const;
+
+    // Schema information
+    BoundCondition bind(const WhereCondition& condition) const;
+    int get_column_index(const std::string& column_name) const;
+    const std::vector<Column>& get_columns() const { return columns; }
+    size_t column_count() const { return columns.size(); }
+    uint64_t get_schema_version() const { return schema_version; }
+    Shape get_shape() const { return shape; }
+};
+
+} // namespace sqldb
+
+#endif // ROW_CODEC_H
@@ -1,4 +1,7 @@
 #include "table.h"
+#include "page.h"
+#include "../common/compare.h"
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
@@ -7,64 +10,391 @@
 
 namespace sqldb {
 
-TableStorage::TableStorage(const std::string& table_name, MetadataManager* metadata_mgr) 
-    : table_name(table_name), metadata_manager(metadata_mgr) {
+TableStorage::TableStorage(const std::string& table_name, MetadataManager* metadata_mgr, BufferPool* buffer_pool,
+                           WriteAheadLog* wal) 
+    : table_name(table_name), metadata_manager(metadata_mgr), buffer_pool(buffer_pool), wal(wal), file_id(0),
+      scan_mode(ScanMode::BUFFERED), scan_threads(1) {
     if (!metadata_mgr) {
         throw std::runtime_error("MetadataManager cannot be null");
     }
+    if (!buffer_pool) {
+        throw std::runtime_error("BufferPool cannot be null");
+    }
+    if (!wal) {
+        throw std::runtime_error("WriteAheadLog cannot be null");
+    }
     
     file_path = metadata_manager->get_table_file_path(table_name);
     ensure_table_file();
+    file_id = buffer_pool->register_file(file_path);
+    open_page_summaries();
+    open_indexes();
 }
 
-void TableStorage::ensure_table_file() {
-    // Create file if it doesn't exist
-    std::ifstream test(file_path);
-    if (!test.is_open()) {
-        std::ofstream create_file(file_path);
-        if (!create_file.is_open()) {
-            throw std::runtime_error("Cannot create table file: " + file_path);
+void TableStorage::open_page_summaries() {
+    const std::vector<Column>& columns = get_codec().get_columns();
+    if (ZoneMap::supports(columns)) {
+        zone_map = std::make_unique<ZoneMap>(buffer_pool, metadata_manager->get_zone_map_path(table_name), columns);
+    }
+    if (BloomFilters::wanted(columns)) {
+        bloom_filters = std::make_unique<BloomFilters>(buffer_pool, metadata_manager->get_bloom_filter_path(table_name),
+                                                       columns);
+    }
+    
+    bool fill_zones = zone_map && zone_map->needs_rebuild();
+    bool fill_filters = bloom_filters && bloom_filters->needs_rebuild();
+    if (!fill_zones && !fill_filters) {
+        return;
+    }
+    
+    // Tables written before a sidecar existed, or whose sidecar was lost,
+    // are summarized once
+    const RowCodec& row_codec = get_codec();
+    uint32_t page_count = buffer_pool->get_page_count(file_id);
+    for (uint32_t page_no = 1; page_no < page_count; page_no++) {
+        PageGuard guard(buffer_pool, file_id, page_no);
+        ConstSlottedPage page(guard.get_data());
+        for (uint16_t slot = 0; slot < page.slot_count(); slot++) {
+            try {
+                Row row = row_codec.decode(page.get_record(slot));
+                if (fill_zones) {
+                    zone_map->extend(page_no, row);
+                }
+                if (fill_filters) {
+                    bloom_filters->add(page_no, row);
+                }
+            } catch (const std::exception& e) {
+                // Malformed rows are skipped by scans as well
+                continue;
+            }
         }
-        create_file << "# Table data for " << table_name << "\n";
     }
 }
 
-std::string TableStorage::serialize_value(const Value& value, DataType type) {
-    std::ostringstream oss;
+void TableStorage::open_indexes() {
+    // The tail of a column table is emptied on every seal and keeps no index
+    const TableSchema* schema = metadata_manager->get_table_schema(table_name);
+    if (!schema || schema->storage != StorageType::ROW) {
+        return;
+    }
     
-    switch (type) {
-        case DataType::INTEGER:
-            oss << std::get<int>(value);
+    for (const Column& column : get_codec().get_columns()) {
+        if (column.is_primary_key) {
+            indexes.push_back(open_index(IndexDefinition("", column.name, true)));
             break;
-        case DataType::VARCHAR: {
-            const std::string& str = std::get<std::string>(value);
-            // Escape special characters
-            std::string escaped;
-            for (char c : str) {
-                if (c == '|' || c == '\\' || c == '\n' || c == '\r') {
-                    escaped += '\\';
-                    switch (c) {
-                        case '|': escaped += '|'; break;
-                        case '\\': escaped += '\\'; break;
-                        case '\n': escaped += 'n'; break;
-                        case '\r': escaped += 'r'; break;
-                    }
-                } else {
-                    escaped += c;
+        }
+    }
+    for (const IndexDefinition& definition : schema->indexes) {
+        indexes.push_back(open_index(definition));
+    }
+    
+    // Memory-only indexes, and index files found missing or unfinished, are
+    // filled in one pass over the table
+    std::vector<TableIndex*> stale;
+    for (TableIndex& index : indexes) {
+        if (index.structure->needs_rebuild()) {
+            stale.push_back(&index);
+        }
+    }
+    if (!stale.empty()) {
+        build_indexes(stale);
+    }
+}
+
+TableStorage::TableIndex TableStorage::open_index(const IndexDefinition& definition) {
+    const RowCodec& row_codec = get_codec();
+    TableIndex index;
+    index.name = definition.name;
+    index.column_index = row_codec.get_column_index(definition.column_name);
+    index.is_unique = definition.is_unique;
+    index.tree = nullptr;
+    if (index.column_index < 0) {
+        throw std::runtime_error("Index '" + definition.name + "' refers to unknown column '" +
+                                 definition.column_name + "'");
+    }
+    
+    // INCLUDE values are stored in the row format of just those columns
+    if (!definition.include_columns.empty()) {
+        TableSchema included_schema(table_name);
+        for (const std::string& column_name : definition.include_columns) {
+            int column_index = row_codec.get_column_index(column_name);
+            if (column_index < 0) {
+                throw std::runtime_error("Index '" + definition.name + "' refers to unknown column '" +
+                                         column_name + "'");
+            }
+            index.include_columns.push_back(column_index);
+            included_schema.columns.push_back(row_codec.get_columns()[column_index]);
+        }
+        index.included_codec = std::make_shared<const RowCodec>(included_schema, row_codec.get_schema_version());
+    }
+    
+    DataType key_type = row_codec.get_columns()[index.column_index].type;
+    if (definition.method == IndexMethod::HASH) {
+        index.structure = std::make_unique<HashIndex>(key_type);
+    } else if (definition.method == IndexMethod::BITMAP) {
+        index.structure = std::make_unique<BitmapIndex>(key_type);
+    } else if (definition.method == IndexMethod::ART) {
+        index.structure = std::make_unique<ArtIndex>();
+    } else {
+        std::string path = definition.name.empty() ? metadata_manager->get_primary_index_path(table_name)
+                                                   : metadata_manager->get_index_path(definition.name);
+        auto tree = std::make_unique<BPlusTree>(buffer_pool, path, key_type);
+        index.tree = tree.get();
+        index.structure = std::move(tree);
+    }
+    return index;
+}
+
+std::string TableStorage::encode_included(const TableIndex& index, const Row& row) {
+    if (!index.included_codec) {
+        return std::string();
+    }
+    Row included;
+    included.reserve(index.include_columns.size());
+    for (int column_index : index.include_columns) {
+        included.push_back(row[column_index]);
+    }
+    return index.included_codec->encode(included);
+}
+
+void TableStorage::add_index_entry(TableIndex& index, const Row& row, RowId row_id, uint64_t lsn) {
+    const Value& key = row[index.column_index];
+    if (index.included_codec) {
+        index.tree->insert_entry(key, encode_included(index, row), row_id, lsn);
+    } else {
+        index.structure->insert(key, row_id, lsn);
+    }
+}
+
+void TableStorage::build_indexes(const std::vector<TableIndex*>& targets) {
+    for (TableIndex* index : targets) {
+        index->structure->clear();
+    }
+    
+    // B+trees are sorted and packed bottom-up rather than filled by inserts
+    std::vector<std::unique_ptr<BTreeBuilder>> builders;
+    for (TableIndex* index : targets) {
+        builders.push_back(index->tree ? std::make_unique<BTreeBuilder>(index->tree) : nullptr);
+    }
+    
+    const RowCodec& row_codec = get_codec();
+    uint32_t page_count = buffer_pool->get_page_count(file_id);
+    for (uint32_t page_no = 1; page_no < page_count; page_no++) {
+        PageGuard guard(buffer_pool, file_id, page_no);
+        ConstSlottedPage page(guard.get_data());
+        for (uint16_t slot = 0; slot < page.slot_count(); slot++) {
+            Row row;
+            try {
+                row = row_codec.decode(page.get_record(slot));
+            } catch (const std::exception& e) {
+                // Malformed rows are skipped by scans as well
+                continue;
+            }
+            
+            for (size_t i = 0; i < targets.size(); i++) {
+                TableIndex* index = targets[i];
+                const Value& key = row[index->column_index];
+                if (builders[i]) {
+                    builders[i]->add(key, encode_included(*index, row), RowId{page_no, slot});
+                    continue;
+                }
+                // Rows written before the primary key was enforced may repeat
+                // it; only a new UNIQUE index refuses existing duplicates
+                if (index->is_unique && !index->name.empty()) {
+                    check_unique(*index, key);
                 }
+                add_index_entry(*index, row, RowId{page_no, slot}, 0);
             }
-            oss << escaped;
-            break;
         }
-        case DataType::BOOLEAN:
-            oss << (std::get<bool>(value) ? "1" : "0");
-            break;
     }
     
-    return oss.str();
+    for (size_t i = 0; i < targets.size(); i++) {
+        TableIndex* index = targets[i];
+        if (builders[i] && !builders[i]->finish(index->is_unique && !index->name.empty())) {
+            throw_duplicate(*index);
+        }
+        index->structure->finish_build();
+    }
+}
+
+void TableStorage::check_unique(const TableIndex& index, const Value& key) {
+    if (index.structure->contains(key)) {
+        throw_duplicate(index);
+    }
+}
+
+void TableStorage::throw_duplicate(const TableIndex& index) {
+    const std::string& column_name = get_codec().get_columns()[index.column_index].name;
+    if (index.name.empty()) {
+        throw std::runtime_error("Duplicate value for primary key column '" + column_name + "'");
+    }
+    throw std::runtime_error("Duplicate value for unique index '" + index.name + "' on column '" +
+                             column_name + "'");
+}
+
+void TableStorage::rebuild_indexes() {
+    std::vector<TableIndex*> targets;
+    for (TableIndex& index : indexes) {
+        targets.push_back(&index);
+    }
+    if (!targets.empty()) {
+        build_indexes(targets);
+    }
+}
+
+void TableStorage::create_index(const IndexDefinition& definition) {
+    TableIndex index = open_index(definition);
+    try {
+        build_indexes({&index});
+    } catch (const std::exception& e) {
+        index.structure->delete_file();
+        throw;
+    }
+    indexes.push_back(std::move(index));
+}
+
+void TableStorage::drop_index(const std::string& index_name) {
+    for (auto it = indexes.begin(); it != indexes.end(); ++it) {
+        if (!it->name.empty() && it->name == index_name) {
+            it->structure->delete_file();
+            indexes.erase(it);
+            return;
+        }
+    }
+    throw std::runtime_error("Index '" + index_name + "' does not exist");
+}
+
+void TableStorage::ensure_table_file() {
+    if (!std::filesystem::exists(file_path)) {
+        write_empty_table_file();
+        return;
+    }
+    
+    // Files written before the page format are converted once, in place
+    if (is_legacy_file()) {
+        migrate_legacy_file();
+    }
+}
+
+void TableStorage::write_empty_table_file() {
+    std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot create table file: " + file_path);
+    }
+    
+    char header[PAGE_SIZE];
+    FileHeaderPage::init(header);
+    file.write(header, PAGE_SIZE);
+    if (!file) {
+        throw std::runtime_error("Cannot write table file header: " + file_path);
+    }
+}
+
+const RowCodec& TableStorage::get_codec() {
+    return *get_shared_codec();
+}
+
+std::shared_ptr<const RowCodec> TableStorage::get_shared_codec() {
+    if (!codec || codec->get_schema_version() != metadata_manager->get_schema_version(table_name)) {
+        codec = metadata_manager->get_row_codec(table_name);
+    }
+    return codec;
+}
+
+bool TableStorage::is_legacy_file() {
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open table file for reading: " + file_path);
+    }
+    
+    char header[PAGE_SIZE] = {};
+    file.read(header, PAGE_SIZE);
+    if (file.gcount() == static_cast<std::streamsize>(PAGE_SIZE) && FileHeaderPage::is_valid(header)) {
+        return false;
+    }
+    if (file.gcount() >= static_cast<std::streamsize>(sizeof(TABLE_FILE_MAGIC)) &&
+        std::memcmp(header, TABLE_FILE_MAGIC, sizeof(TABLE_FILE_MAGIC)) == 0) {
+        throw std::runtime_error("Unsupported table file version: " + file_path);
+    }
+    return true;
+}
+
+void TableStorage::migrate_legacy_file() {
+    std::ifstream legacy(file_path);
+    if (!legacy.is_open()) {
+        throw std::runtime_error("Cannot open table file for reading: " + file_path);
+    }
+    
+    // Write the converted file next to the original and swap it in once complete
+    std::string migrated_path = file_path + ".migrating";
+    std::ofstream migrated(migrated_path, std::ios::binary | std::ios::trunc);
+    if (!migrated.is_open()) {
+        throw std::runtime_error("Cannot create table file: " + migrated_path);
+    }
+    
+    char buffer[PAGE_SIZE];
+    FileHeaderPage::init(buffer);
+    migrated.write(buffer, PAGE_SIZE);
+    
+    SlottedPage::init(buffer);
+    SlottedPage page(buffer);
+    const RowCodec& row_codec = get_codec();
+    
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(legacy, line)) {
+        line_number++;
+        if (line.empty() || line[0] == '#') {
+            continue; // Skip empty lines and comments
+        }
+        
+        std::string record;
+        try {
+            record = row_codec.encode(deserialize_legacy_row(line, row_codec));
+        } catch (const std::exception& e) {
+            // Malformed rows were never visible to queries, drop them
+            continue;
+        }
+        if (record.size() > SlottedPage::MAX_RECORD_SIZE) {
+            // The row was readable before; leave the old file as it is
+            // rather than convert the table without it
+            migrated.close();
+            std::error_code ec;
+            std::filesystem::remove(migrated_path, ec);
+            throw std::runtime_error("Cannot convert table '" + table_name + "': the row on line " +
+                                     std::to_string(line_number) + " of " + file_path + " takes " +
+                                     std::to_string(record.size()) + " bytes, more than the " +
+                                     std::to_string(SlottedPage::MAX_RECORD_SIZE) + " a page holds");
+        }
+        
+        if (!page.can_insert(record.size())) {
+            migrated.write(buffer, PAGE_SIZE);
+            SlottedPage::init(buffer);
+        }
+        page.insert_record(record.data(), record.size());
+    }
+    
+    if (page.slot_count() > 0) {
+        migrated.write(buffer, PAGE_SIZE);
+    }
+    
+    migrated.close();
+    legacy.close();
+    
+    std::error_code ec;
+    if (!migrated) {
+        std::filesystem::remove(migrated_path, ec);
+        throw std::runtime_error("Cannot write table file: " + migrated_path);
+    }
+    
+    std::filesystem::rename(migrated_path, file_path, ec);
+    if (ec) {
+        std::filesystem::remove(migrated_path, ec);
+        throw std::runtime_error("Cannot replace legacy table file: " + file_path);
+    }
 }
 
-Value TableStorage::deserialize_value(const std::string& value_str, DataType type) {
+Value TableStorage::deserialize_legacy_value(const std::string& value_str, DataType type) {
     switch (type) {
         case DataType::INTEGER:
             return Value(std::stoi(value_str));
@@ -95,25 +425,8 @@ Value TableStorage::deserialize_value(const std::string& value_str, DataType typ
     }
 }
 
-std::string TableStorage::serialize_row(const Row& row) {
-    const std::vector<Column> columns = metadata_manager->get_columns(table_name);
-    if (row.size() != columns.size()) {
-        throw std::runtime_error("Row size doesn't match table schema");
-    }
-    
-    std::ostringstream oss;
-    for (size_t i = 0; i < row.size(); i++) {
-        if (i > 0) {
-            oss << "|";
-        }
-        oss << serialize_value(row[i], columns[i].type);
-    }
-    
-    return oss.str();
-}
-
-Row TableStorage::deserialize_row(const std::string& row_str) {
-    const std::vector<Column> columns = metadata_manager->get_columns(table_name);
+Row TableStorage::deserialize_legacy_row(const std::string& row_str, const RowCodec& row_codec) {
+    const std::vector<Column>& columns = row_codec.get_columns();
     
     std::vector<std::string> value_strings;
     std::string current_value;
@@ -145,7 +458,7 @@ Row TableStorage::deserialize_row(const std::string& row_str) {
     
     Row row;
     for (size_t i = 0; i < value_strings.size(); i++) {
-        row.push_back(deserialize_value(value_strings[i], columns[i].type));
+        row.push_back(deserialize_legacy_value(value_strings[i], columns[i].type));
     }
     
     return row;
@@ -154,107 +467,653 @@ Row TableStorage::deserialize_row(const std::string& row_str) {
 void TableStorage::insert_row(const std::vector<Value>& values) {
     // Validate the insert
     metadata_manager->validate_insert_values(table_name, values);
+    append_row(values);
+}
+
+uint64_t TableStorage::append_row(const std::vector<Value>& values) {
+    // Serialize the row
+    std::string record = get_codec().encode(values);
+    if (record.size() > SlottedPage::MAX_RECORD_SIZE) {
+        throw std::runtime_error("Row too large: " + std::to_string(record.size()) +
+                                 " bytes, page capacity is " + std::to_string(SlottedPage::MAX_RECORD_SIZE));
+    }
+    
+    // Reject duplicate or oversized keys before anything is logged
+    for (const TableIndex& index : indexes) {
+        if (index.included_codec) {
+            index.tree->check_entry(values[index.column_index], encode_included(index, values));
+        } else {
+            index.structure->check_key(values[index.column_index]);
+        }
+        if (index.is_unique) {
+            check_unique(index, values[index.column_index]);
+        }
+    }
     
-    // Serialize and write to file
-    std::string row_data = serialize_row(values);
+    // Place the record in the last page, or a fresh one when it is full
+    std::unique_ptr<PageGuard> target;
+    uint32_t page_count = buffer_pool->get_page_count(file_id);
+    if (page_count > 1) {
+        target = std::make_unique<PageGuard>(buffer_pool, file_id, page_count - 1);
+        if (!SlottedPage(target->get_data()).can_insert(record.size())) {
+            target.reset();
+        }
+    }
+    if (!target) {
+        target = std::make_unique<PageGuard>(buffer_pool, file_id);
+        SlottedPage::init(target->get_data());
+    }
     
-    std::ofstream file(file_path, std::ios::app);
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot open table file for writing: " + file_path);
+    // Log first; the page itself reaches the table file lazily, on eviction
+    // or checkpoint
+    uint64_t lsn = wal->append(WalRecordType::INSERT, table_name, target->get_page_no(), record);
+    SlottedPage page(target->get_data());
+    uint16_t slot = page.insert_record(record.data(), record.size());
+    page.set_lsn(lsn);
+    target->mark_dirty(lsn);
+    if (zone_map) {
+        zone_map->extend(target->get_page_no(), values);
+    }
+    if (bloom_filters) {
+        bloom_filters->add(target->get_page_no(), values);
+    }
+    for (TableIndex& index : indexes) {
+        add_index_entry(index, values, RowId{target->get_page_no(), slot}, lsn);
     }
+    target.reset();
     
-    file << row_data << "\n";
-    file.close();
+    wal->commit(lsn);
+    return lsn;
 }
 
-std::vector<Row> TableStorage::select_all() {
-    std::vector<Row> rows;
+bool TableStorage::redo_insert(uint32_t page_no, const std::string& record, uint64_t lsn) {
+    if (page_no == 0) {
+        throw std::runtime_error("Log record targets the table file header");
+    }
     
-    std::ifstream file(file_path);
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot open table file for reading: " + file_path);
+    // Pages allocated after the last write-back may be missing from the file
+    while (buffer_pool->get_page_count(file_id) <= page_no) {
+        PageGuard new_page(buffer_pool, file_id);
+        SlottedPage::init(new_page.get_data());
     }
     
-    std::string line;
-    while (std::getline(file, line)) {
-        if (line.empty() || line[0] == '#') {
-            continue; // Skip empty lines and comments
+    // Zones and Bloom filters are not logged, so they are updated even when
+    // the page already holds the record; indexes are rebuilt after the
+    // replay instead
+    if (zone_map || bloom_filters) {
+        Row row = get_codec().decode(record);
+        if (zone_map) {
+            zone_map->extend(page_no, row);
         }
-        
-        try {
-            Row row = deserialize_row(line);
-            rows.push_back(row);
-        } catch (const std::exception& e) {
-            // Skip malformed rows, log error if needed
-            continue;
+        if (bloom_filters) {
+            bloom_filters->add(page_no, row);
         }
     }
     
+    PageGuard guard(buffer_pool, file_id, page_no);
+    SlottedPage page(guard.get_data());
+    if (page.get_lsn() >= lsn) {
+        return false;
+    }
+    if (page.get_lsn() == 0 && page.slot_count() == 0) {
+        SlottedPage::init(guard.get_data());
+    }
+    
+    page.insert_record(record.data(), record.size());
+    page.set_lsn(lsn);
+    guard.mark_dirty(lsn);
+    return true;
+}
+
+Row TableStorage::fetch_row(RowId row_id) {
+    if (row_id.page_no == 0 || row_id.page_no >= buffer_pool->get_page_count(file_id)) {
+        throw std::runtime_error("Row id points outside table '" + table_name + "'");
+    }
+    
+    PageGuard guard(buffer_pool, file_id, row_id.page_no);
+    ConstSlottedPage page(guard.get_data());
+    if (row_id.slot >= page.slot_count()) {
+        throw std::runtime_error("Row id points outside table '" + table_name + "'");
+    }
+    return get_codec().decode(page.get_record(row_id.slot));
+}
+
+std::vector<Row> TableStorage::select_all() {
+    std::vector<Row> rows;
+    std::unique_ptr<TableCursor> cursor = open_cursor();
+    
+    Row row;
+    while (cursor->next(row)) {
+        rows.push_back(std::move(row));
+    }
     return rows;
 }
 
 std::vector<Row> TableStorage::select_where(const WhereCondition& condition) {
+    std::vector<Row> rows;
+    std::unique_ptr<TableCursor> cursor = open_cursor(&condition);
+    
+    Row row;
+    while (cursor->next(row)) {
+        rows.push_back(std::move(row));
+    }
+    return rows;
+}
+
+std::unique_ptr<TableCursor> TableStorage::open_cursor(const WhereCondition* condition,
+                                                       const std::vector<int>* columns) {
     // Validate the WHERE condition
-    metadata_manager->validate_where_condition(table_name, condition);
+    if (condition) {
+        metadata_manager->validate_where_condition(table_name, *condition);
+    }
     
-    std::vector<Row> all_rows = select_all();
-    std::vector<Row> filtered_rows;
+    // Conditions on an indexed column read only the matching part of the
+    // index, and an index holding every column needed can stand in for the table
+    if ((condition || columns) && !indexes.empty()) {
+        BoundCondition bound = condition ? get_codec().bind(*condition) : BoundCondition{};
+        std::unique_ptr<TableCursor> index_scan = open_index_scan(condition ? &bound : nullptr, columns);
+        if (index_scan) {
+            return index_scan;
+        }
+    }
     
-    for (const Row& row : all_rows) {
-        if (evaluate_condition(row, condition)) {
-            filtered_rows.push_back(row);
+    // The mapping only sees what has reached the file
+    if (scan_mode == ScanMode::MMAP) {
+        buffer_pool->flush_file(file_id);
+    }
+    
+    // Tables of more than one morsel are split between worker threads
+    uint32_t page_count = buffer_pool->get_page_count(file_id);
+    size_t morsel_count = (page_count + MORSEL_PAGES - 2) / MORSEL_PAGES;
+    size_t workers = std::min(scan_threads, morsel_count);
+    if (workers > 1) {
+        std::vector<std::unique_ptr<TableScanCursor>> scanners;
+        for (size_t i = 0; i < workers; i++) {
+            scanners.push_back(std::make_unique<TableScanCursor>(buffer_pool, file_id, file_path, get_shared_codec(),
+                                                                 condition, scan_mode, zone_map.get(),
+                                                                 bloom_filters.get()));
         }
+        return std::make_unique<ParallelScanCursor>(get_shared_codec(), std::move(scanners), page_count);
     }
     
-    return filtered_rows;
+    return std::make_unique<TableScanCursor>(buffer_pool, file_id, file_path, get_shared_codec(),
+                                             condition, scan_mode, zone_map.get(), bloom_filters.get());
+}
+
+TableScanCursor::TableScanCursor(BufferPool* buffer_pool, uint32_t file_id, const std::string& file_path,
+                                 std::shared_ptr<const RowCodec> codec, const WhereCondition* condition,
+                                 ScanMode mode, ZoneMap* zone_map, BloomFilters* bloom_filters)
+    : buffer_pool(buffer_pool), file_id(file_id), codec(std::move(codec)), has_condition(condition != nullptr),
+      condition{}, zone_map(zone_map), bloom_filters(bloom_filters), page_no(1), end_page(UINT32_MAX), slot(0),
+      page_data(nullptr) {
+    if (has_condition) {
+        this->condition = this->codec->bind(*condition);
+    }
+    if (mode == ScanMode::MMAP) {
+        mapping = std::make_unique<MappedFile>(file_path);
+    }
 }
 
-bool TableStorage::evaluate_condition(const Row& row, const WhereCondition& condition) {
-    int column_index = metadata_manager->get_column_index(table_name, condition.column_name);
-    if (column_index < 0 || column_index >= static_cast<int>(row.size())) {
+bool TableScanCursor::load_page() {
+    if (has_condition && (zone_map || bloom_filters)) {
+        // A Bloom filter rules out a whole segment at once, a zone one page
+        uint32_t page_count = std::min(buffer_pool->get_page_count(file_id), end_page);
+        while (page_no < page_count) {
+            if (bloom_filters && !bloom_filters->may_match(page_no, condition)) {
+                page_no = BloomFilters::segment_end(page_no);
+            } else if (zone_map && !zone_map->may_match(page_no, condition)) {
+                page_no++;
+            } else {
+                break;
+            }
+        }
+    }
+    
+    if (page_no >= end_page) {
         return false;
     }
     
-    const Value& row_value = row[column_index];
-    return compare_values(row_value, condition.value, condition.operator_type);
+    if (mapping) {
+        // Pick up pages appended since the file was mapped
+        size_t page_end = static_cast<size_t>(page_no + 1) * PAGE_SIZE;
+        if (page_end > mapping->size() && (!mapping->refresh() || page_end > mapping->size())) {
+            return false;
+        }
+        page_data = mapping->get_data() + static_cast<size_t>(page_no) * PAGE_SIZE;
+        return true;
+    }
+    
+    if (page_no >= buffer_pool->get_page_count(file_id)) {
+        return false;
+    }
+    current_page = std::make_unique<PageGuard>(buffer_pool, file_id, page_no);
+    page_data = current_page->get_data();
+    return true;
+}
+
+void TableScanCursor::release_page() {
+    current_page.reset();
+    page_data = nullptr;
+    page_no++;
+    slot = 0;
+}
+
+void TableScanCursor::set_range(uint32_t first_page, uint32_t end_page) {
+    release_page();
+    page_no = first_page;
+    this->end_page = end_page;
+}
+
+bool TableScanCursor::next(Row& row) {
+    while (true) {
+        if (!page_data && !load_page()) {
+            return false;
+        }
+        
+        ConstSlottedPage page(page_data);
+        while (slot < page.slot_count()) {
+            try {
+                std::string_view record = page.get_record(slot++);
+                if (has_condition && !codec->matches(record, condition)) {
+                    continue;
+                }
+                // Only emitted rows are copied out of the page
+                row = codec->decode(record);
+                return true;
+            } catch (const std::exception& e) {
+                // Skip malformed rows, log error if needed
+                continue;
+            }
+        }
+        
+        release_page();
+    }
+}
+
+size_t TableScanCursor::next_columns(ColumnBatch& batch, size_t max_rows) {
+    batch.clear();
+    size_t produced = 0;
+    while (produced < max_rows) {
+        if (!page_data && !load_page()) {
+            break;
+        }
+        
+        // The page stays pinned until its records are decoded
+        ConstSlottedPage page(page_data);
+        records.clear();
+        if (has_condition) {
+            predicate.reset(condition.type);
+        }
+        while (slot < page.slot_count() && records.size() < max_rows - produced) {
+            try {
+                std::string_view record = page.get_record(slot++);
+                if (has_condition) {
+                    codec->decode_field(record, condition.column_index, predicate);
+                }
+                records.push_back(record);
+            } catch (const std::exception& e) {
+                // Skip malformed rows
+                continue;
+            }
+        }
+        
+        // The predicate runs over the whole column, then only the rows that
+        // pass are decoded
+        matches.resize(records.size());
+        for (size_t i = 0; i < records.size(); i++) {
+            matches[i] = static_cast<uint32_t>(i);
+        }
+        if (has_condition) {
+            filter_column(predicate, condition, matches);
+        }
+        for (uint32_t position : matches) {
+            try {
+                codec->decode_into(records[position], batch);
+                produced++;
+            } catch (const std::exception& e) {
+                continue;
+            }
+        }
+        
+        if (slot >= page.slot_count()) {
+            release_page();
+        }
+    }
+    batch.set_row_count(produced);
+    return produced;
+}
+
+ParallelScanCursor::ParallelScanCursor(std::shared_ptr<const RowCodec> codec,
+                                       std::vector<std::unique_ptr<TableScanCursor>> scanners, uint32_t page_count)
+    : codec(std::move(codec)), scanners(std::move(scanners)), next_morsel(0), reading(0),
+      stopping(false), batch_index(0), row_offset(0), row_position(0) {
+    // Page 0 is the header, so morsels start at page 1
+    morsel_count = (page_count + MORSEL_PAGES - 2) / MORSEL_PAGES;
+}
+
+ParallelScanCursor::~ParallelScanCursor() {
+    // Workers give up the morsel in hand at the next batch
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    morsel_taken.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
 }
 
-bool TableStorage::compare_values(const Value& left, const Value& right, TokenType op) {
-    // Type compatibility should already be validated
+void ParallelScanCursor::start(const ColumnBatch& batch) {
+    layout = batch;
+    for (const std::unique_ptr<TableScanCursor>& scanner : scanners) {
+        workers.emplace_back(&ParallelScanCursor::worker_loop, this, scanner.get());
+    }
+}
+
+void ParallelScanCursor::worker_loop(TableScanCursor* scanner) {
+    size_t workers = scanners.size();
+    while (true) {
+        size_t morsel_index;
+        {
+            // Claim the next morsel unless the reader is too far behind
+            std::unique_lock<std::mutex> lock(mutex);
+            morsel_taken.wait(lock, [&] {
+                size_t window = std::min(workers + reading, workers * MORSELS_AHEAD_PER_WORKER);
+                return stopping || next_morsel < reading + window;
+            });
+            if (stopping || next_morsel >= morsel_count) {
+                return;
+            }
+            morsel_index = next_morsel++;
+        }
+        
+        Morsel morsel;
+        try {
+            uint32_t first_page = 1 + static_cast<uint32_t>(morsel_index) * MORSEL_PAGES;
+            scanner->set_range(first_page, first_page + MORSEL_PAGES);
+            while (!stopping) {
+                ColumnBatch batch = layout;
+                if (scanner->next_columns(batch, MORSEL_BATCH_ROWS) == 0) {
+                    break;
+                }
+                morsel.batches.push_back(std::move(batch));
+            }
+        } catch (const std::exception& e) {
+            morsel.batches.clear();
+            morsel.error = e.what();
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished[morsel_index] = std::move(morsel);
+        }
+        morsel_done.notify_all();
+    }
+}
+
+size_t ParallelScanCursor::next_columns(ColumnBatch& batch, size_t max_rows) {
+    if (workers.empty()) {
+        start(batch);
+    }
     
-    try {
-        switch (op) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (reading < morsel_count) {
+        morsel_done.wait(lock, [&] { return finished.count(reading) > 0; });
+        Morsel& morsel = finished[reading];
+        if (!morsel.error.empty()) {
+            throw std::runtime_error(morsel.error);
+        }
+        
+        if (batch_index < morsel.batches.size()) {
+            // Hand the batch over whole, or in slices when the caller wants
+            // fewer rows than the workers put in one, as under a LIMIT
+            ColumnBatch& source = morsel.batches[batch_index];
+            size_t count = std::min(source.size() - row_offset, max_rows);
+            if (row_offset == 0 && count == source.size()) {
+                batch = std::move(source);
+                batch_index++;
+            } else {
+                batch = source;
+                std::vector<uint32_t>& selection = batch.get_selection();
+                selection.erase(selection.begin(), selection.begin() + row_offset);
+                selection.resize(count);
+                row_offset += count;
+                if (row_offset == source.size()) {
+                    batch_index++;
+                    row_offset = 0;
+                }
+            }
+            return count;
+        }
+        
+        // Morsel used up, let the workers claim further ahead
+        finished.erase(reading);
+        reading++;
+        batch_index = 0;
+        row_offset = 0;
+        morsel_taken.notify_all();
+    }
+    
+    batch.clear();
+    return 0;
+}
+
+bool ParallelScanCursor::next(Row& row) {
+    constexpr size_t ROW_BATCH_ROWS = 1024;
+    while (row_position >= row_batch.size()) {
+        if (row_batch.column_count() == 0) {
+            row_batch.reset(codec->get_columns(), nullptr);
+        }
+        if (next_columns(row_batch, ROW_BATCH_ROWS) == 0) {
+            return false;
+        }
+        row_position = 0;
+    }
+    
+    uint32_t position = row_batch.get_selection()[row_position++];
+    row.clear();
+    row.reserve(row_batch.column_count());
+    for (size_t i = 0; i < row_batch.column_count(); i++) {
+        row.push_back(row_batch.column(i).value_at(position));
+    }
+    return true;
+}
+
+bool TableStorage::index_covers(const TableIndex& index, const BoundCondition* condition,
+                                const std::vector<int>& columns) {
+    if (!index.tree) {
+        return false;
+    }
+    auto holds = [&index](int column) {
+        return column == index.column_index ||
+               std::find(index.include_columns.begin(), index.include_columns.end(), column) !=
+                   index.include_columns.end();
+    };
+    if (condition && !holds(condition->column_index)) {
+        return false;
+    }
+    return std::all_of(columns.begin(), columns.end(), holds);
+}
+
+std::unique_ptr<TableCursor> TableStorage::open_index_scan(const BoundCondition* condition,
+                                                           const std::vector<int>* columns) {
+    // Not-equal matches nearly everything, a lookup cannot narrow it
+    TokenType op = condition ? condition->operator_type : TokenType::NOT_EQUALS;
+    bool equality = op == TokenType::EQUALS;
+    bool like = op == TokenType::LIKE;
+    bool searchable = condition && op != TokenType::NOT_EQUALS;
+    
+    // Patterns that start with a wildcard have no prefix to look up
+    std::string prefix;
+    if (like) {
+        prefix = std::string(like_prefix(std::get<std::string>(condition->value)));
+        searchable = !prefix.empty();
+    }
+    
+    // An index that narrows the condition comes first, then one holding every
+    // column needed; unique indexes beat non-unique ones, the primary key
+    // first among them; equality prefers a hash index to a B+tree, ranges
+    // need an ordered one and LIKE one that can find a prefix
+    const TableIndex* best = nullptr;
+    bool best_searches = false;
+    bool best_covers = false;
+    int best_rank = -1;
+    for (const TableIndex& index : indexes) {
+        const KeyIndex& structure = *index.structure;
+        bool usable = equality || (like ? structure.supports_prefix() : structure.is_ordered());
+        bool searches = searchable && usable && index.column_index == condition->column_index;
+        bool covers = columns && index_covers(index, condition, *columns);
+        if (!searches && !covers) {
+            continue;
+        }
+        int rank = (searches ? 8 : 0) + (covers ? 4 : 0) + (index.is_unique ? 2 : 0) + (structure.is_ordered() ? 0 : 1);
+        if (rank > best_rank) {
+            best = &index;
+            best_searches = searches;
+            best_covers = covers;
+            best_rank = rank;
+        }
+    }
+    if (!best) {
+        return nullptr;
+    }
+    
+    // Only 'prefix%' is answered exactly by its lookup, and reading a whole
+    // covering index answers nothing by itself
+    bool exact = best_searches && (!like || like_is_prefix_only(std::get<std::string>(condition->value)));
+    const BoundCondition* filter = (condition && !exact) ? condition : nullptr;
+    if (best_covers) {
+        return open_index_only_scan(*best, best_searches ? condition : nullptr, prefix, filter);
+    }
+    
+    KeyIndex* structure = best->structure.get();
+    const Value* key = &condition->value;
+    switch (op) {
+        case TokenType::EQUALS:
+            return std::make_unique<IndexScanCursor>(this, structure->open_equal(*key));
+        case TokenType::LESS_THAN:
+            return std::make_unique<IndexScanCursor>(this, structure->open_range(nullptr, true, key, false));
+        case TokenType::LESS_EQUAL:
+            return std::make_unique<IndexScanCursor>(this, structure->open_range(nullptr, true, key, true));
+        case TokenType::GREATER_THAN:
+            return std::make_unique<IndexScanCursor>(this, structure->open_range(key, false, nullptr, true));
+        case TokenType::GREATER_EQUAL:
+            return std::make_unique<IndexScanCursor>(this, structure->open_range(key, true, nullptr, true));
+        case TokenType::LIKE:
+            return std::make_unique<IndexScanCursor>(this, structure->open_prefix(prefix), filter);
+        default:
+            return nullptr;
+    }
+}
+
+std::unique_ptr<TableCursor> TableStorage::open_index_only_scan(const TableIndex& index,
+                                                                const BoundCondition* search,
+                                                                const std::string& prefix,
+                                                                const BoundCondition* filter) {
+    // Bounds of the searched condition; without one the whole index is read
+    const Value* lower = nullptr;
+    const Value* upper = nullptr;
+    bool lower_inclusive = true;
+    bool upper_inclusive = true;
+    Value prefix_start(prefix);
+    Value prefix_end;
+    if (search) {
+        const Value* key = &search->value;
+        switch (search->operator_type) {
             case TokenType::EQUALS:
-                return left == right;
-            case TokenType::NOT_EQUALS:
-                return left != right;
+                lower = key;
+                upper = key;
+                break;
             case TokenType::LESS_THAN:
-                return left < right;
-            case TokenType::GREATER_THAN:
-                return left > right;
+                upper = key;
+                upper_inclusive = false;
+                break;
             case TokenType::LESS_EQUAL:
-                return left <= right;
+                upper = key;
+                break;
+            case TokenType::GREATER_THAN:
+                lower = key;
+                lower_inclusive = false;
+                break;
             case TokenType::GREATER_EQUAL:
-                return left >= right;
+                lower = key;
+                break;
+            case TokenType::LIKE: {
+                lower = &prefix_start;
+                std::string successor;
+                if (prefix_successor(prefix, successor)) {
+                    prefix_end = successor;
+                    upper = &prefix_end;
+                    upper_inclusive = false;
+                }
+                break;
+            }
             default:
-                return false;
+                break;
         }
-    } catch (...) {
-        // Comparison failed (e.g., type mismatch)
-        return false;
     }
+    
+    return std::make_unique<IndexOnlyScanCursor>(index.tree->open_entries(lower, lower_inclusive, upper,
+                                                                          upper_inclusive),
+                                                 get_codec().column_count(), index.column_index,
+                                                 index.include_columns, index.included_codec, filter);
+}
+
+bool IndexScanCursor::next(Row& row) {
+    RowId row_id;
+    while (row_ids->next(row_id)) {
+        row = table->fetch_row(row_id);
+        if (!has_filter || row_matches(row, filter)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool IndexOnlyScanCursor::next(Row& row) {
+    RowId row_id;
+    while (entries->next(row_id)) {
+        row.assign(column_count, Value());
+        row[key_column] = entries->key();
+        if (included_codec) {
+            Row included = included_codec->decode(entries->included());
+            for (size_t i = 0; i < include_columns.size(); i++) {
+                row[include_columns[i]] = std::move(included[i]);
+            }
+        }
+        if (!has_filter || row_matches(row, filter)) {
+            return true;
+        }
+    }
+    return false;
 }
 
 size_t TableStorage::get_row_count() {
-    return select_all().size();
+    // Slot directories hold the counts, no record needs decoding
+    size_t count = 0;
+    uint32_t page_count = buffer_pool->get_page_count(file_id);
+    for (uint32_t page_no = 1; page_no < page_count; page_no++) {
+        PageGuard guard(buffer_pool, file_id, page_no);
+        count += SlottedPage(guard.get_data()).slot_count();
+    }
+    
+    return count;
 }
 
 void TableStorage::clear_table() {
-    std::ofstream file(file_path, std::ios::trunc);
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot clear table file: " + file_path);
+    buffer_pool->drop_file(file_path);
+    write_empty_table_file();
+    file_id = buffer_pool->register_file(file_path);
+    if (zone_map) {
+        zone_map->clear();
+    }
+    if (bloom_filters) {
+        bloom_filters->clear();
+    }
+    for (TableIndex& index : indexes) {
+        index.structure->clear();
+        index.structure->finish_build();
     }
-    file << "# Table data for " << table_name << "\n";
 }
 
 bool TableStorage::table_file_exists() const {
@@ -262,7 +1121,18 @@ bool TableStorage::table_file_exists() const {
     return file.is_open();
 }
 
-void TableStorage::delete_table_file() {
+void TableStorage::delete_table_files() {
+    buffer_pool->drop_file(file_path);
+    if (zone_map) {
+        zone_map->delete_file();
+    }
+    if (bloom_filters) {
+        bloom_filters->delete_file();
+    }
+    for (TableIndex& index : indexes) {
+        index.structure->delete_file();
+    }
+    
     std::error_code ec;
     std::filesystem::remove(file_path, ec);
     // Ignore errors if file doesn't exist
@@ -2,45 +2,282 @@
 #define TABLE_H
 
 #include "../common/types.h"
+#include "../common/config.h"
 #include "metadata.h"
+#include "buffer_pool.h"
+#include "wal.h"
+#include "mapped_file.h"
+#include "row_codec.h"
+#include "cursor.h"
+#include "table_engine.h"
+#include "zone_map.h"
+#include "bloom_filter.h"
+#include "btree.h"
+#include "hash_index.h"
+#include "bitmap_index.h"
+#include "art_index.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <fstream>
 
 namespace sqldb {
 
-class TableStorage {
+// Walks the slotted pages of a table file, either through the buffer pool
+// or through a private mapping of the file, and decodes only matching rows
+class TableScanCursor : public TableCursor {
+private:
+    BufferPool* buffer_pool;
+    uint32_t file_id;
+    std::shared_ptr<const RowCodec> codec;
+    bool has_condition;
+    BoundCondition condition;
+    
+    // Pages whose zone rules out the condition are never read
+    ZoneMap* zone_map;
+    BloomFilters* bloom_filters;
+    
+    // Mapped mode only
+    std::unique_ptr<MappedFile> mapping;
+    
+    // Position; the scan stops before end_page
+    uint32_t page_no;
+    uint32_t end_page;
+    uint16_t slot;
+    std::unique_ptr<PageGuard> current_page;
+    const char* page_data;
+    
+    // Vectorized scans: the records of the page in hand, the predicate
+    // column decoded from them and the positions that pass
+    std::vector<std::string_view> records;
+    ColumnVector predicate;
+    std::vector<uint32_t> matches;
+    
+    bool load_page();
+    void release_page();
+    
+public:
+    TableScanCursor(BufferPool* buffer_pool, uint32_t file_id, const std::string& file_path,
+                    std::shared_ptr<const RowCodec> codec, const WhereCondition* condition, ScanMode mode,
+                    ZoneMap* zone_map = nullptr, BloomFilters* bloom_filters = nullptr);
+    
+    bool next(Row& row) override;
+    size_t next_columns(ColumnBatch& batch, size_t max_rows) override;
+    
+    // Restarts the scan on pages [first_page, end_page)
+    void set_range(uint32_t first_page, uint32_t end_page);
+};
+
+// Pages per morsel of a parallel scan, and morsels each worker may finish
+// ahead of the reader once the scan is under way
+constexpr uint32_t MORSEL_PAGES = 128;
+constexpr size_t MORSELS_AHEAD_PER_WORKER = 4;
+
+// Rows per batch a worker produces, however few the reader asks for
+constexpr size_t MORSEL_BATCH_ROWS = 1024;
+
+// Morsel-driven parallel scan: the table is cut into morsels of MORSEL_PAGES
+// consecutive pages, which worker threads claim one at a time in page order.
+// Each worker scans and filters its morsel with its own TableScanCursor into
+// column batches. The reader hands the batches out morsel by morsel, so rows
+// come back in the same order as from a serial scan. Workers start one
+// morsel each ahead of the reader and get further ahead as it keeps up, so a
+// scan cut short by LIMIT reads little more than it returns.
+class ParallelScanCursor : public TableCursor {
+private:
+    struct Morsel {
+        std::vector<ColumnBatch> batches;
+        std::string error;
+    };
+    
+    std::shared_ptr<const RowCodec> codec;
+    std::vector<std::unique_ptr<TableScanCursor>> scanners;   // One per worker
+    size_t morsel_count;
+    
+    // Set by the first read, copied by the workers
+    ColumnBatch layout;
+    
+    std::mutex mutex;
+    std::condition_variable morsel_done;
+    std::condition_variable morsel_taken;
+    size_t next_morsel;                          // Next to be claimed by a worker
+    size_t reading;                              // Being handed out by the reader
+    std::unordered_map<size_t, Morsel> finished;
+    std::atomic<bool> stopping;                  // Also checked between batches
+    std::vector<std::thread> workers;
+    
+    // Reader position inside the morsel being handed out
+    size_t batch_index;
+    size_t row_offset;
+    
+    // Rows for next(Row&)
+    ColumnBatch row_batch;
+    size_t row_position;
+    
+    void start(const ColumnBatch& batch);
+    void worker_loop(TableScanCursor* scanner);
+    
+public:
+    ParallelScanCursor(std::shared_ptr<const RowCodec> codec, std::vector<std::unique_ptr<TableScanCursor>> scanners,
+                       uint32_t page_count);
+    ~ParallelScanCursor();
+    
+    ParallelScanCursor(const ParallelScanCursor&) = delete;
+    ParallelScanCursor& operator=(const ParallelScanCursor&) = delete;
+    
+    bool next(Row& row) override;
+    size_t next_columns(ColumnBatch& batch, size_t max_rows) override;
+};
+
+// Builds rows from the entries of a B+tree alone: the key column and the
+// INCLUDE columns are filled in, every other column is left unset
+class IndexOnlyScanCursor : public TableCursor {
+private:
+    std::unique_ptr<BTreeCursor> entries;
+    size_t column_count;
+    int key_column;
+    std::vector<int> include_columns;
+    std::shared_ptr<const RowCodec> included_codec;
+    
+    // Checked on every row when the entries read may not all match
+    bool has_filter;
+    BoundCondition filter;
+    
+public:
+    IndexOnlyScanCursor(std::unique_ptr<BTreeCursor> entries, size_t column_count, int key_column,
+                        std::vector<int> include_columns, std::shared_ptr<const RowCodec> included_codec,
+                        const BoundCondition* filter)
+        : entries(std::move(entries)), column_count(column_count), key_column(key_column),
+          include_columns(std::move(include_columns)), included_codec(std::move(included_codec)),
+          has_filter(filter != nullptr), filter(filter ? *filter : BoundCondition{}) {}
+    
+    bool next(Row& row) override;
+};
+
+class TableStorage;
+
+// Emits the rows an index range points at, in key order
+class IndexScanCursor : public TableCursor {
+private:
+    TableStorage* table;
+    std::unique_ptr<RowIdCursor> row_ids;
+    
+    // Checked on every fetched row when the lookup may return more than
+    // the condition matches, as for LIKE patterns beyond a plain prefix
+    bool has_filter;
+    BoundCondition filter;
+    
+public:
+    IndexScanCursor(TableStorage* table, std::unique_ptr<RowIdCursor> row_ids, const BoundCondition* filter = nullptr)
+        : table(table), row_ids(std::move(row_ids)), has_filter(filter != nullptr),
+          filter(filter ? *filter : BoundCondition{}) {}
+    
+    bool next(Row& row) override;
+};
+
+// Row store: rows packed into the slotted pages of a single .tbl file
+class TableStorage : public TableEngine {
 private:
     std::string table_name;
     std::string file_path;
     MetadataManager* metadata_manager;
+    BufferPool* buffer_pool;
+    WriteAheadLog* wal;
+    uint32_t file_id;
+    ScanMode scan_mode;
+    size_t scan_threads;
+    std::shared_ptr<const RowCodec> codec;
+    
+    // Per-page min/max summaries, absent for very wide tables
+    std::unique_ptr<ZoneMap> zone_map;
     
+    // Per-segment Bloom filters of the columns created WITH (bloom = ...)
+    std::unique_ptr<BloomFilters> bloom_filters;
+    
+    // Indexes of a row table: the PRIMARY KEY B+tree first, if there is
+    // one, then the CREATE INDEX indexes
+    struct TableIndex {
+        std::string name;         // Empty for the primary key
+        int column_index;
+        bool is_unique;
+        std::unique_ptr<KeyIndex> structure;
+        BPlusTree* tree;          // The structure when it is a B+tree, which can answer from its entries
+        std::vector<int> include_columns;
+        std::shared_ptr<const RowCodec> included_codec;  // Null without INCLUDE columns
+    };
+    std::vector<TableIndex> indexes;
+
     // File I/O helpers
     void ensure_table_file();
-    std::string serialize_value(const Value& value, DataType type);
-    Value deserialize_value(const std::string& value_str, DataType type);
-    std::string serialize_row(const Row& row);
-    Row deserialize_row(const std::string& row_str);
+    void write_empty_table_file();
+    void open_page_summaries();
+    void open_indexes();
+    TableIndex open_index(const IndexDefinition& definition);
+    static std::string encode_included(const TableIndex& index, const Row& row);
+    static void add_index_entry(TableIndex& index, const Row& row, RowId row_id, uint64_t lsn);
+    void build_indexes(const std::vector<TableIndex*>& targets);
+    void check_unique(const TableIndex& index, const Value& key);
+    [[noreturn]] void throw_duplicate(const TableIndex& index);
+    static bool index_covers(const TableIndex& index, const BoundCondition* condition, const std::vector<int>& columns);
+    std::unique_ptr<TableCursor> open_index_scan(const BoundCondition* condition, const std::vector<int>* columns);
+    std::unique_ptr<TableCursor> open_index_only_scan(const TableIndex& index, const BoundCondition* search,
+                                                      const std::string& prefix, const BoundCondition* filter);
+
+    // Row format, rebuilt when the table schema changes
+    const RowCodec& get_codec();
+    std::shared_ptr<const RowCodec> get_shared_codec();
+
+    // Legacy pipe-delimited text format, only read during migration
+    bool is_legacy_file();
+    void migrate_legacy_file();
+    Value deserialize_legacy_value(const std::string& value_str, DataType type);
+    Row deserialize_legacy_row(const std::string& row_str, const RowCodec& row_codec);
+
+public:
+    TableStorage(const std::string& table_name, MetadataManager* metadata_mgr, BufferPool* buffer_pool,
+                 WriteAheadLog* wal);
+
+    // Data operations
+    void insert_row(const std::vector<Value>& values) override;
     
-    // Query helpers
-    bool evaluate_condition(const Row& row, const WhereCondition& condition);
-    bool compare_values(const Value& left, const Value& right, TokenType op);
+    // insert_row for values the caller has already validated; returns the
+    // LSN of the committed insert
+    uint64_t append_row(const std::vector<Value>& values);
     
-public:
-    TableStorage(const std::string& table_name, MetadataManager* metadata_mgr);
+    // Recovery: re-applies a logged insert unless the page already has it
+    bool redo_insert(uint32_t page_no, const std::string& record, uint64_t lsn) override;
+    void rebuild_indexes() override;
+    void create_index(const IndexDefinition& index) override;
+    void drop_index(const std::string& index_name) override;
     
-    // Data operations
-    void insert_row(const std::vector<Value>& values);
+    Row fetch_row(RowId row_id);
     std::vector<Row> select_all();
     std::vector<Row> select_where(const WhereCondition& condition);
     
+    // Streaming scan, condition may be null; equality and range conditions on
+    // an indexed column are answered from the index, and a B+tree holding
+    // every requested column answers without reading the table
+    std::unique_ptr<TableCursor> open_cursor(const WhereCondition* condition = nullptr,
+                                             const std::vector<int>* columns = nullptr) override;
+
+    // Scan configuration
+    void set_scan_mode(ScanMode mode) override { scan_mode = mode; }
+    void set_scan_threads(size_t threads) override { scan_threads = threads; }
+
     // Utility
-    size_t get_row_count();
+    size_t get_row_count() override;
     void clear_table();
-    
+
     // File operations
     bool table_file_exists() const;
-    void delete_table_file();
+    const std::string& get_file_path() const { return file_path; }
+    void delete_table_files() override;
 };
 
 } // namespace sqldb
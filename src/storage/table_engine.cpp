@@ -0,0 +1,28 @@
+#include "table_engine.h"
+#include "metadata.h"
+#include "table.h"
+#include "column_storage.h"
+#include "lsm_storage.h"
+#include <stdexcept>
+
+namespace sqldb {
+
+std::unique_ptr<TableEngine> open_table_engine(const std::string& table_name, MetadataManager* metadata_mgr,
+                                               BufferPool* buffer_pool, WriteAheadLog* wal) {
+    const TableSchema* schema = metadata_mgr->get_table_schema(table_name);
+    if (!schema) {
+        throw std::runtime_error("Table '" + table_name + "' does not exist");
+    }
+
+    switch (schema->storage) {
+        case StorageType::ROW:
+            return std::make_unique<TableStorage>(table_name, metadata_mgr, buffer_pool, wal);
+        case StorageType::COLUMN:
+            return std::make_unique<ColumnStorage>(table_name, metadata_mgr, buffer_pool, wal);
+        case StorageType::LSM:
+            return std::make_unique<LsmStorage>(table_name, metadata_mgr, wal);
+    }
+    throw std::runtime_error("Unknown storage type for table '" + table_name + "'");
+}
+
+} // namespace sqldb
@@ -0,0 +1,65 @@
+#ifndef TABLE_ENGINE_H
+#define TABLE_ENGINE_H
+
+#include "../common/types.h"
+#include "../common/config.h"
+#include "cursor.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sqldb {
+
+class MetadataManager;
+class BufferPool;
+class WriteAheadLog;
+
+// Physical layout behind a table. The layout is chosen at CREATE TABLE time
+// and recorded in the table schema; the executor only talks to this interface.
+class TableEngine {
+public:
+    virtual ~TableEngine() = default;
+
+    // Data operations
+    virtual void insert_row(const std::vector<Value>& values) = 0;
+
+    // Recovery: re-applies a logged insert unless the page already has it;
+    // returns whether the record was applied
+    virtual bool redo_insert(uint32_t page_no, const std::string& record, uint64_t lsn) = 0;
+
+    // Recovery: indexes are not logged, so tables that had inserts replayed
+    // get theirs rebuilt from the rows once the log is applied
+    virtual void rebuild_indexes() = 0;
+    
+    // Secondary indexes; create builds the index from the existing rows and
+    // throws if they break a UNIQUE index
+    virtual void create_index(const IndexDefinition& index) = 0;
+    virtual void drop_index(const std::string& index_name) = 0;
+
+    // Streaming scan, condition may be null. columns, when given, lists the
+    // ordinals the caller reads; the engine may leave the others unset.
+    virtual std::unique_ptr<TableCursor> open_cursor(const WhereCondition* condition = nullptr,
+                                                     const std::vector<int>* columns = nullptr) = 0;
+
+    // Scan configuration
+    virtual void set_scan_mode(ScanMode mode) = 0;
+    
+    // Most worker threads one scan may use; 1 scans on the calling thread
+    virtual void set_scan_threads(size_t threads) = 0;
+
+    // Utility
+    virtual size_t get_row_count() = 0;
+
+    // Forgets cached pages and removes every file belonging to the table
+    virtual void delete_table_files() = 0;
+};
+
+// Opens the engine matching the table's storage type
+std::unique_ptr<TableEngine> open_table_engine(const std::string& table_name, MetadataManager* metadata_mgr,
+                                               BufferPool* buffer_pool, WriteAheadLog* wal);
+
+} // namespace sqldb
+
+#endif // TABLE_ENGINE_H
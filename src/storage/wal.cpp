@@ -0,0 +1,460 @@
+#include "wal.h"
+#include "buffer_pool.h"
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sqldb {
+
+namespace {
+
+constexpr char WAL_MAGIC[8] = {'S', 'Q', 'L', 'M', 'W', 'A', 'L', '1'};
+constexpr size_t WAL_HEADER_SIZE = 16;
+
+// Record framing: u32 body length, u32 CRC of the body, then the body
+constexpr size_t RECORD_FRAME_SIZE = 8;
+
+// Log size that triggers a checkpoint after a commit
+constexpr uint64_t CHECKPOINT_THRESHOLD = 64 * 1024 * 1024;
+
+// In OFF mode records are handed to the OS once this much is buffered
+constexpr size_t LAZY_WRITE_THRESHOLD = 1024 * 1024;
+
+struct Crc32Table {
+    uint32_t entries[256];
+
+    Crc32Table() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+    }
+};
+
+uint32_t crc32(const char* data, size_t length) {
+    static const Crc32Table table;
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; i++) {
+        crc = table.entries[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+template <typename T>
+void append_raw(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool read_raw(const char*& pos, const char* end, T& value) {
+    if (end - pos < static_cast<std::ptrdiff_t>(sizeof(T))) {
+        return false;
+    }
+    std::memcpy(&value, pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+void write_all(int fd, const char* data, size_t length, const std::string& path) {
+    while (length > 0) {
+        ssize_t written = ::write(fd, data, length);
+        if (written < 0) {
+            throw std::runtime_error("Cannot write log file: " + path);
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+}
+
+bool decode_record(const char* body, size_t length, WalRecord& record) {
+    const char* pos = body;
+    const char* end = body + length;
+
+    uint8_t type;
+    uint16_t name_length;
+    uint32_t payload_length;
+    if (!read_raw(pos, end, record.lsn) || !read_raw(pos, end, type) || !read_raw(pos, end, name_length)) {
+        return false;
+    }
+    if (end - pos < name_length) {
+        return false;
+    }
+    record.type = static_cast<WalRecordType>(type);
+    record.table_name.assign(pos, name_length);
+    pos += name_length;
+
+    if (!read_raw(pos, end, record.page_no) || !read_raw(pos, end, payload_length)) {
+        return false;
+    }
+    if (end - pos != static_cast<std::ptrdiff_t>(payload_length)) {
+        return false;
+    }
+    record.payload.assign(pos, payload_length);
+    return true;
+}
+
+// Makes a rename in the file's directory durable
+void sync_parent_directory(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : path.substr(0, slash);
+    int dir_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd < 0) {
+        throw std::runtime_error("Cannot open directory: " + directory);
+    }
+    int result = ::fsync(dir_fd);
+    ::close(dir_fd);
+    if (result != 0) {
+        throw std::runtime_error("Cannot sync directory: " + directory);
+    }
+}
+
+// Reads the record at offset if it is intact and ends by end. Returns the
+// offset past it, or -1.
+off_t read_record(int fd, off_t offset, off_t end, std::vector<char>& body, WalRecord& record) {
+    if (offset + static_cast<off_t>(RECORD_FRAME_SIZE) > end) {
+        return -1;
+    }
+    char frame[RECORD_FRAME_SIZE];
+    if (::pread(fd, frame, RECORD_FRAME_SIZE, offset) != static_cast<ssize_t>(RECORD_FRAME_SIZE)) {
+        return -1;
+    }
+
+    uint32_t body_length;
+    uint32_t checksum;
+    std::memcpy(&body_length, frame, sizeof(body_length));
+    std::memcpy(&checksum, frame + sizeof(body_length), sizeof(checksum));
+    if (offset + static_cast<off_t>(RECORD_FRAME_SIZE + body_length) > end) {
+        return -1;
+    }
+
+    body.resize(body_length);
+    off_t body_offset = offset + static_cast<off_t>(RECORD_FRAME_SIZE);
+    if (::pread(fd, body.data(), body_length, body_offset) != static_cast<ssize_t>(body_length) ||
+        crc32(body.data(), body_length) != checksum || !decode_record(body.data(), body_length, record)) {
+        return -1;
+    }
+    return body_offset + static_cast<off_t>(body_length);
+}
+
+} // namespace
+
+WriteAheadLog::WriteAheadLog(const std::string& path, WalSyncMode sync_mode, int sync_interval_ms)
+    : path(path), fd(-1), sync_mode(sync_mode), sync_interval_ms(sync_interval_ms),
+      next_lsn(1), written_lsn(0), durable_lsn(0), log_size(0), flush_in_progress(false), stopping(false),
+      next_hook_id(0) {
+    open_log();
+
+    if (sync_mode == WalSyncMode::NORMAL) {
+        sync_thread = std::thread(&WriteAheadLog::sync_loop, this);
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    sync_wakeup.notify_all();
+    if (sync_thread.joinable()) {
+        sync_thread.join();
+    }
+
+    try {
+        flush(next_lsn - 1);
+    } catch (const std::exception& e) {
+        // Unwritten records are lost, as after a crash
+    }
+
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+void WriteAheadLog::open_log() {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open log file: " + path);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        throw std::runtime_error("Cannot stat log file: " + path);
+    }
+
+    // Only a log that was just created starts over at LSN 1; a short one
+    // lost its header, and guessing would reuse LSNs already on pages
+    if (st.st_size == 0) {
+        write_header(1);
+        return;
+    }
+    if (st.st_size < static_cast<off_t>(WAL_HEADER_SIZE)) {
+        throw std::runtime_error("Log file is truncated: " + path);
+    }
+
+    char header[WAL_HEADER_SIZE];
+    if (::pread(fd, header, WAL_HEADER_SIZE, 0) != static_cast<ssize_t>(WAL_HEADER_SIZE) ||
+        std::memcmp(header, WAL_MAGIC, sizeof(WAL_MAGIC)) != 0) {
+        throw std::runtime_error("Not a write-ahead log file: " + path);
+    }
+    std::memcpy(&next_lsn, header + sizeof(WAL_MAGIC), sizeof(next_lsn));
+    written_lsn = durable_lsn = next_lsn - 1;
+    log_size = static_cast<uint64_t>(st.st_size);
+}
+
+void WriteAheadLog::write_header(uint64_t start_lsn) {
+    // The emptied log is written beside the old one and renamed over it. A
+    // crash leaves either the old log or the new one, never a log without a
+    // header: that would restart LSNs at 1, below the LSNs already on pages,
+    // and replay would skip every new record.
+    std::string temp_path = path + ".tmp";
+    int temp_fd = ::open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (temp_fd < 0) {
+        throw std::runtime_error("Cannot create log file: " + temp_path);
+    }
+
+    char header[WAL_HEADER_SIZE];
+    std::memcpy(header, WAL_MAGIC, sizeof(WAL_MAGIC));
+    std::memcpy(header + sizeof(WAL_MAGIC), &start_lsn, sizeof(start_lsn));
+    try {
+        write_all(temp_fd, header, WAL_HEADER_SIZE, temp_path);
+        if (::fsync(temp_fd) != 0) {
+            throw std::runtime_error("Cannot sync log file: " + temp_path);
+        }
+        if (::rename(temp_path.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Cannot replace log file: " + path);
+        }
+    } catch (...) {
+        ::close(temp_fd);
+        ::unlink(temp_path.c_str());
+        throw;
+    }
+    sync_parent_directory(path);
+
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = temp_fd;
+    next_lsn = start_lsn;
+    written_lsn = durable_lsn = start_lsn - 1;
+    log_size = WAL_HEADER_SIZE;
+}
+
+uint64_t WriteAheadLog::append(WalRecordType type, const std::string& table_name, uint32_t page_no,
+                               const std::string& payload) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint64_t lsn = next_lsn++;
+
+    std::string body;
+    body.reserve(19 + table_name.size() + payload.size());
+    append_raw(body, lsn);
+    append_raw(body, static_cast<uint8_t>(type));
+    append_raw(body, static_cast<uint16_t>(table_name.size()));
+    body.append(table_name);
+    append_raw(body, page_no);
+    append_raw(body, static_cast<uint32_t>(payload.size()));
+    body.append(payload);
+
+    append_raw(log_buffer, static_cast<uint32_t>(body.size()));
+    append_raw(log_buffer, crc32(body.data(), body.size()));
+    log_buffer.append(body);
+
+    stats.records++;
+    stats.bytes += RECORD_FRAME_SIZE + body.size();
+    log_size += RECORD_FRAME_SIZE + body.size();
+    return lsn;
+}
+
+void WriteAheadLog::commit(uint64_t lsn) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.commits++;
+    }
+
+    switch (sync_mode) {
+        case WalSyncMode::FULL:
+            flush_to(lsn, true);
+            break;
+        case WalSyncMode::NORMAL:
+            // Survives a process crash now, an OS crash after the next group sync
+            flush_to(lsn, false);
+            break;
+        case WalSyncMode::OFF: {
+            bool write_now;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                write_now = log_buffer.size() >= LAZY_WRITE_THRESHOLD;
+            }
+            if (write_now) {
+                flush_to(lsn, false);
+            }
+            break;
+        }
+    }
+}
+
+void WriteAheadLog::flush(uint64_t lsn) {
+    flush_to(lsn, sync_mode != WalSyncMode::OFF);
+}
+
+void WriteAheadLog::flush_to(uint64_t lsn, bool sync) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while ((sync ? durable_lsn : written_lsn) < lsn) {
+        // Another thread is writing; its batch may already cover this lsn
+        if (flush_in_progress) {
+            flush_done.wait(lock);
+            continue;
+        }
+
+        // Become the group leader: take everything appended so far
+        flush_in_progress = true;
+        std::string batch;
+        batch.swap(log_buffer);
+        uint64_t batch_lsn = next_lsn - 1;
+        lock.unlock();
+
+        try {
+            write_all(fd, batch.data(), batch.size(), path);
+            if (sync && ::fdatasync(fd) != 0) {
+                throw std::runtime_error("Cannot sync log file: " + path);
+            }
+        } catch (...) {
+            lock.lock();
+            flush_in_progress = false;
+            flush_done.notify_all();
+            throw;
+        }
+
+        lock.lock();
+        written_lsn = batch_lsn;
+        if (sync) {
+            durable_lsn = batch_lsn;
+            stats.syncs++;
+        }
+        flush_in_progress = false;
+        flush_done.notify_all();
+    }
+}
+
+void WriteAheadLog::sync_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        sync_wakeup.wait_for(lock, std::chrono::milliseconds(sync_interval_ms));
+        if (stopping) {
+            break;
+        }
+
+        uint64_t target = next_lsn - 1;
+        if (durable_lsn >= target) {
+            continue;
+        }
+
+        lock.unlock();
+        try {
+            flush_to(target, true);
+        } catch (const std::exception& e) {
+            // Retried on the next tick; commits in FULL paths report errors
+        }
+        lock.lock();
+    }
+}
+
+void WriteAheadLog::replay(const std::function<void(const WalRecord&)>& apply) {
+    off_t end;
+    std::vector<char> body;
+    WalRecord record;
+
+    // First pass, under the lock: find the intact records and cut off a torn
+    // tail left by a crash
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        off_t offset = static_cast<off_t>(WAL_HEADER_SIZE);
+        off_t next;
+        while ((next = read_record(fd, offset, static_cast<off_t>(log_size), body, record)) >= 0) {
+            offset = next;
+            if (record.lsn >= next_lsn) {
+                next_lsn = record.lsn + 1;
+            }
+        }
+        if (offset < static_cast<off_t>(log_size)) {
+            if (::ftruncate(fd, offset) != 0) {
+                throw std::runtime_error("Cannot truncate log file: " + path);
+            }
+            log_size = static_cast<uint64_t>(offset);
+        }
+        if (sync_mode != WalSyncMode::OFF && ::fdatasync(fd) != 0) {
+            throw std::runtime_error("Cannot sync log file: " + path);
+        }
+        written_lsn = durable_lsn = next_lsn - 1;
+        end = offset;
+    }
+
+    // Second pass, unlocked: redo may evict pages, and writing one back
+    // flushes the log, which now returns at once
+    off_t offset = static_cast<off_t>(WAL_HEADER_SIZE);
+    while (offset < end) {
+        offset = read_record(fd, offset, end, body, record);
+        if (offset < 0) {
+            throw std::runtime_error("Cannot reread log file: " + path);
+        }
+        apply(record);
+    }
+}
+
+void WriteAheadLog::checkpoint(BufferPool* buffer_pool) {
+    std::vector<std::function<void()>> hooks;
+    {
+        std::lock_guard<std::mutex> lock(hooks_mutex);
+        for (const auto& entry : checkpoint_hooks) {
+            hooks.push_back(entry.second);
+        }
+    }
+    for (const std::function<void()>& hook : hooks) {
+        hook();
+    }
+
+    flush(next_lsn - 1);
+    buffer_pool->flush_all();
+    buffer_pool->sync_all();
+
+    // The log file is replaced, so no write may still be using it
+    std::unique_lock<std::mutex> lock(mutex);
+    while (flush_in_progress) {
+        flush_done.wait(lock);
+    }
+    write_header(next_lsn);
+    stats.checkpoints++;
+}
+
+bool WriteAheadLog::needs_checkpoint() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return log_size >= CHECKPOINT_THRESHOLD;
+}
+
+int WriteAheadLog::add_checkpoint_hook(std::function<void()> hook) {
+    std::lock_guard<std::mutex> lock(hooks_mutex);
+    int id = next_hook_id++;
+    checkpoint_hooks[id] = std::move(hook);
+    return id;
+}
+
+void WriteAheadLog::remove_checkpoint_hook(int id) {
+    std::lock_guard<std::mutex> lock(hooks_mutex);
+    checkpoint_hooks.erase(id);
+}
+
+WalStats WriteAheadLog::get_stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+} // namespace sqldb
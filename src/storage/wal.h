@@ -0,0 +1,112 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include "../common/config.h"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace sqldb {
+
+class BufferPool;
+
+enum class WalRecordType : uint8_t {
+    INSERT = 1
+};
+
+// One redo record: the encoded row and the heap page it was placed on
+struct WalRecord {
+    uint64_t lsn;
+    WalRecordType type;
+    std::string table_name;
+    uint32_t page_no;
+    std::string payload;
+};
+
+struct WalStats {
+    uint64_t records = 0;
+    uint64_t bytes = 0;
+    uint64_t commits = 0;
+    uint64_t syncs = 0;
+    uint64_t checkpoints = 0;
+};
+
+// Sequential redo log shared by all tables. Inserts append a record and
+// commit it; the table pages they dirtied are written back later by the
+// buffer pool, which flushes the log up to a page's LSN first.
+class WriteAheadLog {
+private:
+    std::string path;
+    int fd;
+    WalSyncMode sync_mode;
+    int sync_interval_ms;
+
+    // Records appended but not yet written to the file
+    std::string log_buffer;
+    uint64_t next_lsn;
+    uint64_t written_lsn;
+    uint64_t durable_lsn;
+    uint64_t log_size;
+    bool flush_in_progress;
+    WalStats stats;
+
+    mutable std::mutex mutex;
+    std::condition_variable flush_done;
+
+    // Background fsync for NORMAL mode
+    std::thread sync_thread;
+    std::condition_variable sync_wakeup;
+    bool stopping;
+
+    // Run by checkpoint() before the log is emptied; own lock, so tables
+    // register without the log's
+    std::mutex hooks_mutex;
+    std::map<int, std::function<void()>> checkpoint_hooks;
+    int next_hook_id;
+
+    void open_log();
+    void write_header(uint64_t start_lsn);
+    void flush_to(uint64_t lsn, bool sync);
+    void sync_loop();
+
+public:
+    WriteAheadLog(const std::string& path, WalSyncMode sync_mode, int sync_interval_ms);
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Logging
+    uint64_t append(WalRecordType type, const std::string& table_name, uint32_t page_no,
+                    const std::string& payload);
+    void commit(uint64_t lsn);
+
+    // Makes every record up to lsn durable (written only, in OFF mode)
+    void flush(uint64_t lsn);
+
+    // Recovery: calls apply for every intact record, oldest first, and cuts
+    // off a torn tail left by a crash. apply runs without the log's lock and
+    // may write pages back, since the replayed records count as flushed.
+    void replay(const std::function<void(const WalRecord&)>& apply);
+
+    // Writes back all dirty pages, syncs the table files and empties the log.
+    // Must not run concurrently with append.
+    void checkpoint(BufferPool* buffer_pool);
+    bool needs_checkpoint() const;
+
+    // Tables that keep logged rows outside the buffer pool write them out
+    // from a hook; add returns the id to remove it with
+    int add_checkpoint_hook(std::function<void()> hook);
+    void remove_checkpoint_hook(int id);
+
+    WalStats get_stats();
+    WalSyncMode get_sync_mode() const { return sync_mode; }
+};
+
+} // namespace sqldb
+
+#endif // WAL_H
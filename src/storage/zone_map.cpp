@@ -0,0 +1,256 @@
+#include "zone_map.h"
+#include "../common/compare.h"
+#include "buffer_pool.h"
+#include "page.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace sqldb {
+
+namespace {
+
+constexpr char ZONE_MAP_MAGIC[8] = {'S', 'Q', 'L', 'M', 'Z', 'M', 'P', '1'};
+
+// Each entry: u32 number of rows summarized, then one ColumnZone per column
+constexpr size_t ENTRY_HEADER_SIZE = sizeof(uint32_t);
+
+int32_t load_bound(const char* bound) {
+    int32_t value;
+    std::memcpy(&value, bound, sizeof(value));
+    return value;
+}
+
+void store_bound(char* bound, int32_t value) {
+    std::memcpy(bound, &value, sizeof(value));
+}
+
+void make_prefix(const std::string& value, char* key) {
+    std::memset(key, 0, ZONE_PREFIX_SIZE);
+    std::memcpy(key, value.data(), std::min(value.size(), ZONE_PREFIX_SIZE));
+}
+
+int32_t ordered_value(DataType type, const Value& value) {
+    return type == DataType::INTEGER ? std::get<int>(value) : (std::get<bool>(value) ? 1 : 0);
+}
+
+} // namespace
+
+void extend_zone(ColumnZone& zone, bool first, DataType type, const Value& value) {
+    if (first) {
+        std::memset(&zone, 0, sizeof(zone));
+    }
+
+    if (type == DataType::VARCHAR) {
+        char key[ZONE_PREFIX_SIZE];
+        make_prefix(std::get<std::string>(value), key);
+        if (first || std::memcmp(key, zone.min, ZONE_PREFIX_SIZE) < 0) {
+            std::memcpy(zone.min, key, ZONE_PREFIX_SIZE);
+        }
+        if (first || std::memcmp(key, zone.max, ZONE_PREFIX_SIZE) > 0) {
+            std::memcpy(zone.max, key, ZONE_PREFIX_SIZE);
+        }
+        return;
+    }
+
+    int32_t number = ordered_value(type, value);
+    if (first || number < load_bound(zone.min)) {
+        store_bound(zone.min, number);
+    }
+    if (first || number > load_bound(zone.max)) {
+        store_bound(zone.max, number);
+    }
+}
+
+bool zone_may_match(const ColumnZone& zone, DataType type, const BoundCondition& condition) {
+    if (type == DataType::VARCHAR) {
+        // Prefixes only decide when they differ, equal prefixes keep the zone
+        char key[ZONE_PREFIX_SIZE];
+        make_prefix(std::get<std::string>(condition.value), key);
+        int vs_min = std::memcmp(key, zone.min, ZONE_PREFIX_SIZE);
+        int vs_max = std::memcmp(key, zone.max, ZONE_PREFIX_SIZE);
+
+        switch (condition.operator_type) {
+            case TokenType::EQUALS:
+                return vs_min >= 0 && vs_max <= 0;
+            case TokenType::GREATER_THAN:
+            case TokenType::GREATER_EQUAL:
+                return vs_max <= 0;
+            case TokenType::LESS_THAN:
+            case TokenType::LESS_EQUAL:
+                return vs_min >= 0;
+            case TokenType::LIKE: {
+                // Matches start with the literal prefix, so the zone must
+                // straddle it over the bytes both have
+                std::string_view prefix = like_prefix(std::get<std::string>(condition.value));
+                size_t length = std::min(prefix.size(), ZONE_PREFIX_SIZE);
+                return std::memcmp(zone.min, prefix.data(), length) <= 0 &&
+                       std::memcmp(zone.max, prefix.data(), length) >= 0;
+            }
+            default:
+                return true;
+        }
+    }
+
+    int32_t target = ordered_value(type, condition.value);
+    int32_t low = load_bound(zone.min);
+    int32_t high = load_bound(zone.max);
+
+    switch (condition.operator_type) {
+        case TokenType::EQUALS:
+            return low <= target && target <= high;
+        case TokenType::NOT_EQUALS:
+            return !(low == target && high == target);
+        case TokenType::LESS_THAN:
+            return low < target;
+        case TokenType::GREATER_THAN:
+            return high > target;
+        case TokenType::LESS_EQUAL:
+            return low <= target;
+        case TokenType::GREATER_EQUAL:
+            return high >= target;
+        default:
+            return true;
+    }
+}
+
+ZoneMap::ZoneMap(BufferPool* buffer_pool, const std::string& file_path, const std::vector<Column>& columns)
+    : buffer_pool(buffer_pool), file_path(file_path), file_id(0), rebuilt(false) {
+    if (!supports(columns)) {
+        throw std::runtime_error("Too many columns for a zone map");
+    }
+    for (const Column& column : columns) {
+        types.push_back(column.type);
+    }
+    entry_size = ENTRY_HEADER_SIZE + types.size() * sizeof(ColumnZone);
+    entries_per_page = static_cast<uint32_t>(PAGE_SIZE / entry_size);
+
+    if (!std::filesystem::exists(file_path)) {
+        write_empty_file();
+        rebuilt = true;
+    }
+    file_id = buffer_pool->register_file(file_path);
+
+    // A sidecar from another schema or a damaged one is started over
+    if (!header_matches()) {
+        buffer_pool->drop_file(file_path);
+        write_empty_file();
+        file_id = buffer_pool->register_file(file_path);
+        rebuilt = true;
+    }
+}
+
+bool ZoneMap::supports(const std::vector<Column>& columns) {
+    return !columns.empty() && ENTRY_HEADER_SIZE + columns.size() * sizeof(ColumnZone) <= PAGE_SIZE;
+}
+
+void ZoneMap::write_empty_file() {
+    std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot create zone map file: " + file_path);
+    }
+
+    // Header page: magic, column count, one type byte per column
+    char header[PAGE_SIZE] = {};
+    std::memcpy(header, ZONE_MAP_MAGIC, sizeof(ZONE_MAP_MAGIC));
+    uint32_t column_count = static_cast<uint32_t>(types.size());
+    std::memcpy(header + sizeof(ZONE_MAP_MAGIC), &column_count, sizeof(column_count));
+    for (size_t i = 0; i < types.size(); i++) {
+        header[sizeof(ZONE_MAP_MAGIC) + sizeof(column_count) + i] = static_cast<char>(types[i]);
+    }
+
+    file.write(header, PAGE_SIZE);
+    if (!file) {
+        throw std::runtime_error("Cannot write zone map file: " + file_path);
+    }
+}
+
+bool ZoneMap::header_matches() {
+    if (buffer_pool->get_page_count(file_id) == 0) {
+        return false;
+    }
+
+    PageGuard guard(buffer_pool, file_id, 0);
+    const char* header = guard.get_data();
+    uint32_t column_count;
+    std::memcpy(&column_count, header + sizeof(ZONE_MAP_MAGIC), sizeof(column_count));
+    if (std::memcmp(header, ZONE_MAP_MAGIC, sizeof(ZONE_MAP_MAGIC)) != 0 || column_count != types.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < types.size(); i++) {
+        if (header[sizeof(ZONE_MAP_MAGIC) + sizeof(column_count) + i] != static_cast<char>(types[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t ZoneMap::get_zone_page_no(uint32_t data_page_no) const {
+    return 1 + (data_page_no - 1) / entries_per_page;
+}
+
+char* ZoneMap::locate_entry(char* page, uint32_t data_page_no) const {
+    return page + ((data_page_no - 1) % entries_per_page) * entry_size;
+}
+
+void ZoneMap::extend(uint32_t data_page_no, const Row& row) {
+    if (data_page_no == 0 || row.size() != types.size()) {
+        return;
+    }
+
+    uint32_t zone_page_no = get_zone_page_no(data_page_no);
+    while (buffer_pool->get_page_count(file_id) <= zone_page_no) {
+        PageGuard new_page(buffer_pool, file_id);
+    }
+
+    PageGuard guard(buffer_pool, file_id, zone_page_no);
+    char* entry = locate_entry(guard.get_data(), data_page_no);
+
+    uint32_t row_count;
+    std::memcpy(&row_count, entry, sizeof(row_count));
+    ColumnZone* zones = reinterpret_cast<ColumnZone*>(entry + ENTRY_HEADER_SIZE);
+    for (size_t i = 0; i < types.size(); i++) {
+        extend_zone(zones[i], row_count == 0, types[i], row[i]);
+    }
+    row_count++;
+    std::memcpy(entry, &row_count, sizeof(row_count));
+    guard.mark_dirty();
+}
+
+bool ZoneMap::may_match(uint32_t data_page_no, const BoundCondition& condition) {
+    uint32_t zone_page_no = get_zone_page_no(data_page_no);
+    if (data_page_no == 0 || zone_page_no >= buffer_pool->get_page_count(file_id)) {
+        return true;
+    }
+
+    PageGuard guard(buffer_pool, file_id, zone_page_no);
+    char* entry = locate_entry(guard.get_data(), data_page_no);
+
+    uint32_t row_count;
+    std::memcpy(&row_count, entry, sizeof(row_count));
+    if (row_count == 0) {
+        return true;
+    }
+
+    const ColumnZone* zones = reinterpret_cast<const ColumnZone*>(entry + ENTRY_HEADER_SIZE);
+    int column = condition.column_index;
+    return zone_may_match(zones[column], types[column], condition);
+}
+
+void ZoneMap::clear() {
+    buffer_pool->drop_file(file_path);
+    write_empty_file();
+    file_id = buffer_pool->register_file(file_path);
+}
+
+void ZoneMap::delete_file() {
+    buffer_pool->drop_file(file_path);
+
+    std::error_code ec;
+    std::filesystem::remove(file_path, ec);
+    // Ignore errors if file doesn't exist
+}
+
+} // namespace sqldb
@@ -0,0 +1,73 @@
+#ifndef ZONE_MAP_H
+#define ZONE_MAP_H
+
+#include "../common/types.h"
+#include "row_codec.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sqldb {
+
+class BufferPool;
+
+constexpr size_t ZONE_PREFIX_SIZE = 8;
+
+// Min/max summary of one column over a group of rows. INTEGER and BOOLEAN
+// bounds are exact int32 values; VARCHAR bounds are the first
+// ZONE_PREFIX_SIZE bytes, zero padded, which order the same way as the full
+// strings and so stay conservative.
+struct ColumnZone {
+    char min[ZONE_PREFIX_SIZE];
+    char max[ZONE_PREFIX_SIZE];
+};
+
+// Widens the zone to include value; first starts a fresh zone
+void extend_zone(ColumnZone& zone, bool first, DataType type, const Value& value);
+
+// False only when no value inside the zone can satisfy the condition
+bool zone_may_match(const ColumnZone& zone, DataType type, const BoundCondition& condition);
+
+// Per-page zones of a row table, stored in a paged sidecar file
+// (<table>.zmap) that goes through the buffer pool like the table itself.
+// Zone pages are not logged: a checkpoint writes them back with the data
+// pages, and recovery extends them again for every replayed insert, so a
+// zone never misses a row that reached the table.
+class ZoneMap {
+private:
+    BufferPool* buffer_pool;
+    std::string file_path;
+    uint32_t file_id;
+    std::vector<DataType> types;
+    size_t entry_size;
+    uint32_t entries_per_page;
+    bool rebuilt;
+
+    void write_empty_file();
+    bool header_matches();
+    char* locate_entry(char* page, uint32_t data_page_no) const;
+    uint32_t get_zone_page_no(uint32_t data_page_no) const;
+
+public:
+    ZoneMap(BufferPool* buffer_pool, const std::string& file_path, const std::vector<Column>& columns);
+
+    // True when the sidecar was missing or unusable and was started empty;
+    // the owner must then feed every existing row through extend()
+    bool needs_rebuild() const { return rebuilt; }
+
+    // Maintenance
+    void extend(uint32_t data_page_no, const Row& row);
+    void clear();
+    void delete_file();
+
+    // Scan pruning; data pages without a zone are never skipped
+    bool may_match(uint32_t data_page_no, const BoundCondition& condition);
+
+    // Tables this wide get no zone map
+    static bool supports(const std::vector<Column>& columns);
+};
+
+} // namespace sqldb
+
+#endif // ZONE_MAP_H
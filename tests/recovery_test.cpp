@@ -0,0 +1,128 @@
+// Crashes a process in the middle of inserting into a row and a column table
+// and recovers them with a buffer pool much smaller than the pages the log
+// touches, so redo evicts dirty pages, and each eviction flushes the log,
+// while replay is still running.
+//
+// Build and run with: make test
+
+#include "executor/query_executor.h"
+#include "parser/parser.h"
+#include "parser/tokenizer.h"
+#include <csignal>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace sqldb;
+
+namespace {
+
+constexpr int ROW_COUNT = 20000;
+constexpr size_t LOAD_POOL_BYTES = 64 * 1024 * 1024;
+constexpr size_t RECOVERY_POOL_BYTES = 1024 * 1024;
+constexpr unsigned TIMEOUT_SECONDS = 120;
+
+int failures = 0;
+
+std::string run(QueryExecutor& executor, const std::string& sql) {
+    Tokenizer tokenizer(sql);
+    std::vector<Token> tokens = tokenizer.tokenize();
+    Parser parser(tokens);
+    return executor.execute(parser.parse());
+}
+
+void check(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "FAILED: " << message << "\n";
+        failures++;
+    }
+}
+
+long rows_returned(const std::string& output) {
+    size_t end = output.rfind(" rows returned.");
+    if (end == std::string::npos) {
+        return -1;
+    }
+    size_t start = output.find_last_not_of("0123456789", end - 1) + 1;
+    return std::stol(output.substr(start, end - start));
+}
+
+// Logs every row with the table pages left in memory, then dies without
+// writing them back
+void load_and_crash(const std::string& data_dir) {
+    DatabaseConfig config;
+    config.data_directory = data_dir;
+    config.buffer_pool_bytes = LOAD_POOL_BYTES;
+    config.wal_sync_mode = WalSyncMode::NORMAL;
+    QueryExecutor executor(config);
+    run(executor, "CREATE TABLE events (id INTEGER PRIMARY KEY, name VARCHAR(100), valid BOOLEAN)");
+    run(executor, "CREATE TABLE readings (id INTEGER PRIMARY KEY, name VARCHAR(100), valid BOOLEAN) "
+                  "WITH (storage = column)");
+    for (int i = 0; i < ROW_COUNT; i++) {
+        // Keys out of order, so the index pages are dirtied all over
+        int id = (i * 7919) % ROW_COUNT;
+        std::string values = std::to_string(id) + ", 'event " + std::to_string(id) + std::string(60, 'x') + "', true";
+        run(executor, "INSERT INTO events VALUES (" + values + ")");
+        run(executor, "INSERT INTO readings VALUES (" + values + ")");
+    }
+    ::_exit(0);
+}
+
+void timed_out(int) {
+    const char message[] = "FAILED: recovery did not finish\n";
+    ssize_t ignored = ::write(STDERR_FILENO, message, sizeof(message) - 1);
+    (void)ignored;
+    ::_exit(1);
+}
+
+void verify(const std::string& data_dir, const std::string& stage) {
+    DatabaseConfig config;
+    config.data_directory = data_dir;
+    config.buffer_pool_bytes = RECOVERY_POOL_BYTES;
+    QueryExecutor executor(config);
+
+    const std::vector<std::string> tables = {"events", "readings"};
+    for (const std::string& table : tables) {
+        std::string where = stage + ", " + table;
+        check(rows_returned(run(executor, "SELECT id FROM " + table)) == ROW_COUNT, where + ": every row is back");
+        check(rows_returned(run(executor, "SELECT * FROM " + table + " WHERE id = 12345")) == 1,
+              where + ": a row is found by its key");
+        check(run(executor, "INSERT INTO " + table + " VALUES (777, 'again', false)").find("Duplicate") !=
+                  std::string::npos,
+              where + ": a taken key is rejected");
+    }
+}
+
+} // namespace
+
+int main() {
+    std::string data_dir = (std::filesystem::temp_directory_path() / "sqldb_recovery_test").string();
+    std::filesystem::remove_all(data_dir);
+    std::filesystem::create_directories(data_dir);
+
+    pid_t child = ::fork();
+    if (child == 0) {
+        load_and_crash(data_dir);
+    }
+    int status = 0;
+    if (child < 0 || ::waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "FAILED: loading process\n";
+        return 1;
+    }
+
+    std::signal(SIGALRM, timed_out);
+    ::alarm(TIMEOUT_SECONDS);
+    verify(data_dir, "after the crash");
+    verify(data_dir, "after a clean restart");
+    ::alarm(0);
+
+    std::filesystem::remove_all(data_dir);
+    if (failures > 0) {
+        return 1;
+    }
+    std::cout << "recovery_test passed\n";
+    return 0;
+}